@@ -12,9 +12,13 @@
 
 #include <SDL_image.h>
 
+#include <charconv>
+#include <cstdlib>
 #include <span>
+#include <string_view>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
 #include "abcgWindow.hpp"
 
 #if defined(__EMSCRIPTEN__)
@@ -27,6 +31,33 @@
 
 #include "tiny_obj_loader.h"
 
+#if !defined(__EMSCRIPTEN__)
+namespace {
+[[nodiscard]] int parsePositiveInt(std::string_view option,
+                                   std::string_view value) {
+  int result{};
+  auto const *last{value.data() + value.size()};
+  if (auto const [ptr, errc]{std::from_chars(value.data(), last, result)};
+      errc != std::errc{} || ptr != last || result <= 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid value for {}: {}", option, value));
+  }
+  return result;
+}
+
+[[nodiscard]] glm::ivec2 parseSize(std::string_view option,
+                                   std::string_view value) {
+  auto const separator{value.find('x')};
+  if (separator == std::string_view::npos) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid value for {}: {}", option, value));
+  }
+  return {parsePositiveInt(option, value.substr(0, separator)),
+          parsePositiveInt(option, value.substr(separator + 1))};
+}
+} // namespace
+#endif
+
 #if defined(__EMSCRIPTEN__)
 void abcg::mainLoopCallback(void *userData) {
   abcg::Application &app{*(static_cast<abcg::Application *>(userData))};
@@ -44,6 +75,19 @@ void abcg::mainLoopCallback(void *userData) {
  * of which the last one is nullptr and the previous ones, if any, point to
  * null-terminated multibyte strings that represent the arguments passed to the
  * program from the execution environment.
+ *
+ * The following arguments render the window offline to an image sequence
+ * (see abcg::OfflineRenderSettings). They are not supported on WebAssembly.
+ *
+ * - `--render-offline <path>`: enables the offline render and sets the output
+ *   path. Frames are written to a YUV4MPEG2 stream if the path ends with
+ *   `.y4m`, or else to numbered PPM images.
+ * - `--render-size <width>x<height>`: resolution of the frames.
+ * - `--render-fps <rate>`: simulated frames per second.
+ * - `--render-frames <count>`: number of frames to render.
+ *
+ * @throw abcg::RuntimeError if an argument of the offline render is missing or
+ * invalid.
  */
 abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
   // Get executable relative path
@@ -61,6 +105,30 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
 #endif
 
   abcg::Application::m_assetsPath = abcg::Application::m_basePath + "/assets/";
+
+#if !defined(__EMSCRIPTEN__)
+  // Options of the offline render. Other arguments are left to the caller
+  auto const args{std::span{argv, gsl::narrow<std::size_t>(argc)}};
+  for (std::size_t index{1}; index < args.size(); ++index) {
+    std::string_view const option{args[index]};
+    // Consumes the argument that follows the option
+    auto const value{[&] {
+      if (index + 1 == args.size()) {
+        throw abcg::RuntimeError(fmt::format("Missing value for {}", option));
+      }
+      return std::string_view{args[++index]};
+    }};
+    if (option == "--render-offline") {
+      m_offlineRenderSettings.path = value();
+    } else if (option == "--render-size") {
+      m_offlineRenderSettings.size = parseSize(option, value());
+    } else if (option == "--render-fps") {
+      m_offlineRenderSettings.frameRate = parsePositiveInt(option, value());
+    } else if (option == "--render-frames") {
+      m_offlineRenderSettings.frameCount = parsePositiveInt(option, value());
+    }
+  }
+#endif
 }
 
 /**
@@ -71,10 +139,18 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
  *
  * @param window L-value reference to the window object.
  *
+ * If the environment variable `ABCG_TRACE` is set, trace zones are recorded
+ * and written at exit to the file it names (see abcg::dumpTrace).
+ *
  * @throw abcg::SDLError if `SDL_Init` failed.
  * @throw abcg::SDLImageError if `IMG_Init` failed.
  */
 void abcg::Application::run(Window &window) {
+  char const *traceFilename{std::getenv("ABCG_TRACE")};
+  if (traceFilename != nullptr && *traceFilename != '\0') {
+    abcg::setTraceEnabled(true);
+  }
+
   if (Uint32 const subsystemMask{SDL_INIT_VIDEO | SDL_INIT_AUDIO |
                                  SDL_INIT_GAMECONTROLLER};
       SDL_Init(subsystemMask) != 0) {
@@ -91,6 +167,9 @@ void abcg::Application::run(Window &window) {
 #endif
 
   m_window = &window;
+  if (!m_offlineRenderSettings.path.empty()) {
+    m_window->setOfflineRenderSettings(m_offlineRenderSettings);
+  }
   m_window->templateCreate();
 
 #if defined(__EMSCRIPTEN__)
@@ -108,6 +187,10 @@ void abcg::Application::run(Window &window) {
   IMG_Quit();
 #endif
   SDL_Quit();
+
+  if (abcg::isTraceEnabled() && traceFilename != nullptr) {
+    abcg::dumpTrace(traceFilename);
+  }
 }
 
 /**
@@ -145,7 +228,35 @@ std::string const &abcg::Application::getBasePath() noexcept {
   return m_basePath;
 }
 
+/**
+ * @brief Returns a per-user directory where the application can write files,
+ * such as caches.
+ *
+ * This is the directory given by `SDL_GetPrefPath`, e.g.,
+ * `~/.local/share/<organization>/<application>/` on Linux. It is created if
+ * it does not exist.
+ *
+ * @param organization Name of the organization of the application.
+ * @param application Name of the application.
+ *
+ * @return Path to the directory, ending with a path separator, or an empty
+ * string if the directory could not be created.
+ */
+std::string
+abcg::Application::getUserDataPath(std::string const &organization,
+                                   std::string const &application) {
+  auto *const path{SDL_GetPrefPath(organization.c_str(), application.c_str())};
+  if (path == nullptr) {
+    return {};
+  }
+  std::string userDataPath{path};
+  SDL_free(path);
+  return userDataPath;
+}
+
 void abcg::Application::mainLoopIterator([[maybe_unused]] bool &done) const {
+  ABCG_TRACE_ZONE("Application::mainLoopIterator");
+
   SDL_Event event{};
   while (SDL_PollEvent(&event) != 0) {
 #if !defined(__EMSCRIPTEN__)
@@ -155,4 +266,9 @@ void abcg::Application::mainLoopIterator([[maybe_unused]] bool &done) const {
     m_window->templateHandleEvent(event, done);
   }
   m_window->templatePaint();
+
+#if !defined(__EMSCRIPTEN__)
+  if (m_window->isOfflineRenderComplete())
+    done = true;
+#endif
 }
@@ -13,6 +13,8 @@
 
 #include <string>
 
+#include "abcgWindow.hpp"
+
 #define ABCG_VERSION_MAJOR 3
 #define ABCG_VERSION_MINOR 1
 #define ABCG_VERSION_PATCH 0
@@ -42,11 +44,15 @@ public:
 
   static std::string const &getAssetsPath() noexcept;
   static std::string const &getBasePath() noexcept;
+  [[nodiscard]] static std::string
+  getUserDataPath(std::string const &organization,
+                  std::string const &application);
 
 private:
   void mainLoopIterator(bool &done) const;
 
   Window *m_window{};
+  OfflineRenderSettings m_offlineRenderSettings;
 
 #if defined(__EMSCRIPTEN__)
   friend void mainLoopCallback(void *userData);
@@ -13,8 +13,492 @@
 #include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 
-#include <span>
-#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#if !defined(__EMSCRIPTEN__) && (defined(__x86_64__) || defined(_M_X64))
+#define ABCG_IMAGE_KERNEL_SSE2
+#include <immintrin.h>
+#if defined(__GNUC__)
+// GCC and Clang can compile AVX2 code for a single function and check the CPU
+// at runtime
+#define ABCG_IMAGE_KERNEL_AVX2
+#endif
+#elif !defined(__EMSCRIPTEN__) && (defined(__ARM_NEON) || defined(_M_ARM64))
+// NEON is part of the AArch64 baseline
+#define ABCG_IMAGE_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Row and pixel kernels. Pixels are tightly packed and, except for
+// expandRGBToRGBA, source and destination may be the same buffer
+struct Kernels {
+  void (*swapRows)(std::byte *first, std::byte *second, std::size_t size);
+  void (*reversePixels)(std::byte *row, std::size_t count,
+                        std::size_t bytesPerPixel);
+  void (*expandRGBToRGBA)(std::byte const *source, std::byte *destination,
+                          std::size_t count);
+  void (*swizzleRedBlue)(std::byte const *source, std::byte *destination,
+                         std::size_t count, std::size_t bytesPerPixel);
+  void (*premultiplyAlpha)(std::byte const *source, std::byte *destination,
+                           std::size_t count);
+  std::string_view name;
+};
+
+[[nodiscard]] unsigned toUnsigned(std::byte value) {
+  return std::to_integer<unsigned>(value);
+}
+
+// Scalar kernels, also used for the pixels left over by the vector ones.
+// Some are unused on targets where all kernels are vectorized
+
+void swapRowsScalar(std::byte *first, std::byte *second, std::size_t size) {
+  std::swap_ranges(first, first + size, second);
+}
+
+// Reverses the order of pixels [first, last) of a row
+void reverseRange(std::byte *row, std::size_t first, std::size_t last,
+                  std::size_t bytesPerPixel) {
+  while (last - first > 1) {
+    --last;
+    std::swap_ranges(row + first * bytesPerPixel,
+                     row + (first + 1) * bytesPerPixel,
+                     row + last * bytesPerPixel);
+    ++first;
+  }
+}
+
+void reversePixelsScalar(std::byte *row, std::size_t count,
+                         std::size_t bytesPerPixel) {
+  reverseRange(row, 0, count, bytesPerPixel);
+}
+
+// Converts pixels [first, count)
+void expandTail(std::byte const *source, std::byte *destination,
+                std::size_t first, std::size_t count) {
+  for (auto index{first}; index < count; ++index) {
+    std::copy_n(source + index * 3, 3, destination + index * 4);
+    destination[index * 4 + 3] = std::byte{0xFF};
+  }
+}
+
+[[maybe_unused]] void expandScalar(std::byte const *source,
+                                   std::byte *destination, std::size_t count) {
+  expandTail(source, destination, 0, count);
+}
+
+void swizzleTail(std::byte const *source, std::byte *destination,
+                 std::size_t first, std::size_t count,
+                 std::size_t bytesPerPixel) {
+  for (auto index{first}; index < count; ++index) {
+    auto const *const pixel{source + index * bytesPerPixel};
+    auto const red{pixel[0]};
+    auto const blue{pixel[2]};
+    std::copy_n(pixel, bytesPerPixel, destination + index * bytesPerPixel);
+    destination[index * bytesPerPixel] = blue;
+    destination[index * bytesPerPixel + 2] = red;
+  }
+}
+
+[[maybe_unused]] void swizzleScalar(std::byte const *source,
+                                    std::byte *destination, std::size_t count,
+                                    std::size_t bytesPerPixel) {
+  swizzleTail(source, destination, 0, count, bytesPerPixel);
+}
+
+// Computes round(color * alpha / 255) without a division
+void premultiplyTail(std::byte const *source, std::byte *destination,
+                     std::size_t first, std::size_t count) {
+  for (auto index{first}; index < count; ++index) {
+    auto const alpha{toUnsigned(source[index * 4 + 3])};
+    for (auto const channel : iter::range(3UL)) {
+      auto const product{toUnsigned(source[index * 4 + channel]) * alpha +
+                         128};
+      destination[index * 4 + channel] =
+          gsl::narrow_cast<std::byte>((product + (product >> 8)) >> 8);
+    }
+    destination[index * 4 + 3] = source[index * 4 + 3];
+  }
+}
+
+[[maybe_unused]] void premultiplyScalar(std::byte const *source,
+                                        std::byte *destination,
+                                        std::size_t count) {
+  premultiplyTail(source, destination, 0, count);
+}
+
+#if defined(ABCG_IMAGE_KERNEL_SSE2)
+void swapRowsSSE2(std::byte *first, std::byte *second, std::size_t size) {
+  std::size_t index{};
+  for (; index + 16 <= size; index += 16) {
+    auto *const lhs{reinterpret_cast<__m128i *>(first + index)};
+    auto *const rhs{reinterpret_cast<__m128i *>(second + index)};
+    auto const lhsBytes{_mm_loadu_si128(lhs)};
+    _mm_storeu_si128(lhs, _mm_loadu_si128(rhs));
+    _mm_storeu_si128(rhs, lhsBytes);
+  }
+  swapRowsScalar(first + index, second + index, size - index);
+}
+
+// SSE2 has no byte shuffle, so 3-byte pixels are reversed by the scalar loop
+void reversePixelsSSE2(std::byte *row, std::size_t count,
+                       std::size_t bytesPerPixel) {
+  if (bytesPerPixel != 4) {
+    reversePixelsScalar(row, count, bytesPerPixel);
+    return;
+  }
+
+  // Swap 4 pixels from each end per iteration
+  std::size_t left{};
+  auto right{count};
+  for (; right - left >= 8; left += 4, right -= 4) {
+    auto *const lhs{reinterpret_cast<__m128i *>(row + left * 4)};
+    auto *const rhs{reinterpret_cast<__m128i *>(row + (right - 4) * 4)};
+    auto const lhsPixels{_mm_loadu_si128(lhs)};
+    auto const rhsPixels{_mm_loadu_si128(rhs)};
+    _mm_storeu_si128(lhs, _mm_shuffle_epi32(rhsPixels, 0x1B));
+    _mm_storeu_si128(rhs, _mm_shuffle_epi32(lhsPixels, 0x1B));
+  }
+  reverseRange(row, left, right, 4);
+}
+
+void swizzleSSE2(std::byte const *source, std::byte *destination,
+                 std::size_t count, std::size_t bytesPerPixel) {
+  if (bytesPerPixel != 4) {
+    swizzleScalar(source, destination, count, bytesPerPixel);
+    return;
+  }
+
+  auto const greenAlpha{_mm_set1_epi32(static_cast<int>(0xFF00FF00U))};
+  auto const lowByte{_mm_set1_epi32(0xFF)};
+  std::size_t index{};
+  for (; index + 4 <= count; index += 4) {
+    auto const pixels{_mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(source + index * 4))};
+    auto const red{_mm_and_si128(pixels, lowByte)};
+    auto const blue{_mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte)};
+    auto const swizzled{
+        _mm_or_si128(_mm_and_si128(pixels, greenAlpha),
+                     _mm_or_si128(blue, _mm_slli_epi32(red, 16)))};
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + index * 4),
+                     swizzled);
+  }
+  swizzleTail(source, destination, index, count, 4);
+}
+
+// Premultiplies two pixels widened to 16-bit channels
+__m128i premultiplyWideSSE2(__m128i pixels) {
+  auto const alphaLanes{_mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0)};
+  auto const alpha{
+      _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xFF), 0xFF)};
+  auto const product{
+      _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128))};
+  auto const premultiplied{
+      _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8)};
+  return _mm_or_si128(_mm_andnot_si128(alphaLanes, premultiplied),
+                      _mm_and_si128(alphaLanes, pixels));
+}
+
+void premultiplySSE2(std::byte const *source, std::byte *destination,
+                     std::size_t count) {
+  auto const zero{_mm_setzero_si128()};
+  std::size_t index{};
+  for (; index + 4 <= count; index += 4) {
+    auto const pixels{_mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(source + index * 4))};
+    auto const low{premultiplyWideSSE2(_mm_unpacklo_epi8(pixels, zero))};
+    auto const high{premultiplyWideSSE2(_mm_unpackhi_epi8(pixels, zero))};
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + index * 4),
+                     _mm_packus_epi16(low, high));
+  }
+  premultiplyTail(source, destination, index, count);
+}
+#endif
+
+#if defined(ABCG_IMAGE_KERNEL_AVX2)
+__attribute__((target("avx2"))) void
+swapRowsAVX2(std::byte *first, std::byte *second, std::size_t size) {
+  std::size_t index{};
+  for (; index + 32 <= size; index += 32) {
+    auto *const lhs{reinterpret_cast<__m256i *>(first + index)};
+    auto *const rhs{reinterpret_cast<__m256i *>(second + index)};
+    auto const lhsBytes{_mm256_loadu_si256(lhs)};
+    _mm256_storeu_si256(lhs, _mm256_loadu_si256(rhs));
+    _mm256_storeu_si256(rhs, lhsBytes);
+  }
+  _mm256_zeroupper();
+
+  swapRowsScalar(first + index, second + index, size - index);
+}
+
+__attribute__((target("avx2"))) void
+reversePixelsAVX2(std::byte *row, std::size_t count,
+                  std::size_t bytesPerPixel) {
+  if (bytesPerPixel != 4) {
+    reversePixelsScalar(row, count, bytesPerPixel);
+    return;
+  }
+
+  // Swap 8 pixels from each end per iteration
+  auto const reversed{_mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)};
+  std::size_t left{};
+  auto right{count};
+  for (; right - left >= 16; left += 8, right -= 8) {
+    auto *const lhs{reinterpret_cast<__m256i *>(row + left * 4)};
+    auto *const rhs{reinterpret_cast<__m256i *>(row + (right - 8) * 4)};
+    auto const lhsPixels{_mm256_loadu_si256(lhs)};
+    auto const rhsPixels{_mm256_loadu_si256(rhs)};
+    _mm256_storeu_si256(lhs, _mm256_permutevar8x32_epi32(rhsPixels, reversed));
+    _mm256_storeu_si256(rhs, _mm256_permutevar8x32_epi32(lhsPixels, reversed));
+  }
+  _mm256_zeroupper();
+
+  reverseRange(row, left, right, 4);
+}
+
+__attribute__((target("avx2"))) void
+expandAVX2(std::byte const *source, std::byte *destination,
+           std::size_t count) {
+  // Spread each group of 3 bytes to 4 and set the alpha byte
+  auto const spread{_mm256_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, //
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+  auto const alpha{_mm256_set1_epi32(static_cast<int>(0xFF000000U))};
+
+  // Each iteration reads 28 bytes, so stop 10 pixels before the end
+  std::size_t index{};
+  for (; index + 10 <= count; index += 8) {
+    auto const low{_mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(source + index * 3))};
+    auto const high{_mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(source + index * 3 + 12))};
+    auto const pixels{
+        _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1)};
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(destination + index * 4),
+        _mm256_or_si256(_mm256_shuffle_epi8(pixels, spread), alpha));
+  }
+  _mm256_zeroupper();
+
+  expandTail(source, destination, index, count);
+}
+
+__attribute__((target("avx2"))) void
+swizzleAVX2(std::byte const *source, std::byte *destination,
+            std::size_t count, std::size_t bytesPerPixel) {
+  if (bytesPerPixel != 4) {
+    swizzleScalar(source, destination, count, bytesPerPixel);
+    return;
+  }
+
+  auto const swap{_mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14,
+                                   13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9,
+                                   8, 11, 14, 13, 12, 15)};
+  std::size_t index{};
+  for (; index + 8 <= count; index += 8) {
+    auto const pixels{_mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(source + index * 4))};
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + index * 4),
+                        _mm256_shuffle_epi8(pixels, swap));
+  }
+  _mm256_zeroupper();
+
+  swizzleTail(source, destination, index, count, 4);
+}
+
+__attribute__((target("avx2"))) __m256i premultiplyWideAVX2(__m256i pixels) {
+  auto const alphaLanes{_mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0,
+                                         0, -1, 0, 0, 0)};
+  auto const alpha{
+      _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, 0xFF), 0xFF)};
+  auto const product{_mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha),
+                                      _mm256_set1_epi16(128))};
+  auto const premultiplied{_mm256_srli_epi16(
+      _mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8)};
+  return _mm256_blendv_epi8(premultiplied, pixels, alphaLanes);
+}
+
+__attribute__((target("avx2"))) void
+premultiplyAVX2(std::byte const *source, std::byte *destination,
+                std::size_t count) {
+  // Unpacking and packing work within 128-bit lanes, so pixels keep their
+  // order
+  auto const zero{_mm256_setzero_si256()};
+  std::size_t index{};
+  for (; index + 8 <= count; index += 8) {
+    auto const pixels{_mm256_loadu_si256(
+        reinterpret_cast<__m256i const *>(source + index * 4))};
+    auto const low{premultiplyWideAVX2(_mm256_unpacklo_epi8(pixels, zero))};
+    auto const high{premultiplyWideAVX2(_mm256_unpackhi_epi8(pixels, zero))};
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + index * 4),
+                        _mm256_packus_epi16(low, high));
+  }
+  _mm256_zeroupper();
+
+  premultiplyTail(source, destination, index, count);
+}
+#endif
+
+#if defined(ABCG_IMAGE_KERNEL_NEON)
+[[nodiscard]] std::uint8_t *toBytes(std::byte *pointer) {
+  return reinterpret_cast<std::uint8_t *>(pointer);
+}
+
+[[nodiscard]] std::uint8_t const *toBytes(std::byte const *pointer) {
+  return reinterpret_cast<std::uint8_t const *>(pointer);
+}
+
+[[nodiscard]] uint8x16_t reverseBytes(uint8x16_t bytes) {
+  auto const reversedHalves{vrev64q_u8(bytes)};
+  return vcombine_u8(vget_high_u8(reversedHalves),
+                     vget_low_u8(reversedHalves));
+}
+
+void swapRowsNEON(std::byte *first, std::byte *second, std::size_t size) {
+  std::size_t index{};
+  for (; index + 16 <= size; index += 16) {
+    auto const lhsBytes{vld1q_u8(toBytes(first + index))};
+    vst1q_u8(toBytes(first + index), vld1q_u8(toBytes(second + index)));
+    vst1q_u8(toBytes(second + index), lhsBytes);
+  }
+  swapRowsScalar(first + index, second + index, size - index);
+}
+
+// Loads 16 pixels deinterleaved into one register per channel, and stores
+// them in reverse order
+template <std::size_t bytesPerPixel>
+void reverseDeinterleavedNEON(std::byte *row, std::size_t count) {
+  std::size_t left{};
+  auto right{count};
+  for (; right - left >= 32; left += 16, right -= 16) {
+    auto *const lhs{toBytes(row + left * bytesPerPixel)};
+    auto *const rhs{toBytes(row + (right - 16) * bytesPerPixel)};
+    if constexpr (bytesPerPixel == 4) {
+      auto lhsPixels{vld4q_u8(lhs)};
+      auto rhsPixels{vld4q_u8(rhs)};
+      for (auto const channel : iter::range(bytesPerPixel)) {
+        lhsPixels.val[channel] = reverseBytes(lhsPixels.val[channel]);
+        rhsPixels.val[channel] = reverseBytes(rhsPixels.val[channel]);
+      }
+      vst4q_u8(lhs, rhsPixels);
+      vst4q_u8(rhs, lhsPixels);
+    } else {
+      auto lhsPixels{vld3q_u8(lhs)};
+      auto rhsPixels{vld3q_u8(rhs)};
+      for (auto const channel : iter::range(bytesPerPixel)) {
+        lhsPixels.val[channel] = reverseBytes(lhsPixels.val[channel]);
+        rhsPixels.val[channel] = reverseBytes(rhsPixels.val[channel]);
+      }
+      vst3q_u8(lhs, rhsPixels);
+      vst3q_u8(rhs, lhsPixels);
+    }
+  }
+  reverseRange(row, left, right, bytesPerPixel);
+}
+
+void reversePixelsNEON(std::byte *row, std::size_t count,
+                       std::size_t bytesPerPixel) {
+  if (bytesPerPixel == 4) {
+    reverseDeinterleavedNEON<4>(row, count);
+  } else if (bytesPerPixel == 3) {
+    reverseDeinterleavedNEON<3>(row, count);
+  } else {
+    reversePixelsScalar(row, count, bytesPerPixel);
+  }
+}
+
+void expandNEON(std::byte const *source, std::byte *destination,
+                std::size_t count) {
+  std::size_t index{};
+  for (; index + 16 <= count; index += 16) {
+    auto const pixels{vld3q_u8(toBytes(source + index * 3))};
+    uint8x16x4_t const expanded{
+        {pixels.val[0], pixels.val[1], pixels.val[2], vdupq_n_u8(0xFF)}};
+    vst4q_u8(toBytes(destination + index * 4), expanded);
+  }
+  expandTail(source, destination, index, count);
+}
+
+void swizzleNEON(std::byte const *source, std::byte *destination,
+                 std::size_t count, std::size_t bytesPerPixel) {
+  std::size_t index{};
+  if (bytesPerPixel == 4) {
+    for (; index + 16 <= count; index += 16) {
+      auto pixels{vld4q_u8(toBytes(source + index * 4))};
+      std::swap(pixels.val[0], pixels.val[2]);
+      vst4q_u8(toBytes(destination + index * 4), pixels);
+    }
+  } else if (bytesPerPixel == 3) {
+    for (; index + 16 <= count; index += 16) {
+      auto pixels{vld3q_u8(toBytes(source + index * 3))};
+      std::swap(pixels.val[0], pixels.val[2]);
+      vst3q_u8(toBytes(destination + index * 3), pixels);
+    }
+  }
+  swizzleTail(source, destination, index, count, bytesPerPixel);
+}
+
+// Same rounding as premultiplyTail: (x + ((x + 128) >> 8) + 128) >> 8
+[[nodiscard]] uint8x8_t divideBy255(uint16x8_t product) {
+  return vraddhn_u16(product, vrshrq_n_u16(product, 8));
+}
+
+void premultiplyNEON(std::byte const *source, std::byte *destination,
+                     std::size_t count) {
+  std::size_t index{};
+  for (; index + 16 <= count; index += 16) {
+    auto pixels{vld4q_u8(toBytes(source + index * 4))};
+    auto const alphaLow{vget_low_u8(pixels.val[3])};
+    auto const alphaHigh{vget_high_u8(pixels.val[3])};
+    for (auto const channel : iter::range(3)) {
+      auto const color{pixels.val[channel]};
+      pixels.val[channel] =
+          vcombine_u8(divideBy255(vmull_u8(vget_low_u8(color), alphaLow)),
+                      divideBy255(vmull_u8(vget_high_u8(color), alphaHigh)));
+    }
+    vst4q_u8(toBytes(destination + index * 4), pixels);
+  }
+  premultiplyTail(source, destination, index, count);
+}
+#endif
+
+[[nodiscard]] Kernels selectKernels() {
+#if defined(ABCG_IMAGE_KERNEL_AVX2)
+  if (__builtin_cpu_supports("avx2")) {
+    return {swapRowsAVX2, reversePixelsAVX2, expandAVX2, swizzleAVX2,
+            premultiplyAVX2, "AVX2"};
+  }
+#endif
+#if defined(ABCG_IMAGE_KERNEL_SSE2)
+  // SSE2 is part of the x86-64 baseline. It has no byte shuffle for the
+  // expansion from RGB to RGBA
+  return {swapRowsSSE2, reversePixelsSSE2, expandScalar, swizzleSSE2,
+          premultiplySSE2, "SSE2"};
+#elif defined(ABCG_IMAGE_KERNEL_NEON)
+  return {swapRowsNEON, reversePixelsNEON, expandNEON, swizzleNEON,
+          premultiplyNEON, "NEON"};
+#else
+  return {swapRowsScalar, reversePixelsScalar, expandScalar, swizzleScalar,
+          premultiplyScalar, "scalar"};
+#endif
+}
+
+[[nodiscard]] Kernels const &kernels() {
+  static Kernels const selected{selectKernels()};
+  return selected;
+}
+
+// Row y of a surface, without the padding at the end
+[[nodiscard]] std::span<std::byte> getRow(SDL_Surface &surface, int y) {
+  auto const bytesPerPixel{
+      gsl::narrow<std::size_t>(surface.format->BytesPerPixel)};
+  return {static_cast<std::byte *>(surface.pixels) +
+              gsl::narrow<std::size_t>(y * surface.pitch),
+          gsl::narrow<std::size_t>(surface.w) * bytesPerPixel};
+}
+} // namespace
 
 /**
  * @brief Flips an image horizontally.
@@ -24,33 +508,13 @@
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipHorizontally(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         widthInBytes * height};
-
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(gsl::narrow<std::size_t>(widthInBytes), {});
+  auto const bytesPerPixel{
+      gsl::narrow<std::size_t>(surface.format->BytesPerPixel)};
 
   SDL_LockSurface(&surface);
 
-  // For each row
-  for (auto const rowIndex : iter::range(height)) {
-    auto const rowStart{widthInBytes * rowIndex};
-    auto const rowEnd{rowStart + widthInBytes};
-    // For each pixel (RGB/RGA) of current row
-    auto srcBegin{pixels.begin() + gsl::narrow<long>(rowEnd)};
-    auto dstBegin{pixelRow.begin()};
-    for ([[maybe_unused]] auto const pixelIndex : iter::range(surface.w)) {
-      srcBegin -= bytesPerPixel;
-      std::copy(srcBegin, srcBegin + bytesPerPixel, dstBegin);
-      dstBegin += bytesPerPixel;
-    }
-    // std::ranges::copy(pixelRow, pixels.subspan(rowStart).begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              pixels.subspan(rowStart).begin());
+  for (auto const rowIndex : iter::range(surface.h)) {
+    reversePixels(getRow(surface, rowIndex), bytesPerPixel);
   }
 
   SDL_UnlockSurface(&surface);
@@ -59,44 +523,193 @@ void abcg::flipHorizontally(SDL_Surface &surface) {
 /**
  * @brief Flips an image vertically.
  *
- * Reverses each column of the image, in place.
+ * Reverses each column of the image, in place, by swapping rows.
  *
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipVertically(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         gsl::narrow<std::size_t>(widthInBytes * height)};
+  SDL_LockSurface(&surface);
 
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(widthInBytes, std::byte{});
+  // If height is odd, won't swap the middle row
+  for (auto const rowIndex : iter::range(surface.h / 2)) {
+    swapRows(getRow(surface, rowIndex),
+             getRow(surface, surface.h - rowIndex - 1));
+  }
+
+  SDL_UnlockSurface(&surface);
+}
+
+/**
+ * @brief Multiplies the color channels of an image by its alpha channel, in
+ * place.
+ *
+ * @param surface SDL surface of a RGBA32 or BGRA32 image. Surfaces of other
+ * formats are left unchanged.
+ */
+void abcg::premultiplyAlpha(SDL_Surface &surface) {
+  if (surface.format->format != SDL_PIXELFORMAT_RGBA32 &&
+      surface.format->format != SDL_PIXELFORMAT_BGRA32)
+    return;
 
   SDL_LockSurface(&surface);
 
-  // If height is odd, won't swap the middle row
-  for (auto const halfHeight{height / 2};
-       auto const rowIndex : iter::range(halfHeight)) {
-    auto const rowStartFromTop{widthInBytes * rowIndex};
-    auto const rowStartFromBottom{widthInBytes * (height - rowIndex - 1)};
-
-    auto const &topSpan{pixels.subspan(rowStartFromTop)};
-    auto const &bottomSpan{pixels.subspan(rowStartFromBottom)};
-
-    // std::ranges::copy(topSpan.subspan(0, widthInBytes), pixelRow.begin());
-    // std::ranges::copy(bottomSpan.subspan(0, widthInBytes), topSpan.begin());
-    // std::ranges::copy(pixelRow, bottomSpan.begin());
-    std::copy(topSpan.begin(),
-              topSpan.begin() + gsl::narrow<long>(widthInBytes),
-              pixelRow.begin());
-    std::copy(bottomSpan.begin(),
-              bottomSpan.begin() + gsl::narrow<long>(widthInBytes),
-              topSpan.begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              bottomSpan.begin());
+  for (auto const rowIndex : iter::range(surface.h)) {
+    auto const row{getRow(surface, rowIndex)};
+    premultiplyAlpha(row, row);
   }
 
   SDL_UnlockSurface(&surface);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Converts an image to RGB24 or RGBA32.
+ *
+ * Unlike `SDL_ConvertSurfaceFormat`, the surface is returned as is if it
+ * already has the requested format, which is the common case for images
+ * loaded with `IMG_Load`. Conversions from RGB24, BGR24 and BGRA32 use the
+ * vectorized kernels of this file. Other formats, and surfaces with a colour
+ * key, are converted by SDL.
+ *
+ * Rows of the returned surface are padded to a multiple of 4 bytes, so that
+ * it can be uploaded with the default pixel unpack alignment.
+ *
+ * @param surface SDL surface of the image. The function takes ownership of
+ * the surface, and frees it if another surface is returned.
+ * @param pixelFormat Either `SDL_PIXELFORMAT_RGB24` or
+ * `SDL_PIXELFORMAT_RGBA32`.
+ *
+ * @return Pointer to the converted surface, or nullptr if the conversion
+ * failed.
+ */
+SDL_Surface *abcg::convertSurface(SDL_Surface *surface, Uint32 pixelFormat) {
+  if (surface == nullptr)
+    return nullptr;
+
+  // Colour-keyed pixels must become transparent, which only SDL handles
+  if (SDL_HasColorKey(surface) == SDL_TRUE) {
+    auto *const converted{SDL_ConvertSurfaceFormat(surface, pixelFormat, 0)};
+    SDL_FreeSurface(surface);
+    return converted;
+  }
+
+  auto const sourceFormat{surface->format->format};
+  auto const bytesPerPixel{pixelFormat == SDL_PIXELFORMAT_RGB24 ? 3 : 4};
+  auto const pitch{(surface->w * bytesPerPixel + 3) & ~3};
+  if (sourceFormat == pixelFormat && surface->pitch == pitch) {
+    return surface;
+  }
+
+  auto const sameFormat{sourceFormat == pixelFormat};
+  auto const expand{sourceFormat == SDL_PIXELFORMAT_RGB24 &&
+                    pixelFormat == SDL_PIXELFORMAT_RGBA32};
+  auto const swizzle{(sourceFormat == SDL_PIXELFORMAT_BGR24 &&
+                      pixelFormat == SDL_PIXELFORMAT_RGB24) ||
+                     (sourceFormat == SDL_PIXELFORMAT_BGRA32 &&
+                      pixelFormat == SDL_PIXELFORMAT_RGBA32)};
+  if (!sameFormat && !expand && !swizzle) {
+    auto *const converted{SDL_ConvertSurfaceFormat(surface, pixelFormat, 0)};
+    SDL_FreeSurface(surface);
+    return converted;
+  }
+
+  auto *const converted{SDL_CreateRGBSurfaceWithFormat(
+      0, surface->w, surface->h, bytesPerPixel * 8, pixelFormat)};
+  if (converted != nullptr) {
+    SDL_LockSurface(surface);
+    SDL_LockSurface(converted);
+    for (auto const rowIndex : iter::range(surface->h)) {
+      auto const source{getRow(*surface, rowIndex)};
+      auto const destination{getRow(*converted, rowIndex)};
+      if (expand) {
+        expandRGBToRGBA(source, destination);
+      } else if (swizzle) {
+        swizzleRedBlue(source, destination,
+                       gsl::narrow<std::size_t>(bytesPerPixel));
+      } else {
+        std::ranges::copy(source, destination.begin());
+      }
+    }
+    SDL_UnlockSurface(converted);
+    SDL_UnlockSurface(surface);
+  }
+  SDL_FreeSurface(surface);
+  return converted;
+}
+
+/**
+ * @brief Swaps the contents of two rows of pixels.
+ *
+ * @param first First row.
+ * @param second Second row, with at least the size of @a first. The rows must
+ * not overlap.
+ */
+void abcg::swapRows(std::span<std::byte> first, std::span<std::byte> second) {
+  kernels().swapRows(first.data(), second.data(), first.size());
+}
+
+/**
+ * @brief Reverses the order of the pixels of a row, in place.
+ *
+ * @param row Row of pixels.
+ * @param bytesPerPixel Size of each pixel, in bytes.
+ */
+void abcg::reversePixels(std::span<std::byte> row, std::size_t bytesPerPixel) {
+  kernels().reversePixels(row.data(), row.size() / bytesPerPixel,
+                          bytesPerPixel);
+}
+
+/**
+ * @brief Converts a row of RGB pixels to RGBA, with an opaque alpha channel.
+ *
+ * @param source Row of RGB pixels.
+ * @param destination Row of RGBA pixels, with room for all pixels of
+ * @a source. It must not overlap @a source.
+ */
+void abcg::expandRGBToRGBA(std::span<std::byte const> source,
+                           std::span<std::byte> destination) {
+  kernels().expandRGBToRGBA(source.data(), destination.data(),
+                            source.size() / 3);
+}
+
+/**
+ * @brief Swaps the red and blue channels of a row of pixels, converting from
+ * BGR(A) to RGB(A) and vice versa.
+ *
+ * @param source Row of pixels.
+ * @param destination Row of pixels with the size of @a source. It may be the
+ * same row as @a source.
+ * @param bytesPerPixel Either 3 or 4.
+ */
+void abcg::swizzleRedBlue(std::span<std::byte const> source,
+                          std::span<std::byte> destination,
+                          std::size_t bytesPerPixel) {
+  kernels().swizzleRedBlue(source.data(), destination.data(),
+                           source.size() / bytesPerPixel, bytesPerPixel);
+}
+
+/**
+ * @brief Multiplies the color channels of a row of pixels by their alpha
+ * channel.
+ *
+ * Each channel is rounded to the nearest integer of color * alpha / 255.
+ *
+ * @param source Row of RGBA or BGRA pixels.
+ * @param destination Row of pixels with the size of @a source. It may be the
+ * same row as @a source.
+ */
+void abcg::premultiplyAlpha(std::span<std::byte const> source,
+                            std::span<std::byte> destination) {
+  kernels().premultiplyAlpha(source.data(), destination.data(),
+                             source.size() / 4);
+}
+
+/**
+ * @brief Returns the name of the instruction set used by the image kernels.
+ *
+ * The kernels are selected at runtime: AVX2 if supported by the CPU, or else
+ * SSE2 on x86-64, NEON on ARM64, and scalar code on other targets such as
+ * WebAssembly.
+ *
+ * @return "AVX2", "SSE2", "NEON" or "scalar".
+ */
+std::string_view abcg::getImageKernelName() { return kernels().name; }
@@ -13,9 +13,27 @@
 
 #include <SDL_image.h>
 
+#include <cstddef>
+#include <span>
+#include <string_view>
+
 namespace abcg {
 void flipHorizontally(SDL_Surface &surface);
 void flipVertically(SDL_Surface &surface);
+void premultiplyAlpha(SDL_Surface &surface);
+[[nodiscard]] SDL_Surface *convertSurface(SDL_Surface *surface,
+                                          Uint32 pixelFormat);
+
+void swapRows(std::span<std::byte> first, std::span<std::byte> second);
+void reversePixels(std::span<std::byte> row, std::size_t bytesPerPixel);
+void expandRGBToRGBA(std::span<std::byte const> source,
+                     std::span<std::byte> destination);
+void swizzleRedBlue(std::span<std::byte const> source,
+                    std::span<std::byte> destination,
+                    std::size_t bytesPerPixel);
+void premultiplyAlpha(std::span<std::byte const> source,
+                      std::span<std::byte> destination);
+[[nodiscard]] std::string_view getImageKernelName();
 } // namespace abcg
 
 #endif
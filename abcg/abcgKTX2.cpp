@@ -0,0 +1,416 @@
+/**
+ * @file abcgKTX2.cpp
+ * @brief Definition of KTX2 texture file helper functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgKTX2.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <string>
+
+#include "abcgException.hpp"
+
+namespace {
+// «KTX 20»\r\n\x1A\n
+constexpr std::array<uint8_t, 12> identifier{0xAB, 0x4B, 0x54, 0x58,
+                                             0x20, 0x32, 0x30, 0xBB,
+                                             0x0D, 0x0A, 0x1A, 0x0A};
+
+// Identifier, header and index
+constexpr std::size_t headerSize{80};
+constexpr std::size_t levelIndexEntrySize{24};
+
+// Fields of the data format descriptor (Khronos Data Format Specification)
+constexpr uint8_t colorModelRGBSDA{1};
+constexpr uint8_t colorModelBC1A{128};
+constexpr uint8_t colorModelBC3{130};
+constexpr uint8_t colorPrimariesBT709{1};
+constexpr uint8_t transferLinear{1};
+constexpr uint8_t transferSRGB{2};
+constexpr uint8_t channelAlpha{15};
+constexpr uint8_t qualifierLinear{1U << 4U};
+
+// Multi-byte values of KTX2 files are little-endian, as on all platforms
+// supported by ABCg
+template <typename T>
+[[nodiscard]] T read(std::vector<std::byte> const &file, std::size_t offset) {
+  if (offset + sizeof(T) > file.size()) {
+    throw abcg::RuntimeError("Unexpected end of KTX2 file");
+  }
+  T value{};
+  std::memcpy(&value, file.data() + offset, sizeof(T));
+  return value;
+}
+
+template <typename T> void write(std::vector<std::byte> &file, T value) {
+  auto const offset{file.size()};
+  file.resize(offset + sizeof(T));
+  std::memcpy(file.data() + offset, &value, sizeof(T));
+}
+
+[[nodiscard]] std::size_t getLevelSize(abcg::KTX2FormatInfo const &info,
+                                       uint32_t width, uint32_t height) {
+  auto const blocksX{(width + info.blockWidth - 1) / info.blockWidth};
+  auto const blocksY{(height + info.blockHeight - 1) / info.blockHeight};
+  return std::size_t{blocksX} * blocksY * info.bytesPerBlock;
+}
+
+struct Sample {
+  uint16_t bitOffset{};
+  uint8_t bitLength{};
+  uint8_t channelType{};
+  uint32_t upper{};
+};
+
+// Basic data format descriptor of the formats written by abcg::saveKTX2
+[[nodiscard]] std::vector<std::byte>
+createDFD(abcg::KTX2Format format, abcg::KTX2FormatInfo const &info) {
+  using abcg::KTX2Format;
+
+  uint8_t colorModel{};
+  std::vector<Sample> samples;
+  auto const alphaChannel{
+      gsl::narrow<uint8_t>(channelAlpha | (info.sRGB ? qualifierLinear : 0U))};
+  switch (format) {
+  case KTX2Format::RGBA8Unorm:
+  case KTX2Format::RGBA8Srgb:
+    colorModel = colorModelRGBSDA;
+    for (auto const channel : iter::range(uint8_t{4})) {
+      samples.push_back(
+          {.bitOffset = gsl::narrow<uint16_t>(channel * 8),
+           .bitLength = 7,
+           .channelType = channel == 3 ? alphaChannel : channel,
+           .upper = 255});
+    }
+    break;
+  case KTX2Format::BC1RGBUnorm:
+  case KTX2Format::BC1RGBSrgb:
+  case KTX2Format::BC1RGBAUnorm:
+  case KTX2Format::BC1RGBASrgb: {
+    auto const alpha{format == KTX2Format::BC1RGBAUnorm ||
+                     format == KTX2Format::BC1RGBASrgb};
+    colorModel = colorModelBC1A;
+    samples = {{.bitOffset = 0,
+                .bitLength = 63,
+                .channelType = gsl::narrow<uint8_t>(alpha ? 1 : 0),
+                .upper = 0xFFFFFFFF}};
+    break;
+  }
+  case KTX2Format::BC3Unorm:
+  case KTX2Format::BC3Srgb:
+    colorModel = colorModelBC3;
+    samples = {{.bitOffset = 0,
+                .bitLength = 63,
+                .channelType = alphaChannel,
+                .upper = 0xFFFFFFFF},
+               {.bitOffset = 64,
+                .bitLength = 63,
+                .channelType = 0,
+                .upper = 0xFFFFFFFF}};
+    break;
+  default:
+    throw abcg::RuntimeError(
+        fmt::format("Cannot write KTX2 files of format {}",
+                    static_cast<uint32_t>(format)));
+  }
+
+  auto const blockSize{gsl::narrow<uint16_t>(24 + 16 * samples.size())};
+  std::vector<std::byte> dfd;
+  write<uint32_t>(dfd, 4U + blockSize);
+  write<uint32_t>(dfd, 0); // Khronos vendor, basic descriptor type
+  write<uint16_t>(dfd, 2); // Version 1.3
+  write<uint16_t>(dfd, blockSize);
+  write<uint8_t>(dfd, colorModel);
+  write<uint8_t>(dfd, colorPrimariesBT709);
+  write<uint8_t>(dfd, info.sRGB ? transferSRGB : transferLinear);
+  write<uint8_t>(dfd, 0); // Straight alpha
+  write<uint8_t>(dfd, gsl::narrow<uint8_t>(info.blockWidth - 1));
+  write<uint8_t>(dfd, gsl::narrow<uint8_t>(info.blockHeight - 1));
+  write<uint16_t>(dfd, 0);
+  write<uint8_t>(dfd, gsl::narrow<uint8_t>(info.bytesPerBlock));
+  for ([[maybe_unused]] auto const index : iter::range(7)) {
+    write<uint8_t>(dfd, 0);
+  }
+  for (auto const &sample : samples) {
+    write<uint16_t>(dfd, sample.bitOffset);
+    write<uint8_t>(dfd, sample.bitLength);
+    write<uint8_t>(dfd, sample.channelType);
+    write<uint32_t>(dfd, 0); // Sample position
+    write<uint32_t>(dfd, 0); // Lower
+    write<uint32_t>(dfd, sample.upper);
+  }
+  return dfd;
+}
+} // namespace
+
+/**
+ * @brief Returns whether a path names a KTX2 file.
+ *
+ * @param path Path of the file.
+ *
+ * @return True if the path ends with `.ktx2` (case insensitive).
+ */
+bool abcg::isKTX2Path(std::string_view path) {
+  constexpr std::string_view extension{".ktx2"};
+  if (path.size() < extension.size()) {
+    return false;
+  }
+  return std::ranges::equal(
+      path.substr(path.size() - extension.size()), extension,
+      [](char lhs, char rhs) {
+        return std::tolower(static_cast<unsigned char>(lhs)) == rhs;
+      });
+}
+
+/**
+ * @brief Returns the block layout of a KTX2 format.
+ *
+ * @param format Pixel format.
+ *
+ * @return Block layout, or `std::nullopt` if the format is not a
+ * abcg::KTX2Format.
+ */
+std::optional<abcg::KTX2FormatInfo>
+abcg::getKTX2FormatInfo(KTX2Format format) {
+  switch (format) {
+  case KTX2Format::RGBA8Unorm:
+    return KTX2FormatInfo{.bytesPerBlock = 4};
+  case KTX2Format::RGBA8Srgb:
+    return KTX2FormatInfo{.bytesPerBlock = 4, .sRGB = true};
+  case KTX2Format::BC1RGBUnorm:
+  case KTX2Format::BC1RGBAUnorm:
+  case KTX2Format::ETC2RGB8Unorm:
+    return KTX2FormatInfo{.blockWidth = 4,
+                          .blockHeight = 4,
+                          .bytesPerBlock = 8,
+                          .compressed = true};
+  case KTX2Format::BC1RGBSrgb:
+  case KTX2Format::BC1RGBASrgb:
+  case KTX2Format::ETC2RGB8Srgb:
+    return KTX2FormatInfo{.blockWidth = 4,
+                          .blockHeight = 4,
+                          .bytesPerBlock = 8,
+                          .compressed = true,
+                          .sRGB = true};
+  case KTX2Format::BC3Unorm:
+  case KTX2Format::BC5Unorm:
+  case KTX2Format::BC7Unorm:
+  case KTX2Format::ETC2RGBA8Unorm:
+  case KTX2Format::ASTC4x4Unorm:
+    return KTX2FormatInfo{.blockWidth = 4,
+                          .blockHeight = 4,
+                          .bytesPerBlock = 16,
+                          .compressed = true};
+  case KTX2Format::BC3Srgb:
+  case KTX2Format::BC7Srgb:
+  case KTX2Format::ETC2RGBA8Srgb:
+  case KTX2Format::ASTC4x4Srgb:
+    return KTX2FormatInfo{.blockWidth = 4,
+                          .blockHeight = 4,
+                          .bytesPerBlock = 16,
+                          .compressed = true,
+                          .sRGB = true};
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Loads a 2D image from a KTX2 file.
+ *
+ * Only files without supercompression, with a single face and a single layer
+ * are supported.
+ *
+ * @param path Path of the KTX2 file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be read, is not a valid KTX2
+ * file, or uses a format or feature that is not supported.
+ *
+ * @return Image with all mipmap levels stored in the file.
+ */
+abcg::KTX2Image abcg::loadKTX2(std::string_view path) {
+  std::ifstream stream{std::string{path}, std::ios::binary};
+  if (!stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to open texture file {}", path));
+  }
+  std::vector<std::byte> file;
+  std::transform(std::istreambuf_iterator<char>{stream},
+                 std::istreambuf_iterator<char>{}, std::back_inserter(file),
+                 [](char value) { return static_cast<std::byte>(value); });
+
+  if (file.size() < headerSize ||
+      std::memcmp(file.data(), identifier.data(), identifier.size()) != 0) {
+    throw abcg::RuntimeError(fmt::format("{} is not a KTX2 file", path));
+  }
+
+  auto const vkFormat{read<uint32_t>(file, 12)};
+  auto const width{read<uint32_t>(file, 20)};
+  auto const height{read<uint32_t>(file, 24)};
+  auto const depth{read<uint32_t>(file, 28)};
+  auto const layerCount{read<uint32_t>(file, 32)};
+  auto const faceCount{read<uint32_t>(file, 36)};
+  auto const levelCount{std::max(read<uint32_t>(file, 40), 1U)};
+  auto const supercompressionScheme{read<uint32_t>(file, 44)};
+
+  if (depth > 1 || layerCount > 1 || faceCount != 1 || width == 0 ||
+      height == 0) {
+    throw abcg::RuntimeError(
+        fmt::format("{} is not a 2D KTX2 texture", path));
+  }
+  if (supercompressionScheme != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Supercompressed KTX2 file {} is not supported", path));
+  }
+
+  KTX2Image image{.format = static_cast<KTX2Format>(vkFormat), .levels = {}};
+  auto const info{getKTX2FormatInfo(image.format)};
+  if (!info.has_value()) {
+    throw abcg::RuntimeError(fmt::format(
+        "Format {} of KTX2 file {} is not supported", vkFormat, path));
+  }
+
+  // A full mipmap chain has floor(log2(max(width, height))) + 1 levels, and
+  // the level index must fit in the file
+  if (levelCount > std::bit_width(std::max(width, height)) ||
+      headerSize + std::size_t{levelCount} * levelIndexEntrySize >
+          file.size()) {
+    throw abcg::RuntimeError(fmt::format(
+        "Invalid level count {} in KTX2 file {}", levelCount, path));
+  }
+
+  image.levels.resize(levelCount);
+  for (auto &&[index, level] : iter::enumerate(image.levels)) {
+    auto const entry{headerSize + index * levelIndexEntrySize};
+    auto const byteOffset{read<uint64_t>(file, entry)};
+    auto const byteLength{read<uint64_t>(file, entry + 8)};
+
+    level.width = std::max(width >> index, 1U);
+    level.height = std::max(height >> index, 1U);
+    auto const size{getLevelSize(info.value(), level.width, level.height)};
+    // Written so that a huge offset cannot wrap around
+    if (byteLength < size || size > file.size() ||
+        byteOffset > file.size() - size) {
+      throw abcg::RuntimeError(
+          fmt::format("Level {} of KTX2 file {} is truncated", index, path));
+    }
+
+    auto const begin{file.begin() + gsl::narrow<std::ptrdiff_t>(byteOffset)};
+    level.data.assign(begin, begin + gsl::narrow<std::ptrdiff_t>(size));
+  }
+
+  return image;
+}
+
+/**
+ * @brief Saves a 2D image to a KTX2 file.
+ *
+ * The file has no supercompression. Levels are stored from the smallest to
+ * the largest, as recommended by the KTX2 specification.
+ *
+ * @param path Path of the KTX2 file.
+ * @param image Image to be saved. Only uncompressed RGBA8, BC1 and BC3
+ * formats can be written.
+ *
+ * @throw abcg::RuntimeError if the format cannot be written, the levels do
+ * not match the format, or the file cannot be written.
+ */
+void abcg::saveKTX2(std::string_view path, KTX2Image const &image) {
+  auto const info{getKTX2FormatInfo(image.format)};
+  if (!info.has_value() || image.levels.empty()) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid image for KTX2 file {}", path));
+  }
+  for (auto const &level : image.levels) {
+    if (level.data.size() !=
+        getLevelSize(info.value(), level.width, level.height)) {
+      throw abcg::RuntimeError(
+          fmt::format("Invalid level size for KTX2 file {}", path));
+    }
+  }
+
+  auto const dfd{createDFD(image.format, info.value())};
+
+  // Key/value data
+  constexpr std::string_view writerKey{"KTXwriter"};
+  constexpr std::string_view writerValue{"ABCg"};
+  std::vector<std::byte> kvd;
+  auto const keyAndValueSize{writerKey.size() + writerValue.size() + 2};
+  write<uint32_t>(kvd, gsl::narrow<uint32_t>(keyAndValueSize));
+  for (auto const text : {writerKey, writerValue}) {
+    std::ranges::transform(text, std::back_inserter(kvd),
+                           [](char value) { return std::byte(value); });
+    kvd.push_back(std::byte{});
+  }
+  kvd.resize((kvd.size() + 3) / 4 * 4);
+
+  auto const levelCount{image.levels.size()};
+  auto const dfdOffset{headerSize + levelCount * levelIndexEntrySize};
+  auto const kvdOffset{dfdOffset + dfd.size()};
+  auto const levelAlignment{
+      std::lcm(std::size_t{info->bytesPerBlock}, std::size_t{4})};
+
+  // Place the levels after the key/value data, smallest first
+  std::vector<std::size_t> levelOffsets(levelCount);
+  auto offset{kvdOffset + kvd.size()};
+  for (auto index{levelCount}; index-- > 0;) {
+    offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+    levelOffsets.at(index) = offset;
+    offset += image.levels.at(index).data.size();
+  }
+
+  std::vector<std::byte> file;
+  file.reserve(offset);
+  std::ranges::transform(identifier, std::back_inserter(file),
+                         [](uint8_t value) { return std::byte{value}; });
+  write<uint32_t>(file, static_cast<uint32_t>(image.format));
+  write<uint32_t>(file, 1); // typeSize
+  write<uint32_t>(file, image.levels.front().width);
+  write<uint32_t>(file, image.levels.front().height);
+  write<uint32_t>(file, 0); // pixelDepth
+  write<uint32_t>(file, 0); // layerCount
+  write<uint32_t>(file, 1); // faceCount
+  write<uint32_t>(file, gsl::narrow<uint32_t>(levelCount));
+  write<uint32_t>(file, 0); // supercompressionScheme
+  write<uint32_t>(file, gsl::narrow<uint32_t>(dfdOffset));
+  write<uint32_t>(file, gsl::narrow<uint32_t>(dfd.size()));
+  write<uint32_t>(file, gsl::narrow<uint32_t>(kvdOffset));
+  write<uint32_t>(file, gsl::narrow<uint32_t>(kvd.size()));
+  write<uint64_t>(file, 0); // sgdByteOffset
+  write<uint64_t>(file, 0); // sgdByteLength
+  for (auto &&[level, levelOffset] : iter::zip(image.levels, levelOffsets)) {
+    write<uint64_t>(file, levelOffset);
+    write<uint64_t>(file, level.data.size());
+    write<uint64_t>(file, level.data.size());
+  }
+  file.insert(file.end(), dfd.begin(), dfd.end());
+  file.insert(file.end(), kvd.begin(), kvd.end());
+  for (auto index{levelCount}; index-- > 0;) {
+    auto const &data{image.levels.at(index).data};
+    file.resize(levelOffsets.at(index));
+    file.insert(file.end(), data.begin(), data.end());
+  }
+
+  std::ofstream stream{std::string{path}, std::ios::binary};
+  stream.write(reinterpret_cast<char const *>(file.data()),
+               gsl::narrow<std::streamsize>(file.size()));
+  if (!stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to write texture file {}", path));
+  }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file abcgKTX2.hpp
+ * @brief Declaration of KTX2 texture file helper functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_KTX2_HPP_
+#define ABCG_KTX2_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+enum class KTX2Format : uint32_t;
+struct KTX2FormatInfo;
+struct KTX2Level;
+struct KTX2Image;
+
+[[nodiscard]] bool isKTX2Path(std::string_view path);
+[[nodiscard]] std::optional<KTX2FormatInfo>
+getKTX2FormatInfo(KTX2Format format);
+[[nodiscard]] KTX2Image loadKTX2(std::string_view path);
+void saveKTX2(std::string_view path, KTX2Image const &image);
+} // namespace abcg
+
+/**
+ * @brief Pixel formats of KTX2 files supported by ABCg.
+ *
+ * The values are those of the corresponding `VkFormat`, as stored in the
+ * `vkFormat` field of the KTX2 header.
+ */
+enum class abcg::KTX2Format : uint32_t {
+  /** @brief Uncompressed RGBA, 8 bits per channel. */
+  RGBA8Unorm = 37,
+  /** @brief Uncompressed RGBA, 8 bits per channel, sRGB. */
+  RGBA8Srgb = 43,
+  /** @brief BC1 (DXT1) without alpha. */
+  BC1RGBUnorm = 131,
+  /** @brief BC1 (DXT1) without alpha, sRGB. */
+  BC1RGBSrgb = 132,
+  /** @brief BC1 (DXT1) with 1-bit alpha. */
+  BC1RGBAUnorm = 133,
+  /** @brief BC1 (DXT1) with 1-bit alpha, sRGB. */
+  BC1RGBASrgb = 134,
+  /** @brief BC3 (DXT5). */
+  BC3Unorm = 137,
+  /** @brief BC3 (DXT5), sRGB. */
+  BC3Srgb = 138,
+  /** @brief BC5 (RGTC2), two channels. */
+  BC5Unorm = 141,
+  /** @brief BC7 (BPTC). */
+  BC7Unorm = 145,
+  /** @brief BC7 (BPTC), sRGB. */
+  BC7Srgb = 146,
+  /** @brief ETC2 without alpha. */
+  ETC2RGB8Unorm = 147,
+  /** @brief ETC2 without alpha, sRGB. */
+  ETC2RGB8Srgb = 148,
+  /** @brief ETC2 with EAC alpha. */
+  ETC2RGBA8Unorm = 151,
+  /** @brief ETC2 with EAC alpha, sRGB. */
+  ETC2RGBA8Srgb = 152,
+  /** @brief ASTC LDR with 4x4 blocks. */
+  ASTC4x4Unorm = 157,
+  /** @brief ASTC LDR with 4x4 blocks, sRGB. */
+  ASTC4x4Srgb = 158
+};
+
+/**
+ * @brief Block layout of a abcg::KTX2Format.
+ */
+struct abcg::KTX2FormatInfo {
+  /** @brief Width of a block in pixels (1 for uncompressed formats). */
+  uint32_t blockWidth{1};
+  /** @brief Height of a block in pixels (1 for uncompressed formats). */
+  uint32_t blockHeight{1};
+  /** @brief Size of a block in bytes. */
+  uint32_t bytesPerBlock{};
+  /** @brief Whether the format is block-compressed. */
+  bool compressed{};
+  /** @brief Whether the color channels are encoded in sRGB. */
+  bool sRGB{};
+};
+
+/**
+ * @brief Mipmap level of a abcg::KTX2Image.
+ */
+struct abcg::KTX2Level {
+  /** @brief Width of the level in pixels. */
+  uint32_t width{};
+  /** @brief Height of the level in pixels. */
+  uint32_t height{};
+  /** @brief Blocks of the level, row by row. */
+  std::vector<std::byte> data;
+};
+
+/**
+ * @brief 2D image stored in a KTX2 file.
+ */
+struct abcg::KTX2Image {
+  /** @brief Pixel format of all levels. */
+  KTX2Format format{};
+  /** @brief Mipmap levels, from the largest to the smallest. */
+  std::vector<KTX2Level> levels;
+};
+
+#endif
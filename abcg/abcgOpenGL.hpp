@@ -15,7 +15,11 @@
 
 #include "abcg.hpp"
 #include "abcgOpenGLImage.hpp"
+#include "abcgOpenGLMesh.hpp"
+#include "abcgOpenGLProgramBuilder.hpp"
 #include "abcgOpenGLShader.hpp"
+#include "abcgOpenGLTextureLoader.hpp"
+#include "abcgOpenGLUniformBuffer.hpp"
 #include "abcgOpenGLWindow.hpp"
 
 #endif
@@ -0,0 +1,588 @@
+/**
+ * @file abcgOpenGLFrameCapture.cpp
+ * @brief Definition of abcg::OpenGLFrameCapture members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLFrameCapture.hpp"
+#include "abcgImage.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <utility>
+
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+#if !defined(__EMSCRIPTEN__)
+[[nodiscard]] bool isSignaled(GLsync fence) {
+  auto const status{glClientWaitSync(fence, 0, 0)};
+  return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+#endif
+
+[[nodiscard]] std::size_t getFrameSize(glm::ivec2 const &size) {
+  return gsl::narrow<std::size_t>(size.x) * gsl::narrow<std::size_t>(size.y) *
+         4;
+}
+
+// Returns the RGBA pixels of a row, counting from the top of a frame stored
+// bottom row first
+[[nodiscard]] std::byte const *getRow(std::vector<std::byte> const &pixels,
+                                      glm::ivec2 const &size, int row) {
+  auto const rowSize{gsl::narrow<std::size_t>(size.x) * 4};
+  return pixels.data() + gsl::narrow<std::size_t>(size.y - 1 - row) * rowSize;
+}
+
+void write(std::ofstream &stream, std::vector<char> const &data,
+           std::string_view path) {
+  stream.write(data.data(), gsl::narrow<std::streamsize>(data.size()));
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+} // namespace
+
+/**
+ * @brief Destructor.
+ *
+ * Waits for the encoder thread to write the frames already handed to it.
+ * OpenGL objects are only released by abcg::OpenGLFrameCapture::destroy.
+ */
+abcg::OpenGLFrameCapture::~OpenGLFrameCapture() { stopEncoder(); }
+
+/**
+ * @brief Creates the pixel pack buffers and the encoder thread.
+ *
+ * @param pixelBufferCount Number of pixel pack buffers in the ring, i.e., the
+ * maximum number of readbacks in flight.
+ * @param maxQueuedFrames Maximum number of frames waiting to be encoded. When
+ * the queue is full, the rendering thread waits for the encoder.
+ */
+void abcg::OpenGLFrameCapture::create(std::size_t pixelBufferCount,
+                                      std::size_t maxQueuedFrames) {
+  destroy();
+
+  m_maxQueuedFrames = std::max(maxQueuedFrames, std::size_t{1});
+
+#if !defined(__EMSCRIPTEN__)
+  m_pixelBuffers.resize(std::max(pixelBufferCount, std::size_t{1}));
+  for (auto &pixelBuffer : m_pixelBuffers) {
+    glGenBuffers(1, &pixelBuffer.buffer);
+  }
+  m_nextPixelBuffer = 0;
+
+  m_stopping = false;
+  m_encoder = std::jthread{[this] { encoderLoop(); }};
+#else
+  static_cast<void>(pixelBufferCount);
+#endif
+}
+
+/**
+ * @brief Writes all pending captures, stops the recording and releases the
+ * OpenGL objects.
+ *
+ * Must be called on the thread of the OpenGL context while it is current.
+ */
+void abcg::OpenGLFrameCapture::destroy() {
+  if (!m_pixelBuffers.empty()) {
+    try {
+      flush();
+    } catch (abcg::Exception const &exception) {
+      fmt::print(stderr, "{}\n", exception.what());
+    }
+  }
+  stopEncoder();
+  m_recording.reset();
+
+  for (auto &pixelBuffer : m_pixelBuffers) {
+    if (pixelBuffer.fence != nullptr) {
+      glDeleteSync(pixelBuffer.fence);
+    }
+    glDeleteBuffers(1, &pixelBuffer.buffer);
+  }
+  m_pixelBuffers.clear();
+  m_freePixels.clear();
+  m_error.clear();
+}
+
+/**
+ * @brief Captures the framebuffer bound to `GL_READ_FRAMEBUFFER` and saves it
+ * to a PNG file.
+ *
+ * The pixels are read immediately, so the capture contains whatever has been
+ * drawn so far. The file is written later by the encoder thread.
+ *
+ * @param path Path of the PNG file.
+ * @param size Size of the region to be captured, starting at the lower left
+ * corner of the framebuffer.
+ */
+void abcg::OpenGLFrameCapture::captureScreenshot(std::string_view path,
+                                                 glm::ivec2 const &size) {
+  readPixels({.size = size,
+              .pixels = {},
+              .screenshotPath = std::string{path},
+              .recording = {}});
+}
+
+/**
+ * @brief Starts a recording.
+ *
+ * Frames are added by abcg::OpenGLFrameCapture::captureFrame. A recording
+ * already in progress is stopped.
+ *
+ * @param path Prefix of the PPM files, to which the frame number and
+ * extension are appended (e.g., `capture/frame_` gives
+ * `capture/frame_000000.ppm`), or path of the Y4M file.
+ * @param format File format.
+ * @param frameRate Frame rate stored in the Y4M header.
+ *
+ * @throw abcg::RuntimeError if the Y4M file cannot be created.
+ */
+void abcg::OpenGLFrameCapture::startRecording(std::string_view path,
+                                              CaptureFormat format,
+                                              int frameRate) {
+  stopRecording();
+
+  auto recording{std::make_shared<Recording>()};
+  recording->path = path;
+  recording->format = format;
+  recording->frameRate = std::max(frameRate, 1);
+  if (format == CaptureFormat::Y4M) {
+    recording->stream.open(recording->path, std::ios::binary);
+    if (!recording->stream) {
+      throw abcg::RuntimeError(fmt::format("Failed to create {}", path));
+    }
+  }
+  m_recording = std::move(recording);
+}
+
+/**
+ * @brief Stops the recording in progress.
+ *
+ * Frames already captured are still written. The Y4M file is closed once its
+ * last frame is written.
+ */
+void abcg::OpenGLFrameCapture::stopRecording() { m_recording.reset(); }
+
+/**
+ * @brief Captures the framebuffer bound to `GL_READ_FRAMEBUFFER` as the next
+ * frame of the recording.
+ *
+ * Does nothing if there is no recording in progress.
+ *
+ * @param size Size of the region to be captured, starting at the lower left
+ * corner of the framebuffer. All frames of a Y4M recording must have the same
+ * size.
+ */
+void abcg::OpenGLFrameCapture::captureFrame(glm::ivec2 const &size) {
+  if (!m_recording) {
+    return;
+  }
+  readPixels({.size = size,
+              .pixels = {},
+              .screenshotPath = {},
+              .recording = m_recording});
+}
+
+/**
+ * @brief Hands the completed readbacks to the encoder thread.
+ *
+ * Must be called once per frame on the thread of the OpenGL context.
+ * Readbacks still in progress are left for the next call.
+ *
+ * @throw abcg::RuntimeError if the encoder failed to write a file since the
+ * last call.
+ */
+void abcg::OpenGLFrameCapture::poll() {
+  ABCG_TRACE_ZONE("OpenGLFrameCapture::poll");
+
+#if !defined(__EMSCRIPTEN__)
+  // Complete the readbacks in the order they were issued
+  for (auto const offset : iter::range(m_pixelBuffers.size())) {
+    auto &pixelBuffer{m_pixelBuffers.at((m_nextPixelBuffer + offset) %
+                                        m_pixelBuffers.size())};
+    if (pixelBuffer.fence == nullptr) {
+      continue;
+    }
+    if (!isSignaled(pixelBuffer.fence)) {
+      break;
+    }
+    finishReadback(pixelBuffer);
+  }
+#endif
+
+  std::string error;
+  {
+    std::scoped_lock lock{m_mutex};
+    std::swap(error, m_error);
+  }
+  if (!error.empty()) {
+    throw abcg::RuntimeError(error);
+  }
+}
+
+/**
+ * @brief Waits until all captures are written.
+ *
+ * @throw abcg::RuntimeError if the encoder failed to write a file.
+ */
+void abcg::OpenGLFrameCapture::flush() {
+  ABCG_TRACE_ZONE("OpenGLFrameCapture::flush");
+
+  for (auto const offset : iter::range(m_pixelBuffers.size())) {
+    auto &pixelBuffer{m_pixelBuffers.at((m_nextPixelBuffer + offset) %
+                                        m_pixelBuffers.size())};
+    if (pixelBuffer.fence != nullptr) {
+      finishReadback(pixelBuffer);
+    }
+  }
+
+  {
+    std::unique_lock lock{m_mutex};
+    m_frameTaken.wait(lock, [this] {
+      return m_frames.empty() && m_encodingFrames == 0;
+    });
+  }
+
+  poll();
+}
+
+/**
+ * @brief Returns whether a recording is in progress.
+ *
+ * @return True if abcg::OpenGLFrameCapture::startRecording was called and the
+ * recording was not stopped.
+ */
+bool abcg::OpenGLFrameCapture::isRecording() const noexcept {
+  return m_recording != nullptr;
+}
+
+/**
+ * @brief Returns the number of captures not yet written.
+ *
+ * @return Number of readbacks in flight plus the number of frames waiting for
+ * or being processed by the encoder.
+ */
+std::size_t abcg::OpenGLFrameCapture::getPendingCount() const noexcept {
+  auto const readbacks{
+      std::ranges::count_if(m_pixelBuffers, [](auto const &pixelBuffer) {
+        return pixelBuffer.fence != nullptr;
+      })};
+  std::scoped_lock lock{m_mutex};
+  return gsl::narrow_cast<std::size_t>(readbacks) + m_frames.size() +
+         m_encodingFrames;
+}
+
+void abcg::OpenGLFrameCapture::readPixels(Frame frame) {
+  ABCG_TRACE_ZONE("OpenGLFrameCapture::readPixels");
+
+  if (frame.size.x <= 0 || frame.size.y <= 0) {
+    return;
+  }
+  auto const size{getFrameSize(frame.size)};
+
+#if defined(__EMSCRIPTEN__)
+  frame.pixels.resize(size);
+  glReadPixels(0, 0, frame.size.x, frame.size.y, GL_RGBA, GL_UNSIGNED_BYTE,
+               frame.pixels.data());
+  pushFrame(std::move(frame));
+#else
+  if (m_pixelBuffers.empty()) {
+    throw abcg::RuntimeError("OpenGLFrameCapture::create was not called");
+  }
+
+  // If the ring is full, wait for the oldest readback
+  auto &pixelBuffer{m_pixelBuffers.at(m_nextPixelBuffer)};
+  if (pixelBuffer.fence != nullptr) {
+    finishReadback(pixelBuffer);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+  if (pixelBuffer.size < gsl::narrow<GLsizeiptr>(size)) {
+    pixelBuffer.size = gsl::narrow<GLsizeiptr>(size);
+    glBufferData(GL_PIXEL_PACK_BUFFER, pixelBuffer.size, nullptr,
+                 GL_STREAM_READ);
+  }
+  glReadPixels(0, 0, frame.size.x, frame.size.y, GL_RGBA, GL_UNSIGNED_BYTE,
+               nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  pixelBuffer.frame = std::move(frame);
+  m_nextPixelBuffer = (m_nextPixelBuffer + 1) % m_pixelBuffers.size();
+#endif
+}
+
+void abcg::OpenGLFrameCapture::finishReadback(
+    [[maybe_unused]] PixelBuffer &pixelBuffer) {
+#if !defined(__EMSCRIPTEN__)
+  ABCG_TRACE_ZONE("OpenGLFrameCapture::finishReadback");
+
+  // Only blocks if the readback is still in progress
+  while (glClientWaitSync(pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                          std::numeric_limits<GLuint64>::max()) ==
+         GL_TIMEOUT_EXPIRED)
+    ;
+  glDeleteSync(pixelBuffer.fence);
+  pixelBuffer.fence = nullptr;
+
+  auto frame{std::exchange(pixelBuffer.frame, {})};
+  auto const size{getFrameSize(frame.size)};
+  frame.pixels = acquirePixels(size);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer.buffer);
+  auto const *const mapped{glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, gsl::narrow<GLsizeiptr>(size), GL_MAP_READ_BIT)};
+  auto copied{false};
+  if (mapped != nullptr) {
+    std::memcpy(frame.pixels.data(), mapped, size);
+    // Unmapping fails if the contents were lost while mapped, e.g., on a
+    // video mode change
+    copied = glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (!copied) {
+    // Reported by the next call to poll, as the errors of the encoder
+    std::scoped_lock lock{m_mutex};
+    if (m_error.empty()) {
+      m_error = "Failed to read back a captured frame";
+    }
+    return;
+  }
+  pushFrame(std::move(frame));
+#endif
+}
+
+std::vector<std::byte>
+abcg::OpenGLFrameCapture::acquirePixels(std::size_t size) {
+  std::vector<std::byte> pixels;
+  {
+    std::scoped_lock lock{m_mutex};
+    if (!m_freePixels.empty()) {
+      pixels = std::move(m_freePixels.back());
+      m_freePixels.pop_back();
+    }
+  }
+  pixels.resize(size);
+  return pixels;
+}
+
+void abcg::OpenGLFrameCapture::pushFrame(Frame frame) {
+  // Without an encoder thread, encode on the calling thread
+  if (!m_encoder.joinable()) {
+    encode(frame);
+    return;
+  }
+
+  {
+    std::unique_lock lock{m_mutex};
+    m_frameTaken.wait(
+        lock, [this] { return m_frames.size() < m_maxQueuedFrames; });
+    m_frames.push_back(std::move(frame));
+  }
+  m_frameAdded.notify_one();
+}
+
+void abcg::OpenGLFrameCapture::stopEncoder() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_frameAdded.notify_all();
+  if (m_encoder.joinable()) {
+    m_encoder.join();
+  }
+}
+
+void abcg::OpenGLFrameCapture::encoderLoop() {
+  while (true) {
+    std::unique_lock lock{m_mutex};
+    m_frameAdded.wait(lock,
+                      [this] { return m_stopping || !m_frames.empty(); });
+    // Frames queued before stopping are still written
+    if (m_frames.empty()) {
+      return;
+    }
+    auto frame{std::move(m_frames.front())};
+    m_frames.pop_front();
+    ++m_encodingFrames;
+    lock.unlock();
+    m_frameTaken.notify_all();
+
+    std::string error;
+    try {
+      encode(frame);
+    } catch (std::exception const &exception) {
+      error = exception.what();
+    }
+    // The last frame of a recording closes its file
+    frame.recording.reset();
+
+    lock.lock();
+    --m_encodingFrames;
+    if (m_error.empty()) {
+      m_error = std::move(error);
+    }
+    if (m_freePixels.size() < m_maxQueuedFrames) {
+      m_freePixels.push_back(std::move(frame.pixels));
+    }
+    lock.unlock();
+    m_frameTaken.notify_all();
+  }
+}
+
+void abcg::OpenGLFrameCapture::encode(Frame &frame) {
+  ABCG_TRACE_ZONE("OpenGLFrameCapture::encode");
+
+  if (!frame.screenshotPath.empty()) {
+    writePNG(frame);
+    return;
+  }
+  switch (frame.recording->format) {
+  case CaptureFormat::PPM:
+    writePPM(frame, *frame.recording);
+    break;
+  case CaptureFormat::Y4M:
+    writeY4M(frame, *frame.recording);
+    break;
+  }
+}
+
+void abcg::OpenGLFrameCapture::writePNG(Frame &frame) {
+  auto const bitsPerPixel{32};
+  auto *const surface{SDL_CreateRGBSurfaceFrom(
+      frame.pixels.data(), frame.size.x, frame.size.y, bitsPerPixel,
+      frame.size.x * 4, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000)};
+  if (surface == nullptr) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to create surface for {}", frame.screenshotPath));
+  }
+
+  // OpenGL stores the bottom row first
+  flipVertically(*surface);
+
+  auto const result{IMG_SavePNG(surface, frame.screenshotPath.c_str())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to write {}", frame.screenshotPath));
+  }
+}
+
+void abcg::OpenGLFrameCapture::writePPM(Frame const &frame,
+                                        Recording &recording) {
+  auto const path{
+      fmt::format("{}{:06d}.ppm", recording.path, recording.frameCount++)};
+  std::ofstream stream{path, std::ios::binary};
+
+  auto const header{
+      fmt::format("P6\n{} {}\n255\n", frame.size.x, frame.size.y)};
+  std::vector<char> data(header.begin(), header.end());
+  data.reserve(data.size() + getFrameSize(frame.size) / 4 * 3);
+
+  // Drop the alpha channel
+  for (auto const row : iter::range(frame.size.y)) {
+    auto const *pixel{getRow(frame.pixels, frame.size, row)};
+    for ([[maybe_unused]] auto const column : iter::range(frame.size.x)) {
+      data.push_back(static_cast<char>(pixel[0]));
+      data.push_back(static_cast<char>(pixel[1]));
+      data.push_back(static_cast<char>(pixel[2]));
+      pixel += 4;
+    }
+  }
+
+  write(stream, data, path);
+}
+
+void abcg::OpenGLFrameCapture::writeY4M(Frame const &frame,
+                                        Recording &recording) {
+  auto const width{frame.size.x};
+  auto const height{frame.size.y};
+
+  std::vector<char> data;
+  if (recording.frameCount == 0) {
+    recording.size = frame.size;
+    auto const header{fmt::format(
+        "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width,
+        height, recording.frameRate)};
+    data.assign(header.begin(), header.end());
+  } else if (frame.size != recording.size) {
+    throw abcg::RuntimeError(fmt::format(
+        "Frame size of {} changed from {}x{} to {}x{}", recording.path,
+        recording.size.x, recording.size.y, width, height));
+  }
+  ++recording.frameCount;
+
+  constexpr std::string_view frameHeader{"FRAME\n"};
+  data.insert(data.end(), frameHeader.begin(), frameHeader.end());
+
+  // Full range BT.601 in 8-bit fixed point
+  auto const component{[](int red, int green, int blue,
+                          std::array<int, 4> const &weights) {
+    return gsl::narrow_cast<char>(std::clamp(
+        (weights[0] * red + weights[1] * green + weights[2] * blue +
+         weights[3]) >>
+            8,
+        0, 255));
+  }};
+  constexpr std::array weightsY{77, 150, 29, 128};
+  constexpr std::array weightsU{-43, -85, 128, (128 << 8) + 128};
+  constexpr std::array weightsV{128, -107, -21, (128 << 8) + 128};
+
+  auto const channel{[&](int column, int row, int index) {
+    return std::to_integer<int>(
+        getRow(frame.pixels, frame.size, row)[column * 4 + index]);
+  }};
+
+  // Luma plane
+  for (auto const row : iter::range(height)) {
+    auto const *pixel{getRow(frame.pixels, frame.size, row)};
+    for ([[maybe_unused]] auto const column : iter::range(width)) {
+      data.push_back(component(std::to_integer<int>(pixel[0]),
+                               std::to_integer<int>(pixel[1]),
+                               std::to_integer<int>(pixel[2]), weightsY));
+      pixel += 4;
+    }
+  }
+
+  // Chroma planes, from the average of each 2x2 block of pixels
+  auto const chromaWidth{(width + 1) / 2};
+  auto const chromaHeight{(height + 1) / 2};
+  std::vector<char> planeV;
+  planeV.reserve(gsl::narrow<std::size_t>(chromaWidth * chromaHeight));
+  for (auto const row : iter::range(chromaHeight)) {
+    for (auto const column : iter::range(chromaWidth)) {
+      std::array<int, 3> sum{};
+      for (auto const offset : iter::range(4)) {
+        auto const x{std::min(column * 2 + offset % 2, width - 1)};
+        auto const y{std::min(row * 2 + offset / 2, height - 1)};
+        for (auto const index : iter::range(3)) {
+          sum.at(gsl::narrow<std::size_t>(index)) += channel(x, y, index);
+        }
+      }
+      auto const red{(sum[0] + 2) / 4};
+      auto const green{(sum[1] + 2) / 4};
+      auto const blue{(sum[2] + 2) / 4};
+      data.push_back(component(red, green, blue, weightsU));
+      planeV.push_back(component(red, green, blue, weightsV));
+    }
+  }
+  data.insert(data.end(), planeV.begin(), planeV.end());
+
+  write(recording.stream, data, recording.path);
+}
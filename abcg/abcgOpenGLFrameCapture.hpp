@@ -0,0 +1,150 @@
+/**
+ * @file abcgOpenGLFrameCapture.hpp
+ * @brief Header file of abcg::OpenGLFrameCapture.
+ *
+ * Declaration of abcg::OpenGLFrameCapture.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_FRAME_CAPTURE_HPP_
+#define ABCG_OPENGL_FRAME_CAPTURE_HPP_
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLExternal.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace abcg {
+enum class CaptureFormat;
+class OpenGLFrameCapture;
+} // namespace abcg
+
+/**
+ * @brief File formats of a recording started with
+ * abcg::OpenGLFrameCapture::startRecording.
+ */
+enum class abcg::CaptureFormat {
+  /** @brief Sequence of binary PPM (P6) images, one file per frame. */
+  PPM,
+  /** @brief Single YUV4MPEG2 stream with 4:2:0 chroma subsampling, readable
+   * by video encoders such as FFmpeg. */
+  Y4M
+};
+
+/**
+ * @brief Captures OpenGL framebuffers without stalling the rendering thread.
+ *
+ * Each capture reads the framebuffer bound to `GL_READ_FRAMEBUFFER` into a
+ * pixel pack buffer of a ring, and inserts a fence after the read.
+ * abcg::OpenGLFrameCapture::poll maps the buffers whose fences are signaled,
+ * usually one or two frames later, and hands a copy of the pixels to a
+ * background thread that encodes and writes the files. The rendering thread
+ * only waits if all buffers of the ring, or all frames of the encoder queue,
+ * are still in use, so that no frame of a recording is dropped.
+ *
+ * abcg::OpenGLWindow owns an instance of this class that is polled every
+ * frame and that captures the window when recording (see
+ * abcg::OpenGLWindow::getFrameCapture).
+ *
+ * Under Emscripten, pixels are read synchronously and encoded by the calling
+ * thread, since WebGL cannot map buffers and there are no worker threads.
+ *
+ * @remark Objects of this type cannot be copied or copy-constructed.
+ */
+class abcg::OpenGLFrameCapture {
+public:
+  OpenGLFrameCapture() = default;
+  OpenGLFrameCapture(OpenGLFrameCapture const &) = delete;
+  OpenGLFrameCapture &operator=(OpenGLFrameCapture const &) = delete;
+  OpenGLFrameCapture(OpenGLFrameCapture &&) = delete;
+  OpenGLFrameCapture &operator=(OpenGLFrameCapture &&) = delete;
+  ~OpenGLFrameCapture();
+
+  void create(std::size_t pixelBufferCount = 3,
+              std::size_t maxQueuedFrames = 8);
+  void destroy();
+
+  void captureScreenshot(std::string_view path, glm::ivec2 const &size);
+  void startRecording(std::string_view path, CaptureFormat format,
+                      int frameRate = 60);
+  void stopRecording();
+  void captureFrame(glm::ivec2 const &size);
+  void poll();
+  void flush();
+
+  [[nodiscard]] bool isRecording() const noexcept;
+  [[nodiscard]] std::size_t getPendingCount() const noexcept;
+
+private:
+  // Output of a recording. Only accessed by the encoder thread once frames
+  // are queued
+  struct Recording {
+    std::string path;
+    CaptureFormat format{};
+    int frameRate{};
+    std::size_t frameCount{};
+    glm::ivec2 size{};
+    std::ofstream stream;
+  };
+
+  // Image read back from a framebuffer, bottom row first
+  struct Frame {
+    glm::ivec2 size{};
+    std::vector<std::byte> pixels;
+    std::string screenshotPath;
+    std::shared_ptr<Recording> recording;
+  };
+
+  struct PixelBuffer {
+    GLuint buffer{};
+    GLsizeiptr size{};
+    GLsync fence{};
+    Frame frame;
+  };
+
+  void readPixels(Frame frame);
+  void finishReadback(PixelBuffer &pixelBuffer);
+  [[nodiscard]] std::vector<std::byte> acquirePixels(std::size_t size);
+  void pushFrame(Frame frame);
+  void stopEncoder();
+  void encoderLoop();
+  static void encode(Frame &frame);
+  static void writePNG(Frame &frame);
+  static void writePPM(Frame const &frame, Recording &recording);
+  static void writeY4M(Frame const &frame, Recording &recording);
+
+  std::shared_ptr<Recording> m_recording;
+
+  // Readbacks are issued in ring order, so the oldest pending readback is
+  // the one of the next buffer to be used
+  std::vector<PixelBuffer> m_pixelBuffers;
+  std::size_t m_nextPixelBuffer{};
+
+  // Frames waiting for the encoder and buffers of encoded frames kept for
+  // reuse
+  std::jthread m_encoder;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_frameAdded;
+  std::condition_variable m_frameTaken;
+  std::deque<Frame> m_frames;
+  std::vector<std::vector<std::byte>> m_freePixels;
+  std::size_t m_maxQueuedFrames{};
+  std::size_t m_encodingFrames{};
+  std::string m_error;
+  bool m_stopping{};
+};
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * @file abcgOpenGLFrameProfiler.cpp
+ * @brief Definition of abcg::OpenGLFrameProfiler members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLFrameProfiler.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+#include <imgui.h>
+
+#include <string>
+
+namespace {
+constexpr std::array phaseNames{"Fixed update", "Update", "Paint UI",
+                                "Paint",        "Render UI", "Swap"};
+constexpr std::array phaseColors{
+    IM_COL32(0, 114, 178, 255),  IM_COL32(86, 180, 233, 255),
+    IM_COL32(230, 159, 0, 255),  IM_COL32(0, 158, 115, 255),
+    IM_COL32(240, 228, 66, 255), IM_COL32(204, 121, 167, 255)};
+} // namespace
+
+/**
+ * @brief Creates the timestamp queries.
+ *
+ * This must be called with the OpenGL context current.
+ *
+ * @param enableGPUTimers Whether to measure GPU times. Set to `false` if the
+ * context does not support `GL_TIMESTAMP` queries.
+ */
+void abcg::OpenGLFrameProfiler::create(bool enableGPUTimers) {
+  destroy();
+
+#if defined(__EMSCRIPTEN__)
+  m_gpuTimers = false;
+#else
+  m_gpuTimers = enableGPUTimers;
+  if (m_gpuTimers) {
+    for (auto &queries : m_queries) {
+      glGenQueries(gsl::narrow<GLsizei>(queries.size()), queries.data());
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Releases the timestamp queries.
+ */
+void abcg::OpenGLFrameProfiler::destroy() {
+  if (m_gpuTimers) {
+    for (auto &queries : m_queries) {
+      glDeleteQueries(gsl::narrow<GLsizei>(queries.size()), queries.data());
+      queries.fill(0);
+    }
+  }
+  m_gpuTimers = false;
+  m_queryPending.fill(false);
+  m_frameStarted = false;
+  m_gpuValid.fill(false);
+}
+
+/**
+ * @brief Turns measurements on or off.
+ *
+ * While disabled, the other member functions return immediately.
+ *
+ * @param enabled Whether to take measurements.
+ */
+void abcg::OpenGLFrameProfiler::setEnabled(bool enabled) noexcept {
+  if (!enabled) {
+    discardFrame();
+  }
+  m_enabled = enabled;
+}
+
+/**
+ * @brief Marks the start of a phase of the current frame.
+ *
+ * The phase lasts until the next call to this function or to
+ * abcg::OpenGLFrameProfiler::endFrame. Starting
+ * abcg::FramePhase::FixedUpdate starts a new frame.
+ *
+ * @param phase Phase that is starting.
+ */
+void abcg::OpenGLFrameProfiler::beginPhase(FramePhase phase) {
+  if (!m_enabled)
+    return;
+
+  auto const index{static_cast<std::size_t>(phase)};
+  if (phase == FramePhase::FixedUpdate) {
+    m_frameStarted = true;
+    // The oldest slot of the ring is about to be reused
+    resolveQueries(m_querySlot);
+  } else if (!m_frameStarted) {
+    return;
+  }
+
+  m_cpuMarks.at(index) = Clock::now();
+#if !defined(__EMSCRIPTEN__)
+  if (m_gpuTimers) {
+    glQueryCounter(m_queries.at(m_querySlot).at(index), GL_TIMESTAMP);
+  }
+#endif
+}
+
+/**
+ * @brief Marks the end of the current frame and stores its CPU timings.
+ *
+ * Its GPU timings are stored a few frames later, when the query results are
+ * available.
+ */
+void abcg::OpenGLFrameProfiler::endFrame() {
+  if (!m_enabled || !m_frameStarted)
+    return;
+  m_frameStarted = false;
+
+  m_cpuMarks.back() = Clock::now();
+#if !defined(__EMSCRIPTEN__)
+  if (m_gpuTimers) {
+    glQueryCounter(m_queries.at(m_querySlot).back(), GL_TIMESTAMP);
+    m_queryPending.at(m_querySlot) = true;
+    m_queryHistoryIndex.at(m_querySlot) = m_historyHead;
+  }
+#endif
+
+  auto &cpuTimings{m_cpuHistory.at(m_historyHead)};
+  for (auto const index : iter::range(m_phaseCount)) {
+    std::chrono::duration<float, std::milli> const duration{
+        m_cpuMarks.at(index + 1) - m_cpuMarks.at(index)};
+    cpuTimings.at(index) = duration.count();
+  }
+  m_cpuValid.at(m_historyHead) = true;
+  m_gpuHistory.at(m_historyHead).fill(0.0f);
+  m_gpuValid.at(m_historyHead) = false;
+
+  m_historyHead = (m_historyHead + 1) % m_historySize;
+  m_querySlot = (m_querySlot + 1) % m_queryFrames;
+}
+
+/**
+ * @brief Drops the measurements of the current frame.
+ *
+ * Call this when a frame is not rendered, e.g., because the window is
+ * minimized.
+ */
+void abcg::OpenGLFrameProfiler::discardFrame() noexcept {
+  m_frameStarted = false;
+}
+
+void abcg::OpenGLFrameProfiler::resolveQueries(std::size_t slot) {
+  if (!m_gpuTimers || !m_queryPending.at(slot))
+    return;
+  m_queryPending.at(slot) = false;
+
+#if !defined(__EMSCRIPTEN__)
+  auto const &queries{m_queries.at(slot)};
+
+  // The last query is the last one to complete. If it is still not available
+  // after a full ring, drop the frame instead of waiting
+  GLuint available{};
+  glGetQueryObjectuiv(queries.back(), GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE)
+    return;
+
+  std::array<GLuint64, m_phaseCount + 1> timestamps{};
+  for (auto const index : iter::range(timestamps.size())) {
+    glGetQueryObjectui64v(queries.at(index), GL_QUERY_RESULT,
+                          &timestamps.at(index));
+  }
+
+  auto const historyIndex{m_queryHistoryIndex.at(slot)};
+  auto &gpuTimings{m_gpuHistory.at(historyIndex)};
+  for (auto const index : iter::range(m_phaseCount)) {
+    gpuTimings.at(index) =
+        gsl::narrow_cast<float>(timestamps.at(index + 1) -
+                                timestamps.at(index)) /
+        1.0e6f;
+  }
+  m_gpuValid.at(historyIndex) = true;
+#endif
+}
+
+/**
+ * @brief Shows the overlay with the timings of the last frames.
+ *
+ * This must be called between `ImGui::NewFrame` and `ImGui::Render`.
+ */
+void abcg::OpenGLFrameProfiler::paintUI() const {
+  auto const barWidth{2.0f};
+  auto const graphSize{
+      ImVec2(barWidth * gsl::narrow<float>(m_historySize), 60.0f)};
+  // Full graph height, in milliseconds
+  auto const graphScale{1000.0f / 30.0f};
+
+  auto const displaySize{ImGui::GetIO().DisplaySize};
+  ImGui::SetNextWindowPos(ImVec2(displaySize.x - 5, 5), ImGuiCond_Always,
+                          ImVec2(1, 0));
+  ImGui::SetNextWindowBgAlpha(0.75f);
+  ImGui::Begin("Frame profiler", nullptr,
+               ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                   ImGuiWindowFlags_NoBringToFrontOnFocus |
+                   ImGuiWindowFlags_NoFocusOnAppearing);
+
+  auto const drawGraph{[&](char const *label, auto const &history) {
+    ImGui::TextUnformatted(label);
+    auto const origin{ImGui::GetCursorScreenPos()};
+    auto *const drawList{ImGui::GetWindowDrawList()};
+    drawList->AddRectFilled(
+        origin, ImVec2(origin.x + graphSize.x, origin.y + graphSize.y),
+        IM_COL32(0, 0, 0, 128));
+
+    // Stacked bars, oldest frame on the left
+    for (auto const column : iter::range(m_historySize)) {
+      auto const &timings{history.at((m_historyHead + column) % m_historySize)};
+      auto const left{origin.x + barWidth * gsl::narrow<float>(column)};
+      auto bottom{origin.y + graphSize.y};
+      for (auto const phase : iter::range(m_phaseCount)) {
+        auto const height{
+            std::min(timings.at(phase) / graphScale * graphSize.y,
+                     bottom - origin.y)};
+        drawList->AddRectFilled(ImVec2(left, bottom - height),
+                                ImVec2(left + barWidth, bottom),
+                                phaseColors.at(phase));
+        bottom -= height;
+      }
+    }
+
+    // 60 Hz budget
+    auto const budgetY{origin.y + graphSize.y -
+                       (1000.0f / 60.0f) / graphScale * graphSize.y};
+    drawList->AddLine(ImVec2(origin.x, budgetY),
+                      ImVec2(origin.x + graphSize.x, budgetY),
+                      IM_COL32(255, 255, 255, 160));
+
+    ImGui::Dummy(graphSize);
+  }};
+
+  drawGraph("CPU", m_cpuHistory);
+  if (m_gpuTimers) {
+    drawGraph("GPU", m_gpuHistory);
+  } else {
+    ImGui::TextUnformatted("GPU timers not available");
+  }
+
+  // Legend with the average of each phase over the frames measured so far,
+  // in milliseconds
+  auto const average{[&](auto const &history, auto const &valid,
+                         std::size_t phase) {
+    auto sum{0.0f};
+    std::size_t count{};
+    for (auto const column : iter::range(m_historySize)) {
+      if (valid.at(column)) {
+        sum += history.at(column).at(phase);
+        ++count;
+      }
+    }
+    return count == 0 ? std::string{"   n/a"}
+                      : fmt::format("{:6.2f}", sum / gsl::narrow<float>(count));
+  }};
+
+  for (auto const phase : iter::range(m_phaseCount)) {
+    auto const color{ImGui::ColorConvertU32ToFloat4(phaseColors.at(phase))};
+    ImGui::ColorButton(phaseNames.at(phase), color,
+                       ImGuiColorEditFlags_NoTooltip, ImVec2(10, 10));
+    ImGui::SameLine();
+    auto const cpuAverage{average(m_cpuHistory, m_cpuValid, phase)};
+    auto const text{
+        m_gpuTimers
+            ? fmt::format("{:<12} CPU {} ms  GPU {} ms", phaseNames.at(phase),
+                          cpuAverage, average(m_gpuHistory, m_gpuValid, phase))
+            : fmt::format("{:<12} CPU {} ms", phaseNames.at(phase),
+                          cpuAverage)};
+    ImGui::TextUnformatted(text.c_str());
+  }
+
+  ImGui::End();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file abcgOpenGLFrameProfiler.hpp
+ * @brief Header file of abcg::OpenGLFrameProfiler.
+ *
+ * Declaration of abcg::OpenGLFrameProfiler and abcg::FramePhase.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_FRAME_PROFILER_HPP_
+#define ABCG_OPENGL_FRAME_PROFILER_HPP_
+
+#include "abcgOpenGLExternal.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace abcg {
+enum class FramePhase;
+class OpenGLFrameProfiler;
+} // namespace abcg
+
+/**
+ * @brief Enumeration of the phases of a frame measured by
+ * abcg::OpenGLFrameProfiler, in the order they occur.
+ */
+enum class abcg::FramePhase {
+  /** @brief All calls to abcg::OpenGLWindow::onFixedUpdate of the frame. */
+  FixedUpdate,
+  /** @brief abcg::OpenGLWindow::onUpdate. */
+  Update,
+  /** @brief abcg::OpenGLWindow::onPaintUI and `ImGui::Render`. */
+  PaintUI,
+  /** @brief abcg::OpenGLWindow::onPaint. */
+  Paint,
+  /** @brief Rendering of the ImGui draw data. */
+  RenderUI,
+  /** @brief Buffer swap, or `glFinish` without double buffering. */
+  Swap
+};
+
+/**
+ * @brief Measures the CPU and GPU time of each phase of a frame and shows
+ * them as stacked bars in an ImGui overlay.
+ *
+ * CPU times are measured with a steady clock. GPU times are measured with
+ * `GL_TIMESTAMP` queries issued at the phase boundaries. The queries of a
+ * frame are kept in a ring of several frames and are only read once their
+ * results are available, so reading them back never stalls the pipeline.
+ *
+ * GPU timings are not available on WebGL and OpenGL ES contexts.
+ *
+ * @sa abcg::WindowSettings::showFrameProfiler.
+ */
+class abcg::OpenGLFrameProfiler {
+public:
+  void create(bool enableGPUTimers);
+  void destroy();
+  void setEnabled(bool enabled) noexcept;
+
+  void beginPhase(FramePhase phase);
+  void endFrame();
+  void discardFrame() noexcept;
+
+  void paintUI() const;
+
+private:
+  constexpr static std::size_t m_phaseCount{6};
+  constexpr static std::size_t m_queryFrames{4};
+  constexpr static std::size_t m_historySize{120};
+
+  using Clock = std::chrono::steady_clock;
+  using Timings = std::array<float, m_phaseCount>;
+
+  void resolveQueries(std::size_t slot);
+
+  bool m_enabled{};
+
+  // Times of the current frame, one per phase boundary
+  std::array<Clock::time_point, m_phaseCount + 1> m_cpuMarks{};
+  bool m_frameStarted{};
+
+  // Ring of timestamp queries, one set per frame in flight
+  bool m_gpuTimers{};
+  std::array<std::array<GLuint, m_phaseCount + 1>, m_queryFrames> m_queries{};
+  std::array<std::size_t, m_queryFrames> m_queryHistoryIndex{};
+  std::array<bool, m_queryFrames> m_queryPending{};
+  std::size_t m_querySlot{};
+
+  // Timings in milliseconds of the last frames, oldest first from m_historyHead
+  std::array<Timings, m_historySize> m_cpuHistory{};
+  std::array<Timings, m_historySize> m_gpuHistory{};
+  // Whether each entry of the history holds a measurement. GPU timings of a
+  // frame are missing until its queries are resolved, and for good if they
+  // were never available
+  std::array<bool, m_historySize> m_cpuValid{};
+  std::array<bool, m_historySize> m_gpuValid{};
+  std::size_t m_historyHead{};
+};
+
+#endif
@@ -1479,6 +1479,25 @@ inline void glGetDoublev(
   callGL(sourceLocation, ::glGetDoublev, pname, params);
 }
 #endif
+
+#if !defined(__EMSCRIPTEN__)
+// OpenGL 3.3+ function definitions
+inline void glQueryCounter(
+    GLuint id, GLenum target,
+    source_location const &sourceLocation = source_location::current()) {
+  callGL(sourceLocation, ::glQueryCounter, id, target);
+}
+inline void glGetQueryObjecti64v(
+    GLuint id, GLenum pname, GLint64 *params,
+    source_location const &sourceLocation = source_location::current()) {
+  callGL(sourceLocation, ::glGetQueryObjecti64v, id, pname, params);
+}
+inline void glGetQueryObjectui64v(
+    GLuint id, GLenum pname, GLuint64 *params,
+    source_location const &sourceLocation = source_location::current()) {
+  callGL(sourceLocation, ::glGetQueryObjectui64v, id, pname, params);
+}
+#endif
 // NOLINTEND(readability-identifier-length)
 
 } // namespace abcg
@@ -16,18 +16,107 @@
 #include <gsl/gsl>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+// Compressed formats that may be missing from the OpenGL headers
+constexpr GLenum compressedRGBS3TCDXT1{0x83F0};
+constexpr GLenum compressedRGBAS3TCDXT1{0x83F1};
+constexpr GLenum compressedRGBAS3TCDXT5{0x83F3};
+constexpr GLenum compressedSRGBS3TCDXT1{0x8C4C};
+constexpr GLenum compressedSRGBAlphaS3TCDXT1{0x8C4D};
+constexpr GLenum compressedSRGBAlphaS3TCDXT5{0x8C4F};
+constexpr GLenum compressedRGRGTC2{0x8DBD};
+constexpr GLenum compressedRGBABPTCUnorm{0x8E8C};
+constexpr GLenum compressedSRGBAlphaBPTCUnorm{0x8E8D};
+constexpr GLenum compressedRGB8ETC2{0x9274};
+constexpr GLenum compressedSRGB8ETC2{0x9275};
+constexpr GLenum compressedRGBA8ETC2EAC{0x9278};
+constexpr GLenum compressedSRGB8Alpha8ETC2EAC{0x9279};
+constexpr GLenum compressedRGBAASTC4x4{0x93B0};
+constexpr GLenum compressedSRGB8Alpha8ASTC4x4{0x93D0};
+
+[[nodiscard]] GLenum getOpenGLInternalFormat(abcg::KTX2Format format) {
+  using abcg::KTX2Format;
+  switch (format) {
+  case KTX2Format::RGBA8Unorm:
+    return GL_RGBA8;
+  case KTX2Format::RGBA8Srgb:
+    return GL_SRGB8_ALPHA8;
+  case KTX2Format::BC1RGBUnorm:
+    return compressedRGBS3TCDXT1;
+  case KTX2Format::BC1RGBSrgb:
+    return compressedSRGBS3TCDXT1;
+  case KTX2Format::BC1RGBAUnorm:
+    return compressedRGBAS3TCDXT1;
+  case KTX2Format::BC1RGBASrgb:
+    return compressedSRGBAlphaS3TCDXT1;
+  case KTX2Format::BC3Unorm:
+    return compressedRGBAS3TCDXT5;
+  case KTX2Format::BC3Srgb:
+    return compressedSRGBAlphaS3TCDXT5;
+  case KTX2Format::BC5Unorm:
+    return compressedRGRGTC2;
+  case KTX2Format::BC7Unorm:
+    return compressedRGBABPTCUnorm;
+  case KTX2Format::BC7Srgb:
+    return compressedSRGBAlphaBPTCUnorm;
+  case KTX2Format::ETC2RGB8Unorm:
+    return compressedRGB8ETC2;
+  case KTX2Format::ETC2RGB8Srgb:
+    return compressedSRGB8ETC2;
+  case KTX2Format::ETC2RGBA8Unorm:
+    return compressedRGBA8ETC2EAC;
+  case KTX2Format::ETC2RGBA8Srgb:
+    return compressedSRGB8Alpha8ETC2EAC;
+  case KTX2Format::ASTC4x4Unorm:
+    return compressedRGBAASTC4x4;
+  case KTX2Format::ASTC4x4Srgb:
+    return compressedSRGB8Alpha8ASTC4x4;
+  }
+  return GL_NONE;
+}
+
+#if defined(__EMSCRIPTEN__)
+// WebGL extensions must be enabled before their formats can be used
+[[nodiscard]] bool enableWebGLExtension(char const *name) {
+  return emscripten_webgl_enable_extension(
+             emscripten_webgl_get_current_context(), name) == EM_TRUE;
+}
+#endif
+
+[[nodiscard]] GLuint loadOpenGLTextureKTX2(std::string_view path) {
+  auto const image{abcg::loadKTX2(path)};
+  if (!abcg::isOpenGLTextureFormatSupported(image.format)) {
+    throw abcg::RuntimeError(
+        fmt::format("Texture format of {} is not supported by the device",
+                    path));
+  }
+  return abcg::createOpenGLTexture(image);
+}
+} // namespace
 
 /**
  * @brief Creates an OpenGL 2D texture from an image loaded from a filesystem
  * path.
  *
+ * KTX2 files are uploaded with the mipmap levels they contain, without
+ * decoding.
+ *
  * @param createInfo Texture creation settings.
  *
- * @throw abcg::RuntimeError if the image could not be loaded.
+ * @throw abcg::RuntimeError if the image could not be loaded, or if the
+ * format of a KTX2 file is not supported by the device.
  *
  * @return ID of the texture, as generated by glGenTextures.
  */
 GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
+  ABCG_TRACE_ZONE("loadOpenGLTexture");
+
+  if (isKTX2Path(createInfo.path)) {
+    return loadOpenGLTextureKTX2(createInfo.path);
+  }
+
   GLuint textureID{};
 
   if (SDL_Surface *const surface{IMG_Load(createInfo.path.data())}) {
@@ -36,17 +125,14 @@ GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
     GLenum format{};
     SDL_Surface *formattedSurface{};
     if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
+      formattedSurface = convertSurface(surface, SDL_PIXELFORMAT_RGB24);
       internalFormat = createInfo.sRGBToLinear ? GL_SRGB8 : GL_RGB;
       format = GL_RGB;
     } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+      formattedSurface = convertSurface(surface, SDL_PIXELFORMAT_RGBA32);
       internalFormat = createInfo.sRGBToLinear ? GL_SRGB8_ALPHA8 : GL_RGBA;
       format = GL_RGBA;
     }
-    SDL_FreeSurface(surface);
 
     // Flip upside down
     if (createInfo.flipUpsideDown) {
@@ -99,6 +185,8 @@ GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
  * @return ID of the texture, as generated by glGenTextures.
  */
 GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
+  ABCG_TRACE_ZONE("loadOpenGLCubemap");
+
   GLuint textureID{};
   glGenTextures(1, &textureID);
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -108,8 +196,7 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
     if (SDL_Surface *const surface{IMG_Load(path.data())}) {
       // Enforce RGB
       SDL_Surface *const formattedSurface{
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0)};
-      SDL_FreeSurface(surface);
+          convertSurface(surface, SDL_PIXELFORMAT_RGB24)};
 
       auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
 
@@ -160,4 +247,124 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
   }
 
   return textureID;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Creates an OpenGL 2D texture from a KTX2 image.
+ *
+ * The levels of the image are uploaded as stored, without decoding.
+ *
+ * @param image Image loaded with abcg::loadKTX2.
+ *
+ * @throw abcg::RuntimeError if the format of the image is not supported by
+ * the device.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ */
+GLuint abcg::createOpenGLTexture(KTX2Image const &image) {
+  ABCG_TRACE_ZONE("createOpenGLTexture");
+
+  if (!isOpenGLTextureFormatSupported(image.format)) {
+    throw abcg::RuntimeError("Texture format is not supported by the device");
+  }
+
+  auto const info{abcg::getKTX2FormatInfo(image.format).value()};
+  auto const internalFormat{getOpenGLInternalFormat(image.format)};
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  for (auto &&[index, level] : iter::enumerate(image.levels)) {
+    auto const mipLevel{gsl::narrow<GLint>(index)};
+    auto const width{gsl::narrow<GLsizei>(level.width)};
+    auto const height{gsl::narrow<GLsizei>(level.height)};
+    if (info.compressed) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, mipLevel, internalFormat, width,
+                             height, 0, gsl::narrow<GLsizei>(level.data.size()),
+                             level.data.data());
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, mipLevel,
+                   gsl::narrow<GLint>(internalFormat), width, height, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, level.data.data());
+    }
+  }
+
+  auto const mipmapped{image.levels.size() > 1};
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  gsl::narrow<GLint>(image.levels.size() - 1));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return textureID;
+}
+
+/**
+ * @brief Returns whether a KTX2 format can be used for OpenGL textures in the
+ * current context.
+ *
+ * Under Emscripten, this also enables the WebGL extension of the format.
+ *
+ * @param format Pixel format.
+ *
+ * @return True if the format is supported.
+ */
+bool abcg::isOpenGLTextureFormatSupported(KTX2Format format) {
+  switch (format) {
+  case KTX2Format::RGBA8Unorm:
+  case KTX2Format::RGBA8Srgb:
+    return true;
+#if defined(__EMSCRIPTEN__)
+  case KTX2Format::BC1RGBUnorm:
+  case KTX2Format::BC1RGBAUnorm:
+  case KTX2Format::BC3Unorm:
+    return enableWebGLExtension("WEBGL_compressed_texture_s3tc");
+  case KTX2Format::BC1RGBSrgb:
+  case KTX2Format::BC1RGBASrgb:
+  case KTX2Format::BC3Srgb:
+    return enableWebGLExtension("WEBGL_compressed_texture_s3tc_srgb");
+  case KTX2Format::BC5Unorm:
+    return enableWebGLExtension("EXT_texture_compression_rgtc");
+  case KTX2Format::BC7Unorm:
+  case KTX2Format::BC7Srgb:
+    return enableWebGLExtension("EXT_texture_compression_bptc");
+  case KTX2Format::ETC2RGB8Unorm:
+  case KTX2Format::ETC2RGB8Srgb:
+  case KTX2Format::ETC2RGBA8Unorm:
+  case KTX2Format::ETC2RGBA8Srgb:
+    return enableWebGLExtension("WEBGL_compressed_texture_etc");
+  case KTX2Format::ASTC4x4Unorm:
+  case KTX2Format::ASTC4x4Srgb:
+    return enableWebGLExtension("WEBGL_compressed_texture_astc");
+#else
+  case KTX2Format::BC1RGBUnorm:
+  case KTX2Format::BC1RGBAUnorm:
+  case KTX2Format::BC3Unorm:
+    return GLEW_EXT_texture_compression_s3tc;
+  case KTX2Format::BC1RGBSrgb:
+  case KTX2Format::BC1RGBASrgb:
+  case KTX2Format::BC3Srgb:
+    return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+  case KTX2Format::BC5Unorm:
+    // RGTC is core since OpenGL 3.0
+    return true;
+  case KTX2Format::BC7Unorm:
+  case KTX2Format::BC7Srgb:
+    return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+  case KTX2Format::ETC2RGB8Unorm:
+  case KTX2Format::ETC2RGB8Srgb:
+  case KTX2Format::ETC2RGBA8Unorm:
+  case KTX2Format::ETC2RGBA8Srgb:
+    return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+  case KTX2Format::ASTC4x4Unorm:
+  case KTX2Format::ASTC4x4Srgb:
+    return GLEW_KHR_texture_compression_astc_ldr;
+#endif
+  }
+  return false;
+}
@@ -11,6 +11,7 @@
 #ifndef ABCG_OPENGL_IMAGE_HPP_
 #define ABCG_OPENGL_IMAGE_HPP_
 
+#include "abcgKTX2.hpp"
 #include "abcgOpenGLExternal.hpp"
 
 #include <array>
@@ -24,13 +25,19 @@ struct OpenGLCubemapCreateInfo;
 loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo);
 [[nodiscard]] GLuint
 loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo);
+[[nodiscard]] GLuint createOpenGLTexture(KTX2Image const &image);
+[[nodiscard]] bool isOpenGLTextureFormatSupported(KTX2Format format);
 } // namespace abcg
 
 /**
  * @brief Configuration settings for creating a 2D texture for OpenGL.
  */
 struct abcg::OpenGLTextureCreateInfo {
-  /** @brief Path to the image file (PNG or JPEG). */
+  /** @brief Path to the image file (PNG, JPEG or KTX2).
+   *
+   * KTX2 files are uploaded as stored, with the mipmap levels of the file.
+   * The flags below are ignored for them: flipping, mipmap generation and
+   * sRGB encoding are done by the offline converter (`abcgktx2`). */
   std::string_view path{};
   /** @brief Whether to generate mipmap levels. */
   bool generateMipmaps{true};
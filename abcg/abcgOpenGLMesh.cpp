@@ -0,0 +1,173 @@
+/**
+ * @file abcgOpenGLMesh.cpp
+ * @brief Definition of abcg::OpenGLMeshRegistry members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLMesh.hpp"
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+
+/**
+ * @brief Uploads a named mesh to the GPU, unless it was already added.
+ *
+ * If a mesh with the same name is already in the registry, its handle is
+ * returned and no OpenGL call is made. The data in `createInfo` is only read
+ * during the call.
+ *
+ * @param name Unique name of the mesh (e.g., `"barreira"`).
+ * @param createInfo Vertex and index data of the mesh.
+ *
+ * @throw abcg::RuntimeError if the vertex data is empty or malformed.
+ *
+ * @return Handle to the mesh.
+ */
+abcg::OpenGLMeshHandle
+abcg::OpenGLMeshRegistry::add(std::string_view name,
+                              OpenGLMeshCreateInfo const &createInfo) {
+  if (auto const handle{find(name)}) {
+    return *handle;
+  }
+
+  auto const components{createInfo.componentsPerVertex};
+  if (createInfo.vertices.empty() || components < 1 || components > 4 ||
+      createInfo.vertices.size() % gsl::narrow<std::size_t>(components) != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid vertex data for mesh {}", name));
+  }
+
+  OpenGLMesh mesh{
+      .componentsPerVertex = components,
+      .vertexCount = gsl::narrow<GLsizei>(createInfo.vertices.size() /
+                                          gsl::narrow<std::size_t>(components)),
+      .indexCount = gsl::narrow<GLsizei>(createInfo.indices.size()),
+      .mode = createInfo.mode};
+
+  // Generate VBO
+  glGenBuffers(1, &mesh.VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+  glBufferData(GL_ARRAY_BUFFER,
+               gsl::narrow<GLsizeiptr>(createInfo.vertices.size_bytes()),
+               createInfo.vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Generate EBO
+  if (!createInfo.indices.empty()) {
+    glGenBuffers(1, &mesh.EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 gsl::narrow<GLsizeiptr>(createInfo.indices.size_bytes()),
+                 createInfo.indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+
+  OpenGLMeshHandle const handle{gsl::narrow<std::uint32_t>(m_meshes.size())};
+  m_meshes.push_back(mesh);
+  m_indices.emplace(name, handle.index);
+
+  return handle;
+}
+
+/**
+ * @brief Looks up a mesh by name.
+ *
+ * @param name Name of the mesh.
+ *
+ * @return Handle to the mesh, or `std::nullopt` if no such mesh was added.
+ */
+std::optional<abcg::OpenGLMeshHandle>
+abcg::OpenGLMeshRegistry::find(std::string_view name) const {
+  if (auto const iter{m_indices.find(std::string{name})};
+      iter != m_indices.end()) {
+    return OpenGLMeshHandle{iter->second};
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Returns the buffers of a mesh.
+ *
+ * @param handle Handle returned by abcg::OpenGLMeshRegistry::add.
+ *
+ * @return Reference to the mesh. It remains valid until the next call to
+ * abcg::OpenGLMeshRegistry::add or abcg::OpenGLMeshRegistry::destroy.
+ */
+abcg::OpenGLMesh const &
+abcg::OpenGLMeshRegistry::get(OpenGLMeshHandle handle) const {
+  return m_meshes.at(handle.index);
+}
+
+/**
+ * @brief Binds the vertex positions and indices of a mesh to the current VAO.
+ *
+ * This must be called while the VAO that will be used for drawing the mesh is
+ * bound.
+ *
+ * @param handle Handle returned by abcg::OpenGLMeshRegistry::add.
+ * @param location Location of the vertex position attribute.
+ */
+void abcg::OpenGLMeshRegistry::bindVertexAttribute(OpenGLMeshHandle handle,
+                                                   GLint location) const {
+  auto const &mesh{get(handle)};
+  auto const attribute{gsl::narrow<GLuint>(location)};
+
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+  glEnableVertexAttribArray(attribute);
+  glVertexAttribPointer(attribute, mesh.componentsPerVertex, GL_FLOAT,
+                        GL_FALSE, 0, nullptr);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  if (mesh.EBO != 0) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+  }
+}
+
+/**
+ * @brief Issues the draw call of a mesh.
+ *
+ * The VAO set up with abcg::OpenGLMeshRegistry::bindVertexAttribute and the
+ * program must be bound before calling this function.
+ *
+ * @param handle Handle returned by abcg::OpenGLMeshRegistry::add.
+ * @param instanceCount Number of instances to draw.
+ */
+void abcg::OpenGLMeshRegistry::draw(OpenGLMeshHandle handle,
+                                    GLsizei instanceCount) const {
+  auto const &mesh{get(handle)};
+
+  if (mesh.EBO != 0) {
+    if (instanceCount == 1) {
+      glDrawElements(mesh.mode, mesh.indexCount, GL_UNSIGNED_INT, nullptr);
+    } else {
+      glDrawElementsInstanced(mesh.mode, mesh.indexCount, GL_UNSIGNED_INT,
+                              nullptr, instanceCount);
+    }
+  } else {
+    if (instanceCount == 1) {
+      glDrawArrays(mesh.mode, 0, mesh.vertexCount);
+    } else {
+      glDrawArraysInstanced(mesh.mode, 0, mesh.vertexCount, instanceCount);
+    }
+  }
+}
+
+/**
+ * @brief Releases the GPU buffers of all meshes.
+ *
+ * All handles previously returned by the registry become invalid.
+ */
+void abcg::OpenGLMeshRegistry::destroy() {
+  for (auto &mesh : m_meshes) {
+    glDeleteBuffers(1, &mesh.VBO);
+    glDeleteBuffers(1, &mesh.EBO);
+  }
+  m_meshes.clear();
+  m_indices.clear();
+}
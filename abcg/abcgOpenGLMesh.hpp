@@ -0,0 +1,116 @@
+/**
+ * @file abcgOpenGLMesh.hpp
+ * @brief Header file of abcg::OpenGLMeshRegistry.
+ *
+ * Declaration of abcg::OpenGLMeshRegistry and related types.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_MESH_HPP_
+#define ABCG_OPENGL_MESH_HPP_
+
+#include "abcgOpenGLExternal.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace abcg {
+struct OpenGLMesh;
+struct OpenGLMeshCreateInfo;
+struct OpenGLMeshHandle;
+class OpenGLMeshRegistry;
+} // namespace abcg
+
+/**
+ * @brief Creation info structure for abcg::OpenGLMeshRegistry::add.
+ */
+struct abcg::OpenGLMeshCreateInfo {
+  /** @brief Tightly packed vertex positions. */
+  std::span<float const> vertices;
+  /** @brief Number of components of each vertex position (1 to 4). */
+  GLint componentsPerVertex{3};
+  /** @brief Vertex indices. If empty, the mesh is drawn with glDrawArrays. */
+  std::span<GLuint const> indices;
+  /** @brief Primitive mode (e.g., `GL_TRIANGLES`). */
+  GLenum mode{GL_TRIANGLES};
+};
+
+/**
+ * @brief Lightweight handle to a mesh stored in abcg::OpenGLMeshRegistry.
+ */
+struct abcg::OpenGLMeshHandle {
+  /** @brief Index of the mesh in the registry. */
+  std::uint32_t index{std::numeric_limits<std::uint32_t>::max()};
+
+  /**
+   * @brief Returns whether the handle refers to a mesh.
+   *
+   * @return True if the handle was returned by a registry.
+   */
+  [[nodiscard]] bool isValid() const noexcept {
+    return index != std::numeric_limits<std::uint32_t>::max();
+  }
+};
+
+/**
+ * @brief Immutable GPU buffers of a mesh stored in abcg::OpenGLMeshRegistry.
+ */
+struct abcg::OpenGLMesh {
+  /** @brief Vertex buffer object. */
+  GLuint VBO{};
+  /** @brief Element buffer object, or 0 if the mesh is not indexed. */
+  GLuint EBO{};
+  /** @brief Number of components of each vertex position. */
+  GLint componentsPerVertex{};
+  /** @brief Number of vertices. */
+  GLsizei vertexCount{};
+  /** @brief Number of indices. */
+  GLsizei indexCount{};
+  /** @brief Primitive mode. */
+  GLenum mode{};
+};
+
+/**
+ * @brief Registry of named immutable meshes.
+ *
+ * Each mesh is uploaded to the GPU only once, the first time its name is
+ * added. Objects that share the same shape keep only an
+ * abcg::OpenGLMeshHandle and bind the shared buffers into their own VAO with
+ * abcg::OpenGLMeshRegistry::bindVertexAttribute.
+ */
+class abcg::OpenGLMeshRegistry {
+public:
+  OpenGLMeshRegistry() = default;
+  OpenGLMeshRegistry(OpenGLMeshRegistry const &) = delete;
+  OpenGLMeshRegistry &operator=(OpenGLMeshRegistry const &) = delete;
+  OpenGLMeshRegistry(OpenGLMeshRegistry &&) = delete;
+  OpenGLMeshRegistry &operator=(OpenGLMeshRegistry &&) = delete;
+  ~OpenGLMeshRegistry() = default;
+
+  [[nodiscard]] OpenGLMeshHandle add(std::string_view name,
+                                     OpenGLMeshCreateInfo const &createInfo);
+  [[nodiscard]] std::optional<OpenGLMeshHandle>
+  find(std::string_view name) const;
+  [[nodiscard]] OpenGLMesh const &get(OpenGLMeshHandle handle) const;
+
+  void bindVertexAttribute(OpenGLMeshHandle handle, GLint location) const;
+  void draw(OpenGLMeshHandle handle, GLsizei instanceCount = 1) const;
+
+  void destroy();
+
+private:
+  std::vector<OpenGLMesh> m_meshes;
+  std::unordered_map<std::string, std::uint32_t> m_indices;
+};
+
+#endif
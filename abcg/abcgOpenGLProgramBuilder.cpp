@@ -0,0 +1,235 @@
+/**
+ * @file abcgOpenGLProgramBuilder.cpp
+ * @brief Definition of abcg::OpenGLProgramBuilder members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProgramBuilder.hpp"
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/html5.h>
+#endif
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "abcgTrace.hpp"
+
+namespace {
+// Same value for the KHR and ARB extensions. Not defined by all GLES headers
+constexpr GLenum completionStatus{0x91B1};
+} // namespace
+
+/**
+ * @brief Starts building a program.
+ *
+ * The shaders are read and their compilation is triggered before the function
+ * returns, but the compile and link status are only queried by
+ * abcg::OpenGLProgramBuilder::poll.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders of the program.
+ * @param onReady Function called by abcg::OpenGLProgramBuilder::poll with the
+ * ID of the program once it is linked. The caller takes ownership of the
+ * program.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ */
+void abcg::OpenGLProgramBuilder::add(
+    std::vector<ShaderSource> const &pathsOrSources, Callback onReady) {
+  if (!m_initialized) {
+    enableParallelCompile();
+    m_initialized = true;
+  }
+
+  if (auto const program{loadCachedOpenGLProgram(pathsOrSources)};
+      program != 0) {
+    m_builds.push_back(
+        {.program = program, .onReady = std::move(onReady), .cached = true});
+    return;
+  }
+
+  m_builds.push_back({.pathsOrSources = pathsOrSources,
+                      .shaders = triggerOpenGLShaderCompile(pathsOrSources),
+                      .onReady = std::move(onReady)});
+}
+
+/**
+ * @brief Advances the builds whose current stage is complete.
+ *
+ * Shaders that finished compiling are linked, and the callbacks of the
+ * programs that finished linking are invoked. Callbacks may add new builds.
+ *
+ * @throw abcg::RuntimeError if a shader failed to compile or a program failed
+ * to link. The exception is thrown after the other builds are advanced and
+ * their callbacks are invoked. Only the first error of the call is thrown.
+ * The failed builds are removed; the other builds are kept.
+ */
+void abcg::OpenGLProgramBuilder::poll() {
+  ABCG_TRACE_ZONE("OpenGLProgramBuilder::poll");
+
+  std::vector<std::pair<Callback, GLuint>> ready;
+  std::exception_ptr error;
+  auto const keepError{[&error] {
+    if (!error) {
+      error = std::current_exception();
+    }
+  }};
+
+  for (auto iter{m_builds.begin()}; iter != m_builds.end();) {
+    auto &build{*iter};
+
+    if (build.program == 0) {
+      // Compiling
+      if (!std::ranges::all_of(build.shaders, [this](auto const &shader) {
+            return isShaderComplete(shader.shader);
+          })) {
+        ++iter;
+        continue;
+      }
+      auto const shaders{std::move(build.shaders)};
+      build.shaders.clear();
+      try {
+        checkOpenGLShaderCompile(shaders);
+        build.program = triggerOpenGLShaderLink(shaders);
+      } catch (...) {
+        keepError();
+        iter = m_builds.erase(iter);
+        continue;
+      }
+      ++iter;
+      continue;
+    }
+
+    // Linking
+    if (!isProgramComplete(build.program)) {
+      ++iter;
+      continue;
+    }
+    try {
+      checkOpenGLShaderLink(build.program);
+    } catch (...) {
+      // The program was deleted by the check
+      keepError();
+      iter = m_builds.erase(iter);
+      continue;
+    }
+    auto const program{build.program};
+    auto const pathsOrSources{std::move(build.pathsOrSources)};
+    auto const cached{build.cached};
+    ready.emplace_back(std::move(build.onReady), program);
+    iter = m_builds.erase(iter);
+    if (!cached) {
+      try {
+        storeCachedOpenGLProgram(pathsOrSources, program);
+      } catch (...) {
+        keepError();
+      }
+    }
+  }
+
+  // Invoked last since callbacks may add new builds
+  for (auto &[onReady, program] : ready) {
+    if (onReady) {
+      onReady(program);
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * @brief Waits until all builds are complete.
+ *
+ * The callbacks are invoked as in abcg::OpenGLProgramBuilder::poll, and the
+ * builds they add are waited for as well. The compile and link status are
+ * queried without checking `GL_COMPLETION_STATUS_KHR` first, so the driver
+ * blocks until each stage is done instead of being polled in a loop.
+ *
+ * @throw abcg::RuntimeError as in abcg::OpenGLProgramBuilder::poll.
+ */
+void abcg::OpenGLProgramBuilder::finish() {
+  ABCG_TRACE_ZONE("OpenGLProgramBuilder::finish");
+
+  m_finishing = true;
+  auto const restore{gsl::finally([this] { m_finishing = false; })};
+  while (!m_builds.empty()) {
+    poll();
+  }
+}
+
+/**
+ * @brief Cancels the pending builds and releases their OpenGL objects.
+ */
+void abcg::OpenGLProgramBuilder::destroy() {
+  for (auto const &build : m_builds) {
+    for (auto const &shader : build.shaders) {
+      glDeleteShader(shader.shader);
+    }
+    glDeleteProgram(build.program);
+  }
+  m_builds.clear();
+}
+
+/**
+ * @brief Returns the number of programs not yet ready.
+ *
+ * @return Number of pending builds.
+ */
+std::size_t abcg::OpenGLProgramBuilder::getPendingCount() const noexcept {
+  return m_builds.size();
+}
+
+/**
+ * @brief Returns whether the driver compiles shaders in parallel.
+ *
+ * @return True if a parallel shader compile extension was enabled by the
+ * first call to abcg::OpenGLProgramBuilder::add.
+ */
+bool abcg::OpenGLProgramBuilder::isParallel() const noexcept {
+  return m_parallel;
+}
+
+void abcg::OpenGLProgramBuilder::enableParallelCompile() {
+#if defined(__EMSCRIPTEN__)
+  m_parallel = emscripten_webgl_enable_extension(
+                   emscripten_webgl_get_current_context(),
+                   "KHR_parallel_shader_compile") == EM_TRUE;
+#else
+  // Let the driver choose the number of compiler threads
+  auto const maxThreads{0xFFFFFFFFU};
+  if (GLEW_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(maxThreads);
+    m_parallel = true;
+  } else if (GLEW_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(maxThreads);
+    m_parallel = true;
+  }
+#endif
+}
+
+bool abcg::OpenGLProgramBuilder::isShaderComplete(GLuint shader) const {
+  if (!m_parallel || m_finishing) {
+    return true;
+  }
+  GLint status{};
+  glGetShaderiv(shader, completionStatus, &status);
+  return status == GL_TRUE;
+}
+
+bool abcg::OpenGLProgramBuilder::isProgramComplete(GLuint program) const {
+  if (!m_parallel || m_finishing) {
+    return true;
+  }
+  GLint status{};
+  glGetProgramiv(program, completionStatus, &status);
+  return status == GL_TRUE;
+}
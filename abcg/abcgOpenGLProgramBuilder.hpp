@@ -0,0 +1,90 @@
+/**
+ * @file abcgOpenGLProgramBuilder.hpp
+ * @brief Header file of abcg::OpenGLProgramBuilder.
+ *
+ * Declaration of abcg::OpenGLProgramBuilder.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROGRAM_BUILDER_HPP_
+#define ABCG_OPENGL_PROGRAM_BUILDER_HPP_
+
+#include "abcgOpenGLShader.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace abcg {
+class OpenGLProgramBuilder;
+} // namespace abcg
+
+/**
+ * @brief Builds OpenGL programs without blocking the application.
+ *
+ * Programs added with abcg::OpenGLProgramBuilder::add are compiled and linked
+ * in the background. abcg::OpenGLProgramBuilder::poll must be called once per
+ * frame (e.g., in abcg::OpenGLWindow::onUpdate). It advances each build whose
+ * current stage is complete and invokes the callback of each program that is
+ * ready.
+ *
+ * If the driver supports `GL_KHR_parallel_shader_compile` (or
+ * `GL_ARB_parallel_shader_compile`), the extension is enabled and builds are
+ * only advanced when `GL_COMPLETION_STATUS_KHR` reports that the driver has
+ * finished, so polling never waits for the compiler. Otherwise, each build
+ * advances one stage per poll, which spreads the cost over several frames.
+ * abcg::OpenGLProgramBuilder::finish waits for all builds at once.
+ *
+ * Programs found in the program binary cache (see
+ * abcg::setOpenGLProgramCachePath) are ready on the next poll, and programs
+ * built from source are added to the cache.
+ *
+ * @sa abcg::triggerOpenGLShaderCompile for the underlying build steps.
+ */
+class abcg::OpenGLProgramBuilder {
+public:
+  /**
+   * @brief Function called with the ID of a program when it is ready.
+   */
+  using Callback = std::function<void(GLuint)>;
+
+  OpenGLProgramBuilder() = default;
+  OpenGLProgramBuilder(OpenGLProgramBuilder const &) = delete;
+  OpenGLProgramBuilder &operator=(OpenGLProgramBuilder const &) = delete;
+  OpenGLProgramBuilder(OpenGLProgramBuilder &&) = delete;
+  OpenGLProgramBuilder &operator=(OpenGLProgramBuilder &&) = delete;
+  ~OpenGLProgramBuilder() = default;
+
+  void add(std::vector<ShaderSource> const &pathsOrSources, Callback onReady);
+  void poll();
+  void finish();
+  void destroy();
+
+  [[nodiscard]] std::size_t getPendingCount() const noexcept;
+  [[nodiscard]] bool isParallel() const noexcept;
+
+private:
+  struct Build {
+    std::vector<ShaderSource> pathsOrSources{};
+    std::vector<OpenGLShader> shaders{};
+    GLuint program{};
+    Callback onReady{};
+    bool cached{};
+  };
+
+  void enableParallelCompile();
+  [[nodiscard]] bool isShaderComplete(GLuint shader) const;
+  [[nodiscard]] bool isProgramComplete(GLuint program) const;
+
+  std::vector<Build> m_builds;
+  bool m_initialized{};
+  bool m_parallel{};
+  // Set by finish() to query the build status without polling
+  bool m_finishing{};
+};
+
+#endif
@@ -16,12 +16,20 @@
 
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <string>
+#include <system_error>
 #include <vector>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
+#include "abcgUtil.hpp"
 
 namespace {
+// Directory of the program binary cache. Empty if the cache is disabled
+std::string programCachePath;
+
 void printShaderInfoLog(GLuint const shader, std::string_view prefix) {
   GLint infoLogLength{};
   glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
@@ -141,11 +149,116 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
     throw abcg::RuntimeError("Unknown shader stage");
   }
 }
+
+#if !defined(__EMSCRIPTEN__)
+// Returns true if the cache is enabled and supported by the driver
+[[nodiscard]] bool isProgramCacheEnabled() {
+  if (programCachePath.empty() ||
+      !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+    return false;
+  }
+  GLint formatCount{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+  return formatCount > 0;
+}
+
+// Returns the cache file of the program built from the given sources, or an
+// empty path if the cache is disabled or unsupported by the driver
+[[nodiscard]] std::filesystem::path
+programCacheFile(std::vector<abcg::ShaderSource> const &sources) {
+  if (!isProgramCacheEnabled()) {
+    return {};
+  }
+
+  // Binaries are only valid for the driver that created them
+  auto const getString{[](GLenum name) {
+    auto const *string{glGetString(name)};
+    return std::string{string == nullptr
+                           ? ""
+                           : reinterpret_cast<char const *>(string)};
+  }};
+  auto hash{abcg::hashCombine(getString(GL_VENDOR), getString(GL_RENDERER),
+                              getString(GL_VERSION))};
+  for (auto const &source : sources) {
+    abcg::hashCombineSeed(hash, source.source, static_cast<int>(source.stage));
+  }
+
+  return std::filesystem::path{programCachePath} /
+         fmt::format("{:016x}.bin", hash);
+}
+
+// Creates a program from a cached binary. Returns 0 if there is no binary or
+// if the driver rejects it
+[[nodiscard]] GLuint loadCachedProgram(std::filesystem::path const &file) {
+  std::ifstream stream{file, std::ios::binary};
+  if (!stream) {
+    return 0;
+  }
+
+  GLenum format{};
+  stream.read(reinterpret_cast<char *>(&format), sizeof(format));
+  std::vector<char> const binary{std::istreambuf_iterator<char>{stream},
+                                 std::istreambuf_iterator<char>{}};
+  if (binary.empty()) {
+    return 0;
+  }
+
+  auto const program{glCreateProgram()};
+  glProgramBinary(program, format, binary.data(),
+                  gsl::narrow<GLsizei>(binary.size()));
+
+  GLint linkStatus{};
+  glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == GL_FALSE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+// Stores the binary of a linked program. Failures are not fatal since the
+// program can always be built from source again
+void saveCachedProgram(GLuint program, std::filesystem::path const &file) {
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(gsl::narrow<std::size_t>(length));
+  GLenum format{};
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  // Write to a temporary file first so that a partially written binary is
+  // never read
+  std::error_code error;
+  std::filesystem::create_directories(file.parent_path(), error);
+  auto temporaryFile{file};
+  temporaryFile += ".tmp";
+  std::ofstream stream{temporaryFile, std::ios::binary};
+  stream.write(reinterpret_cast<char const *>(&format), sizeof(format));
+  stream.write(binary.data(), gsl::narrow<std::streamsize>(binary.size()));
+  stream.close();
+  if (stream) {
+    std::filesystem::rename(temporaryFile, file, error);
+  }
+  if (!stream || error) {
+    std::filesystem::remove(temporaryFile, error);
+    fmt::print("Failed to write program cache file {}\n", file.string());
+  }
+}
+#endif
 } // namespace
 
 /**
  * @brief Creates a program object from a group of shader paths or source codes.
  *
+ * If the program binary cache is enabled with abcg::setOpenGLProgramCachePath,
+ * the program is first looked up in the cache by a hash of its sources and of
+ * the driver vendor, renderer and version. On a cache hit, no shader is
+ * compiled. Otherwise, the program is built from source and its binary is
+ * added to the cache.
+ *
  * @param pathsOrSources Paths or source codes of the shaders to be compiled and
  * linked to the program.
  * @param throwOnError Whether to throw exceptions on compile/link errors.
@@ -159,6 +272,8 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
 GLuint
 abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
                           bool throwOnError) {
+  ABCG_TRACE_ZONE("createOpenGLProgram");
+
   std::vector<ShaderSource> sources;
   sources.reserve(pathsOrSources.size());
   for (auto const &pathOrSource : pathsOrSources) {
@@ -166,6 +281,17 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
         {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
   }
 
+#if !defined(__EMSCRIPTEN__)
+  // Skip compilation entirely if the program is in the cache
+  auto const cacheFile{programCacheFile(sources)};
+  if (!cacheFile.empty()) {
+    if (auto const cachedProgram{loadCachedProgram(cacheFile)};
+        cachedProgram != 0) {
+      return cachedProgram;
+    }
+  }
+#endif
+
   std::vector<OpenGLShader> compiledShaders;
   compiledShaders.reserve(sources.size());
   for (auto const &source : sources) {
@@ -189,6 +315,13 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (!cacheFile.empty()) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : compiledShaders) {
@@ -209,6 +342,12 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     return 0U;
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (!cacheFile.empty()) {
+    saveCachedProgram(shaderProgram, cacheFile);
+  }
+#endif
+
   return shaderProgram;
 }
 
@@ -237,6 +376,8 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
  */
 std::vector<abcg::OpenGLShader> abcg::triggerOpenGLShaderCompile(
     std::vector<ShaderSource> const &pathsOrSources) {
+  ABCG_TRACE_ZONE("triggerOpenGLShaderCompile");
+
   std::vector<ShaderSource> sources;
   sources.reserve(pathsOrSources.size());
   for (auto const &pathOrSource : pathsOrSources) {
@@ -308,6 +449,8 @@ bool abcg::checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
  */
 GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                      bool throwOnError) {
+  ABCG_TRACE_ZONE("triggerOpenGLShaderLink");
+
   auto const shaderProgram{glCreateProgram()};
   if (shaderProgram == 0) {
     deleteShaders(shaders);
@@ -321,6 +464,14 @@ GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  // Allow the program to be stored with abcg::storeCachedOpenGLProgram
+  if (isProgramCacheEnabled()) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : shaders) {
@@ -361,4 +512,87 @@ bool abcg::checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError) {
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Sets the directory of the program binary cache.
+ *
+ * The cache is used by abcg::createOpenGLProgram to skip the compilation of
+ * programs that were already built in a previous run. It requires OpenGL 4.1
+ * or the `GL_ARB_get_program_binary` extension and is ignored otherwise, and
+ * on WebGL. The directory is created when the first binary is stored.
+ *
+ * abcg::OpenGLWindow calls this function with
+ * abcg::OpenGLSettings::programCachePath before abcg::OpenGLWindow::onCreate.
+ *
+ * @param path Path of the cache directory. An empty path disables the cache.
+ */
+void abcg::setOpenGLProgramCachePath(std::string_view path) {
+  programCachePath = path;
+}
+
+/**
+ * @brief Creates a program from the program binary cache.
+ *
+ * This is the cache lookup done by abcg::createOpenGLProgram, for programs
+ * built with abcg::triggerOpenGLShaderCompile and
+ * abcg::triggerOpenGLShaderLink.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders of the program.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ *
+ * @return ID of the linked program object, or 0 if the program is not in the
+ * cache or if the cache is disabled.
+ *
+ * @sa abcg::storeCachedOpenGLProgram.
+ */
+GLuint abcg::loadCachedOpenGLProgram(
+    [[maybe_unused]] std::vector<ShaderSource> const &pathsOrSources) {
+#if !defined(__EMSCRIPTEN__)
+  if (!isProgramCacheEnabled()) {
+    return 0;
+  }
+
+  std::vector<ShaderSource> sources;
+  sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    sources.push_back(
+        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  }
+  return loadCachedProgram(programCacheFile(sources));
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Adds the binary of a linked program to the program binary cache.
+ *
+ * Does nothing if the cache is disabled.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders the program was
+ * built from.
+ * @param shaderProgram ID of a program that was successfully linked.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ *
+ * @sa abcg::loadCachedOpenGLProgram.
+ */
+void abcg::storeCachedOpenGLProgram(
+    [[maybe_unused]] std::vector<ShaderSource> const &pathsOrSources,
+    [[maybe_unused]] GLuint shaderProgram) {
+#if !defined(__EMSCRIPTEN__)
+  if (!isProgramCacheEnabled()) {
+    return;
+  }
+
+  std::vector<ShaderSource> sources;
+  sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    sources.push_back(
+        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  }
+  saveCachedProgram(shaderProgram, programCacheFile(sources));
+#endif
+}
@@ -14,6 +14,7 @@
 #include "abcgOpenGLExternal.hpp"
 #include "abcgShader.hpp"
 
+#include <string_view>
 #include <vector>
 
 namespace abcg {
@@ -41,6 +42,11 @@ bool checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
 GLuint triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                bool throwOnError = true);
 bool checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError = true);
+void setOpenGLProgramCachePath(std::string_view path);
+[[nodiscard]] GLuint
+loadCachedOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources);
+void storeCachedOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
+                              GLuint shaderProgram);
 } // namespace abcg
 
 #endif
@@ -0,0 +1,533 @@
+/**
+ * @file abcgOpenGLTextureLoader.cpp
+ * @brief Definition of abcg::OpenGLTextureLoader members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLTextureLoader.hpp"
+#include "abcgImage.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+/**
+ * @brief Returns whether the texture is ready to be used.
+ *
+ * @return True if the texture was uploaded and its mipmap levels were
+ * generated.
+ */
+bool abcg::OpenGLTextureHandle::isReady() const noexcept {
+  return m_state && m_state->ready;
+}
+
+/**
+ * @brief Returns whether the texture failed to load.
+ *
+ * @return True if any image of the texture could not be loaded.
+ */
+bool abcg::OpenGLTextureHandle::hasFailed() const noexcept {
+  return m_state && m_state->failed;
+}
+
+/**
+ * @brief Returns the ID of the texture.
+ *
+ * @return ID of the texture, as generated by glGenTextures, or 0 if the
+ * texture is not ready. The caller takes ownership of the texture once it is
+ * ready.
+ */
+GLuint abcg::OpenGLTextureHandle::getID() const noexcept {
+  return isReady() ? m_state->id : 0;
+}
+
+/**
+ * @brief Destructor.
+ *
+ * Stops the worker threads. OpenGL objects are only released by
+ * abcg::OpenGLTextureLoader::destroy.
+ */
+abcg::OpenGLTextureLoader::~OpenGLTextureLoader() {
+  stopWorkers();
+  popDecoded();
+}
+
+/**
+ * @brief Creates the worker threads and the pixel unpack buffers.
+ *
+ * @param threadCount Number of worker threads that decode images. If zero,
+ * the number of hardware threads minus one (at least one) is used. Ignored
+ * under Emscripten.
+ * @param pixelBufferCount Number of pixel unpack buffers in the ring.
+ * @param uploadBudget Maximum number of bytes uploaded per call to
+ * abcg::OpenGLTextureLoader::poll. At least one image is uploaded per call,
+ * regardless of its size.
+ */
+void abcg::OpenGLTextureLoader::create(std::size_t threadCount,
+                                       std::size_t pixelBufferCount,
+                                       std::size_t uploadBudget) {
+  destroy();
+
+  m_uploadBudget = uploadBudget;
+
+  m_pixelBuffers.resize(std::max(pixelBufferCount, std::size_t{1}));
+  for (auto &pixelBuffer : m_pixelBuffers) {
+    glGenBuffers(1, &pixelBuffer.buffer);
+  }
+  m_nextPixelBuffer = 0;
+
+#if !defined(__EMSCRIPTEN__)
+  if (threadCount == 0) {
+    threadCount =
+        std::max(std::size_t{std::thread::hardware_concurrency()},
+                 std::size_t{2}) -
+        1;
+  }
+  m_stopping = false;
+  for ([[maybe_unused]] auto const index : iter::range(threadCount)) {
+    m_workers.emplace_back([this] { workerLoop(); });
+  }
+#else
+  static_cast<void>(threadCount);
+#endif
+}
+
+/**
+ * @brief Cancels the pending loads and releases the OpenGL objects of the
+ * loader.
+ *
+ * Textures of pending loads are deleted and their handles are marked as
+ * failed. Textures already ready are owned by the caller and are kept.
+ */
+void abcg::OpenGLTextureLoader::destroy() {
+  stopWorkers();
+  popDecoded();
+
+  // Every pending request has at least one image waiting to be decoded or
+  // uploaded
+  auto const cancel{[](Request const &request) {
+    auto &state{*request.state};
+    if (!state.ready && !state.failed) {
+      glDeleteTextures(1, &state.id);
+      state.id = 0;
+      state.failed = true;
+    }
+  }};
+  for (auto const &job : m_jobs) {
+    cancel(*job.request);
+  }
+  for (auto const &decoded : m_uploads) {
+    cancel(*decoded->request);
+  }
+  m_jobs.clear();
+  m_uploads.clear();
+
+  for (auto &pixelBuffer : m_pixelBuffers) {
+    if (pixelBuffer.fence != nullptr) {
+      glDeleteSync(pixelBuffer.fence);
+    }
+    glDeleteBuffers(1, &pixelBuffer.buffer);
+  }
+  m_pixelBuffers.clear();
+  m_pendingCount = 0;
+}
+
+/**
+ * @brief Starts loading a 2D texture.
+ *
+ * As in abcg::loadOpenGLTexture, KTX2 files are uploaded with the mipmap
+ * levels they contain, and the flags of @a createInfo are ignored for them.
+ *
+ * @param createInfo Texture creation settings.
+ * @param onReady Function called by abcg::OpenGLTextureLoader::poll with the
+ * ID of the texture once it is ready. The caller takes ownership of the
+ * texture.
+ *
+ * @return Handle to the texture.
+ */
+abcg::OpenGLTextureHandle abcg::OpenGLTextureLoader::loadTexture(
+    OpenGLTextureCreateInfo const &createInfo, Callback onReady) {
+  OpenGLTextureHandle handle;
+  handle.m_state = std::make_shared<OpenGLTextureHandle::State>();
+
+  auto const request{std::make_shared<Request>(
+      Request{.state = handle.m_state,
+              .target = GL_TEXTURE_2D,
+              // KTX2 files bring their own mipmap levels
+              .generateMipmaps = createInfo.generateMipmaps &&
+                                 !isKTX2Path(createInfo.path),
+              .onReady = std::move(onReady),
+              .remainingImages = 1})};
+  ++m_pendingCount;
+
+  {
+    std::scoped_lock lock{m_mutex};
+    m_jobs.push_back({.request = request,
+                      .path = std::string{createInfo.path},
+                      .target = GL_TEXTURE_2D,
+                      .flipVertically = createInfo.flipUpsideDown,
+                      .sRGBToLinear = createInfo.sRGBToLinear});
+  }
+  m_jobAdded.notify_one();
+
+  return handle;
+}
+
+/**
+ * @brief Starts loading a cubemap texture.
+ *
+ * Each side of the cube is decoded by a separate job.
+ *
+ * @param createInfo Texture creation settings.
+ * @param onReady Function called by abcg::OpenGLTextureLoader::poll with the
+ * ID of the texture once all sides are uploaded. The caller takes ownership
+ * of the texture.
+ *
+ * @return Handle to the texture.
+ */
+abcg::OpenGLTextureHandle abcg::OpenGLTextureLoader::loadCubemap(
+    OpenGLCubemapCreateInfo const &createInfo, Callback onReady) {
+  OpenGLTextureHandle handle;
+  handle.m_state = std::make_shared<OpenGLTextureHandle::State>();
+
+  auto const request{std::make_shared<Request>(
+      Request{.state = handle.m_state,
+              .target = GL_TEXTURE_CUBE_MAP,
+              .generateMipmaps = createInfo.generateMipmaps,
+              .onReady = std::move(onReady),
+              .remainingImages = createInfo.paths.size()})};
+  ++m_pendingCount;
+
+  {
+    std::scoped_lock lock{m_mutex};
+    for (auto &&[index, path] : iter::enumerate(createInfo.paths)) {
+      auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+      auto const yAxis{target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
+                       target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y};
+
+      // LHS to RHS: flip the sides and swap -z and +z
+      if (createInfo.rightHandedSystem) {
+        if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Z)
+          target = GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+        else if (target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+          target = GL_TEXTURE_CUBE_MAP_POSITIVE_Z;
+      }
+
+      m_jobs.push_back(
+          {.request = request,
+           .path = std::string{path},
+           .target = target,
+           .flipVertically = createInfo.rightHandedSystem && yAxis,
+           .flipHorizontally = createInfo.rightHandedSystem && !yAxis,
+           .forceRGB = true});
+    }
+  }
+  m_jobAdded.notify_all();
+
+  return handle;
+}
+
+/**
+ * @brief Uploads the images decoded so far and completes the textures whose
+ * images are all uploaded.
+ *
+ * Must be called on the thread of the OpenGL context. Callbacks may start
+ * new loads.
+ *
+ * @throw abcg::RuntimeError if an image could not be loaded, or if the format
+ * of a KTX2 file is not supported by the device. The texture it belongs to is
+ * deleted and its handle is marked as failed; the other loads are kept. If
+ * several loads failed, the error of the first one is thrown after all of
+ * them are marked as failed.
+ */
+void abcg::OpenGLTextureLoader::poll() {
+  ABCG_TRACE_ZONE("OpenGLTextureLoader::poll");
+
+  // Without worker threads, decode one image per poll
+  if (m_workers.empty()) {
+    std::unique_lock lock{m_mutex};
+    if (!m_jobs.empty()) {
+      auto const job{std::move(m_jobs.front())};
+      m_jobs.pop_front();
+      lock.unlock();
+      pushDecoded(decode(job));
+    }
+  }
+
+  popDecoded();
+
+  std::vector<std::pair<Callback, GLuint>> ready;
+  std::string error;
+  std::size_t uploadedBytes{};
+
+  while (!m_uploads.empty()) {
+    auto &decoded{*m_uploads.front()};
+    auto &request{*decoded.request};
+    auto &state{*request.state};
+
+    if (decoded.error.empty() && decoded.ktx2 &&
+        !isOpenGLTextureFormatSupported(decoded.ktx2->format)) {
+      decoded.error = fmt::format(
+          "Texture format of {} is not supported by the device", decoded.path);
+    }
+
+    // Images of a texture that has already failed are discarded
+    if (!state.failed) {
+      if (!decoded.error.empty()) {
+        state.failed = true;
+        glDeleteTextures(1, &state.id);
+        state.id = 0;
+        --m_pendingCount;
+        if (error.empty()) {
+          error = decoded.error;
+        }
+      } else {
+        std::size_t size{};
+        if (decoded.ktx2) {
+          for (auto const &level : decoded.ktx2->levels) {
+            size += level.data.size();
+          }
+        } else {
+          size = gsl::narrow<std::size_t>(decoded.surface->pitch *
+                                          decoded.surface->h);
+        }
+        if (uploadedBytes > 0 && uploadedBytes + size > m_uploadBudget) {
+          break;
+        }
+        if (decoded.ktx2) {
+          // Uploaded from client memory, without a pixel unpack buffer
+          state.id = createOpenGLTexture(*decoded.ktx2);
+          decoded.ktx2.reset();
+        } else {
+          auto *const pixelBuffer{acquirePixelBuffer()};
+          if (pixelBuffer == nullptr) {
+            break;
+          }
+          upload(decoded, *pixelBuffer);
+        }
+        uploadedBytes += size;
+
+        if (--request.remainingImages == 0) {
+          if (request.generateMipmaps) {
+            glBindTexture(request.target, state.id);
+            glGenerateMipmap(request.target);
+            glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER,
+                            GL_LINEAR_MIPMAP_LINEAR);
+            glBindTexture(request.target, 0);
+          }
+          state.ready = true;
+          --m_pendingCount;
+          ready.emplace_back(std::move(request.onReady), state.id);
+        }
+      }
+    }
+
+    m_uploads.pop_front();
+  }
+
+  // Invoked last since callbacks may start new loads
+  for (auto &[onReady, textureID] : ready) {
+    if (onReady) {
+      onReady(textureID);
+    }
+  }
+
+  if (!error.empty()) {
+    throw abcg::RuntimeError(error);
+  }
+}
+
+/**
+ * @brief Returns the number of textures not yet ready.
+ *
+ * @return Number of pending loads.
+ */
+std::size_t abcg::OpenGLTextureLoader::getPendingCount() const noexcept {
+  return m_pendingCount;
+}
+
+void abcg::OpenGLTextureLoader::stopWorkers() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_jobAdded.notify_all();
+  m_workers.clear();
+}
+
+void abcg::OpenGLTextureLoader::workerLoop() {
+  while (true) {
+    std::unique_lock lock{m_mutex};
+    m_jobAdded.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+    if (m_stopping) {
+      return;
+    }
+    auto const job{std::move(m_jobs.front())};
+    m_jobs.pop_front();
+    lock.unlock();
+
+    pushDecoded(decode(job));
+  }
+}
+
+std::unique_ptr<abcg::OpenGLTextureLoader::Decoded>
+abcg::OpenGLTextureLoader::decode(Job const &job) {
+  ABCG_TRACE_ZONE("OpenGLTextureLoader::decode");
+
+  auto decoded{std::make_unique<Decoded>()};
+  decoded->request = job.request;
+  decoded->target = job.target;
+  decoded->path = job.path;
+
+  // The format of KTX2 files can only be checked on the OpenGL thread
+  if (job.target == GL_TEXTURE_2D && isKTX2Path(job.path)) {
+    try {
+      decoded->ktx2 = loadKTX2(job.path);
+    } catch (std::exception const &) {
+      decoded->error = fmt::format("Failed to load texture file {}", job.path);
+    }
+    return decoded;
+  }
+
+  SDL_Surface *const surface{IMG_Load(job.path.c_str())};
+  if (surface == nullptr) {
+    decoded->error = fmt::format("Failed to load texture file {}", job.path);
+    return decoded;
+  }
+
+  // Enforce RGB/RGBA
+  if (job.forceRGB || surface->format->BytesPerPixel == 3) {
+    decoded->surface.reset(convertSurface(surface, SDL_PIXELFORMAT_RGB24));
+    decoded->internalFormat = job.sRGBToLinear ? GL_SRGB8 : GL_RGB;
+    decoded->format = GL_RGB;
+  } else {
+    decoded->surface.reset(convertSurface(surface, SDL_PIXELFORMAT_RGBA32));
+    decoded->internalFormat = job.sRGBToLinear ? GL_SRGB8_ALPHA8 : GL_RGBA;
+    decoded->format = GL_RGBA;
+  }
+
+  if (!decoded->surface) {
+    decoded->error = fmt::format("Failed to convert texture file {}", job.path);
+    return decoded;
+  }
+
+  if (job.flipVertically) {
+    flipVertically(*decoded->surface);
+  }
+  if (job.flipHorizontally) {
+    flipHorizontally(*decoded->surface);
+  }
+
+  return decoded;
+}
+
+void abcg::OpenGLTextureLoader::pushDecoded(std::unique_ptr<Decoded> decoded) {
+  // Lock-free push to the front of the list
+  auto *const node{decoded.release()};
+  node->next = m_decodedHead.load(std::memory_order_relaxed);
+  while (!m_decodedHead.compare_exchange_weak(node->next, node,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed))
+    ;
+}
+
+void abcg::OpenGLTextureLoader::popDecoded() {
+  // Take the whole list at once and restore the order in which images were
+  // pushed
+  auto *node{m_decodedHead.exchange(nullptr, std::memory_order_acquire)};
+  std::vector<std::unique_ptr<Decoded>> nodes;
+  while (node != nullptr) {
+    nodes.emplace_back(std::exchange(node, node->next));
+  }
+  std::ranges::move(nodes.rbegin(), nodes.rend(),
+                    std::back_inserter(m_uploads));
+}
+
+abcg::OpenGLTextureLoader::PixelBuffer *
+abcg::OpenGLTextureLoader::acquirePixelBuffer() {
+  auto &pixelBuffer{m_pixelBuffers.at(m_nextPixelBuffer)};
+  if (pixelBuffer.fence != nullptr) {
+    // Do not wait for the upload that last read the buffer
+    if (auto const status{glClientWaitSync(pixelBuffer.fence, 0, 0)};
+        status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      return nullptr;
+    }
+    glDeleteSync(pixelBuffer.fence);
+    pixelBuffer.fence = nullptr;
+  }
+  m_nextPixelBuffer = (m_nextPixelBuffer + 1) % m_pixelBuffers.size();
+  return &pixelBuffer;
+}
+
+void abcg::OpenGLTextureLoader::upload(Decoded &decoded,
+                                       PixelBuffer &pixelBuffer) {
+  ABCG_TRACE_ZONE("OpenGLTextureLoader::upload");
+
+  auto &surface{*decoded.surface};
+  auto &request{*decoded.request};
+  auto &state{*request.state};
+  auto const size{gsl::narrow<GLsizeiptr>(surface.pitch * surface.h)};
+
+  // Copy the pixels to the buffer
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+#if defined(__EMSCRIPTEN__)
+  // WebGL cannot map buffers
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, surface.pixels, GL_STREAM_DRAW);
+  pixelBuffer.size = size;
+#else
+  if (pixelBuffer.size < size) {
+    pixelBuffer.size = size;
+  }
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.size, nullptr,
+               GL_STREAM_DRAW);
+  auto *const mapped{glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                      GL_MAP_WRITE_BIT |
+                                          GL_MAP_INVALIDATE_BUFFER_BIT)};
+  std::memcpy(mapped, surface.pixels, gsl::narrow<std::size_t>(size));
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+#endif
+
+  // Generate the texture on its first image
+  if (state.id == 0) {
+    glGenTextures(1, &state.id);
+    glBindTexture(request.target, state.id);
+    if (request.target == GL_TEXTURE_CUBE_MAP) {
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(request.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  } else {
+    glBindTexture(request.target, state.id);
+  }
+
+  // Upload from the buffer (offset 0)
+  glTexImage2D(decoded.target, 0, gsl::narrow<GLint>(decoded.internalFormat),
+               surface.w, surface.h, 0, decoded.format, GL_UNSIGNED_BYTE,
+               nullptr);
+
+  glBindTexture(request.target, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  // The buffer is reused only after the upload has read it
+  pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  decoded.surface.reset();
+}
@@ -0,0 +1,184 @@
+/**
+ * @file abcgOpenGLTextureLoader.hpp
+ * @brief Header file of abcg::OpenGLTextureLoader.
+ *
+ * Declaration of abcg::OpenGLTextureLoader and abcg::OpenGLTextureHandle.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_TEXTURE_LOADER_HPP_
+#define ABCG_OPENGL_TEXTURE_LOADER_HPP_
+
+#include "abcgOpenGLImage.hpp"
+
+#include <SDL_image.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace abcg {
+class OpenGLTextureHandle;
+class OpenGLTextureLoader;
+} // namespace abcg
+
+/**
+ * @brief Handle to a texture being loaded by abcg::OpenGLTextureLoader.
+ *
+ * Handles are cheap to copy. All copies refer to the same texture.
+ */
+class abcg::OpenGLTextureHandle {
+public:
+  [[nodiscard]] bool isReady() const noexcept;
+  [[nodiscard]] bool hasFailed() const noexcept;
+  [[nodiscard]] GLuint getID() const noexcept;
+
+private:
+  friend class OpenGLTextureLoader;
+
+  // Only accessed by the thread that calls abcg::OpenGLTextureLoader::poll
+  struct State {
+    GLuint id{};
+    bool ready{};
+    bool failed{};
+  };
+
+  std::shared_ptr<State> m_state;
+};
+
+/**
+ * @brief Loads OpenGL textures without blocking the application.
+ *
+ * Images requested with abcg::OpenGLTextureLoader::loadTexture and
+ * abcg::OpenGLTextureLoader::loadCubemap are decoded, converted to RGB/RGBA
+ * and flipped by a pool of worker threads. The six faces of a cubemap are
+ * decoded in parallel. KTX2 textures are only read by the workers, and are
+ * uploaded as stored, as in abcg::loadOpenGLTexture. Decoded images are
+ * handed to the OpenGL thread through a lock-free queue.
+ *
+ * abcg::OpenGLTextureLoader::poll must be called once per frame on the thread
+ * of the OpenGL context (e.g., in abcg::OpenGLWindow::onUpdate). It copies the
+ * decoded images to a ring of pixel unpack buffers and uploads them from
+ * there. A buffer of the ring is only reused after a fence signals that the
+ * upload that read it is complete, and the number of bytes uploaded per poll
+ * is limited, so that loading many textures is spread over several frames.
+ *
+ * Under Emscripten, images are decoded by abcg::OpenGLTextureLoader::poll
+ * itself, one per call, since there are no worker threads.
+ *
+ * The worker threads use SDL_image, which is initialized by
+ * abcg::Application::run.
+ *
+ * @remark Objects of this type cannot be copied or copy-constructed.
+ */
+class abcg::OpenGLTextureLoader {
+public:
+  /**
+   * @brief Function called with the ID of a texture when it is ready.
+   */
+  using Callback = std::function<void(GLuint)>;
+
+  OpenGLTextureLoader() = default;
+  OpenGLTextureLoader(OpenGLTextureLoader const &) = delete;
+  OpenGLTextureLoader &operator=(OpenGLTextureLoader const &) = delete;
+  OpenGLTextureLoader(OpenGLTextureLoader &&) = delete;
+  OpenGLTextureLoader &operator=(OpenGLTextureLoader &&) = delete;
+  ~OpenGLTextureLoader();
+
+  void create(std::size_t threadCount = 0, std::size_t pixelBufferCount = 3,
+              std::size_t uploadBudget = 16UL * 1024UL * 1024UL);
+  void destroy();
+
+  OpenGLTextureHandle loadTexture(OpenGLTextureCreateInfo const &createInfo,
+                                  Callback onReady = {});
+  OpenGLTextureHandle loadCubemap(OpenGLCubemapCreateInfo const &createInfo,
+                                  Callback onReady = {});
+  void poll();
+
+  [[nodiscard]] std::size_t getPendingCount() const noexcept;
+
+private:
+  // Texture being loaded. Only accessed by the OpenGL thread
+  struct Request {
+    std::shared_ptr<OpenGLTextureHandle::State> state;
+    GLenum target{};
+    bool generateMipmaps{};
+    Callback onReady;
+    std::size_t remainingImages{};
+  };
+
+  // Image to be decoded by a worker
+  struct Job {
+    std::shared_ptr<Request> request;
+    std::string path;
+    GLenum target{};
+    bool flipVertically{};
+    bool flipHorizontally{};
+    bool forceRGB{};
+    bool sRGBToLinear{};
+  };
+
+  struct SurfaceDeleter {
+    void operator()(SDL_Surface *surface) const { SDL_FreeSurface(surface); }
+  };
+
+  // Node of the queue of decoded images
+  struct Decoded {
+    Decoded *next{};
+    std::shared_ptr<Request> request;
+    GLenum target{};
+    GLenum internalFormat{};
+    GLenum format{};
+    std::unique_ptr<SDL_Surface, SurfaceDeleter> surface;
+    // Uploaded as stored instead of the surface
+    std::optional<KTX2Image> ktx2;
+    std::string path;
+    std::string error;
+  };
+
+  struct PixelBuffer {
+    GLuint buffer{};
+    GLsizeiptr size{};
+    GLsync fence{};
+  };
+
+  void stopWorkers();
+  void workerLoop();
+  [[nodiscard]] static std::unique_ptr<Decoded> decode(Job const &job);
+  void pushDecoded(std::unique_ptr<Decoded> decoded);
+  void popDecoded();
+  [[nodiscard]] PixelBuffer *acquirePixelBuffer();
+  void upload(Decoded &decoded, PixelBuffer &pixelBuffer);
+
+  std::size_t m_uploadBudget{};
+  std::size_t m_pendingCount{};
+
+  // Jobs waiting for a worker
+  std::vector<std::jthread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_jobAdded;
+  std::deque<Job> m_jobs;
+  bool m_stopping{};
+
+  // Decoded images pushed by the workers, most recent first, and decoded
+  // images popped by the OpenGL thread but not yet uploaded
+  std::atomic<Decoded *> m_decodedHead{};
+  std::deque<std::unique_ptr<Decoded>> m_uploads;
+
+  std::vector<PixelBuffer> m_pixelBuffers;
+  std::size_t m_nextPixelBuffer{};
+};
+
+#endif
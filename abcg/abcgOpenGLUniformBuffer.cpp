@@ -0,0 +1,159 @@
+/**
+ * @file abcgOpenGLUniformBuffer.cpp
+ * @brief Definition of abcg::OpenGLUniformBuffer members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLUniformBuffer.hpp"
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <string>
+
+#include "abcgException.hpp"
+
+/**
+ * @brief Creates the buffer object.
+ *
+ * @param blockSize Size in bytes of the `std140` block.
+ *
+ * @throw abcg::RuntimeError if `blockSize` is zero.
+ */
+void abcg::OpenGLUniformBuffer::create(std::size_t blockSize) {
+  destroy();
+
+  if (blockSize == 0) {
+    throw abcg::RuntimeError("Invalid uniform block size");
+  }
+
+  // Each copy must start at a multiple of the offset alignment
+  GLint alignment{};
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  auto const offsetAlignment{
+      gsl::narrow<std::size_t>(std::max(alignment, GLint{1}))};
+
+  m_blockSize = blockSize;
+  m_stride = (blockSize + offsetAlignment - 1) / offsetAlignment *
+             offsetAlignment;
+
+  glGenBuffers(1, &m_UBO);
+}
+
+/**
+ * @brief Releases the buffer object and the staging area.
+ */
+void abcg::OpenGLUniformBuffer::destroy() {
+  glDeleteBuffers(1, &m_UBO);
+  m_UBO = 0;
+  m_capacity = 0;
+  m_staging.clear();
+  m_staging.shrink_to_fit();
+}
+
+/**
+ * @brief Assigns a binding point to a uniform block of a program.
+ *
+ * This only needs to be called once per program, after linking.
+ *
+ * @param program ID of the program object.
+ * @param blockName Name of the uniform block in the shader.
+ * @param bindingPoint Binding point used with
+ * abcg::OpenGLUniformBuffer::bindRange.
+ *
+ * @throw abcg::RuntimeError if the program has no active block with the given
+ * name, or if its size differs from the block size given to
+ * abcg::OpenGLUniformBuffer::create.
+ */
+void abcg::OpenGLUniformBuffer::bindBlock(GLuint program,
+                                          std::string_view blockName,
+                                          GLuint bindingPoint) const {
+  auto const blockIndex{
+      glGetUniformBlockIndex(program, std::string{blockName}.c_str())};
+  if (blockIndex == GL_INVALID_INDEX) {
+    throw abcg::RuntimeError(
+        fmt::format("Uniform block {} not found", blockName));
+  }
+
+  GLint dataSize{};
+  glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE,
+                            &dataSize);
+  if (gsl::narrow<std::size_t>(dataSize) != m_blockSize) {
+    throw abcg::RuntimeError(fmt::format(
+        "Size of uniform block {} is {} bytes, but {} bytes were expected",
+        blockName, dataSize, m_blockSize));
+  }
+
+  glUniformBlockBinding(program, blockIndex, bindingPoint);
+}
+
+/**
+ * @brief Discards the copies pushed since the last upload.
+ */
+void abcg::OpenGLUniformBuffer::clear() noexcept { m_staging.clear(); }
+
+/**
+ * @brief Appends a copy of the block to the staging area.
+ *
+ * @param data Pointer to the block data.
+ * @param size Size of the block data in bytes.
+ *
+ * @throw abcg::RuntimeError if `size` differs from the block size.
+ *
+ * @return Index of the copy.
+ */
+GLsizei abcg::OpenGLUniformBuffer::push(void const *data, std::size_t size) {
+  if (size != m_blockSize) {
+    throw abcg::RuntimeError("Uniform block size mismatch");
+  }
+
+  auto const offset{m_staging.size()};
+  m_staging.resize(offset + m_stride);
+  std::memcpy(&m_staging[offset], data, size);
+
+  return gsl::narrow<GLsizei>(offset / m_stride);
+}
+
+/**
+ * @brief Sends the copies in the staging area to the GPU.
+ *
+ * Call this once per frame, after pushing all copies and before the first
+ * call to abcg::OpenGLUniformBuffer::bindRange. The staging area is cleared
+ * afterwards.
+ */
+void abcg::OpenGLUniformBuffer::upload() {
+  if (m_staging.empty()) {
+    return;
+  }
+
+  // Orphan the previous storage so that pending draws keep their data
+  m_capacity = std::max(m_capacity, m_staging.size());
+  glBindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+  glBufferData(GL_UNIFORM_BUFFER, gsl::narrow<GLsizeiptr>(m_capacity), nullptr,
+               GL_STREAM_DRAW);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0,
+                  gsl::narrow<GLsizeiptr>(m_staging.size()), m_staging.data());
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  m_staging.clear();
+}
+
+/**
+ * @brief Binds one copy of the block to a binding point.
+ *
+ * @param bindingPoint Binding point assigned with
+ * abcg::OpenGLUniformBuffer::bindBlock.
+ * @param index Index returned by abcg::OpenGLUniformBuffer::push.
+ */
+void abcg::OpenGLUniformBuffer::bindRange(GLuint bindingPoint,
+                                          GLsizei index) const {
+  glBindBufferRange(
+      GL_UNIFORM_BUFFER, bindingPoint, m_UBO,
+      gsl::narrow<GLintptr>(gsl::narrow<std::size_t>(index) * m_stride),
+      gsl::narrow<GLsizeiptr>(m_blockSize));
+}
@@ -0,0 +1,102 @@
+/**
+ * @file abcgOpenGLUniformBuffer.hpp
+ * @brief Header file of abcg::OpenGLUniformBuffer.
+ *
+ * Declaration of abcg::OpenGLUniformBuffer.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_UNIFORM_BUFFER_HPP_
+#define ABCG_OPENGL_UNIFORM_BUFFER_HPP_
+
+#include "abcgOpenGLExternal.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace abcg {
+class OpenGLUniformBuffer;
+} // namespace abcg
+
+/**
+ * @brief Uniform buffer object that holds many copies of a `std140` block.
+ *
+ * Each copy is written with abcg::OpenGLUniformBuffer::push into a CPU-side
+ * staging area, and all copies of the frame are sent to the GPU with a single
+ * call to abcg::OpenGLUniformBuffer::upload. The storage of the previous frame
+ * is orphaned, so the upload does not wait for draws still reading from it.
+ * Before each draw, abcg::OpenGLUniformBuffer::bindRange binds the copy of
+ * one object to its binding point.
+ *
+ * The C++ type of the block must match the `std140` layout of the block
+ * declared in the shader. Members must be ordered so that `vec4`s come at
+ * 16-byte offsets and `vec2`s at 8-byte offsets, for instance:
+ *
+ * @code{.cpp}
+ * // layout(std140) uniform Object {
+ * //   vec4 color; vec2 translation; float scale; float rotation;
+ * // };
+ * struct ObjectBlock {
+ *   glm::vec4 color;
+ *   glm::vec2 translation;
+ *   float scale;
+ *   float rotation;
+ * };
+ * @endcode
+ *
+ * abcg::OpenGLUniformBuffer::bindBlock checks that the size of the block
+ * reported by the driver matches the size given to
+ * abcg::OpenGLUniformBuffer::create.
+ */
+class abcg::OpenGLUniformBuffer {
+public:
+  void create(std::size_t blockSize);
+  void destroy();
+
+  void bindBlock(GLuint program, std::string_view blockName,
+                 GLuint bindingPoint) const;
+
+  void clear() noexcept;
+
+  /**
+   * @brief Appends a copy of the block to the staging area.
+   *
+   * @param block Block data. Its size must be the size given to
+   * abcg::OpenGLUniformBuffer::create.
+   *
+   * @return Index of the copy, to be used with
+   * abcg::OpenGLUniformBuffer::bindRange after the next upload.
+   */
+  template <typename T> GLsizei push(T const &block) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Uniform blocks must be trivially copyable");
+    return push(&block, sizeof(T));
+  }
+  GLsizei push(void const *data, std::size_t size);
+
+  void upload();
+  void bindRange(GLuint bindingPoint, GLsizei index) const;
+
+  /**
+   * @brief Returns the distance in bytes between consecutive copies.
+   *
+   * @return Block size rounded up to `GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT`.
+   */
+  [[nodiscard]] std::size_t getStride() const noexcept { return m_stride; }
+
+private:
+  GLuint m_UBO{};
+  std::size_t m_blockSize{};
+  std::size_t m_stride{};
+  std::size_t m_capacity{};
+  std::vector<std::byte> m_staging;
+};
+
+#endif
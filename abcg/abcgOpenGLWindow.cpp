@@ -17,6 +17,8 @@
 
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgOpenGLShader.hpp"
+#include "abcgTrace.hpp"
 #include "abcgWindow.hpp"
 
 /**
@@ -47,33 +49,28 @@ void abcg::OpenGLWindow::setOpenGLSettings(
 /**
  * @brief Takes a snapshot of the screen and saves it to a file.
  *
+ * The pixels drawn so far in the current frame are read into a pixel pack
+ * buffer without waiting for the GPU. The file is written a few frames later
+ * by the encoder thread of abcg::OpenGLWindow::getFrameCapture.
+ *
  * @param filename String view to the filename.
  */
-void abcg::OpenGLWindow::saveScreenshotPNG(std::string_view filename) const {
-  auto const size{getWindowSize()};
-  auto const bitsPerPixel{8};
-  auto const channels{4};
-  auto const pitch{gsl::narrow<long>(size.x * channels)};
-
-  auto const numPixels{gsl::narrow<std::size_t>(size.x * size.y * channels)};
-  std::vector<unsigned char> pixels(numPixels);
+void abcg::OpenGLWindow::saveScreenshotPNG(std::string_view filename) {
   glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
-  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
-
-  // Flip upside down
-  for (auto const line : iter::range(size.y / 2)) {
-    std::swap_ranges(pixels.begin() + pitch * line,
-                     pixels.begin() + pitch * (line + 1),
-                     pixels.begin() + pitch * (size.y - line - 1));
-  }
+  m_frameCapture.captureScreenshot(filename, getWindowSize());
+}
 
-  if (auto *const surface{SDL_CreateRGBSurfaceFrom(
-          pixels.data(), size.x, size.y, channels * bitsPerPixel,
-          gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
-          0xFF000000)}) {
-    IMG_SavePNG(surface, filename.data());
-    SDL_FreeSurface(surface);
-  }
+/**
+ * @brief Returns the frame capture of the window.
+ *
+ * Use it to record the window with abcg::OpenGLFrameCapture::startRecording.
+ * While recording, every painted frame is captured just before the buffers
+ * are swapped, including the UI.
+ *
+ * @return Reference to the abcg::OpenGLFrameCapture object of the window.
+ */
+abcg::OpenGLFrameCapture &abcg::OpenGLWindow::getFrameCapture() noexcept {
+  return m_frameCapture;
 }
 
 /**
@@ -126,8 +123,10 @@ void abcg::OpenGLWindow::onPaint() {
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
- * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
+ * abcg::WindowSettings::showFPS is set to `true`, a frame profiler if
+ * abcg::WindowSettings::showFrameProfiler is set to `true`, and a toggle
+ * fullscreen button if abcg::WindowSettings::showFullscreenButton is set to
+ * `true`.
  */
 void abcg::OpenGLWindow::onPaintUI() {
   // FPS counter
@@ -159,6 +158,11 @@ void abcg::OpenGLWindow::onPaintUI() {
     ImGui::End();
   }
 
+  // Frame profiler
+  if (abcg::Window::getWindowSettings().showFrameProfiler) {
+    m_frameProfiler.paintUI();
+  }
+
   // Fullscreen button
   if (abcg::Window::getWindowSettings().showFullscreenButton) {
 #if defined(__EMSCRIPTEN__)
@@ -213,6 +217,20 @@ void abcg::OpenGLWindow::onResize([[maybe_unused]] glm::ivec2 const &size) {}
  */
 void abcg::OpenGLWindow::onUpdate() {}
 
+/**
+ * @brief Custom handler called at a fixed rate.
+ *
+ * This virtual function is called zero or more times per frame, before
+ * abcg::OpenGLWindow::onUpdate, so that it runs on average
+ * abcg::WindowSettings::fixedUpdateRate times per second. Use
+ * abcg::Window::getFixedDeltaTime as the time step of the simulation, and
+ * abcg::Window::getInterpolationAlpha in abcg::OpenGLWindow::onPaint to
+ * interpolate between simulation states.
+ *
+ * Override it for custom behavior. By default, it does nothing.
+ */
+void abcg::OpenGLWindow::onFixedUpdate() {}
+
 /**
  * @brief Custom handler for cleaning up OpenGL resources.
  *
@@ -335,7 +353,13 @@ void abcg::OpenGLWindow::create() {
 
   // Create window with graphics context
   while (true) {
-    if (!createSDLWindow(SDL_WINDOW_OPENGL) && m_openGLSettings.samples > 0) {
+    // Offline renders draw to an offscreen framebuffer, so the window is only
+    // needed for the context
+    auto const windowFlags{abcg::Window::isOfflineRendering()
+                               ? SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN
+                               : SDL_WINDOW_OPENGL};
+    if (!createSDLWindow(static_cast<SDL_WindowFlags>(windowFlags)) &&
+        m_openGLSettings.samples > 0) {
       // Try again, but this time with multisampling disabled
       m_openGLSettings.samples = 0;
       SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
@@ -357,7 +381,8 @@ void abcg::OpenGLWindow::create() {
   }
 
 #if !defined(__EMSCRIPTEN__)
-  SDL_GL_SetSwapInterval(m_openGLSettings.vSync ? 1 : 0);
+  SDL_GL_SetSwapInterval(
+      m_openGLSettings.vSync && !abcg::Window::isOfflineRendering() ? 1 : 0);
 #endif
 
 #if !defined(__EMSCRIPTEN__)
@@ -419,19 +444,71 @@ void abcg::OpenGLWindow::create() {
     throw abcg::RuntimeError("Failed to load font file");
   }
 
+  // Timestamp queries are core since OpenGL 3.3, but not part of OpenGL ES
+#if !defined(__EMSCRIPTEN__)
+  m_frameProfiler.create(m_openGLSettings.profile != OpenGLProfile::ES &&
+                         (GLEW_VERSION_3_3 || GLEW_ARB_timer_query));
+#else
+  m_frameProfiler.create(false);
+#endif
+
+  abcg::setOpenGLProgramCachePath(m_openGLSettings.programCachePath);
+
+  m_frameCapture.create();
+
+  if (abcg::Window::isOfflineRendering()) {
+    createOfflineFramebuffer();
+    auto const &path{abcg::Window::getOfflineRenderSettings().path};
+    m_frameCapture.startRecording(
+        path, path.ends_with(".y4m") ? CaptureFormat::Y4M : CaptureFormat::PPM,
+        abcg::Window::getOfflineRenderSettings().frameRate);
+  }
+
   onCreate();
 
   onResize(getWindowSize());
 }
 
+void abcg::OpenGLWindow::beginFrame() {
+  m_frameProfiler.setEnabled(
+      abcg::Window::getWindowSettings().showFrameProfiler);
+
+  // The frame starts with the fixed-step updates
+  m_frameProfiler.beginPhase(FramePhase::FixedUpdate);
+}
+
+void abcg::OpenGLWindow::fixedUpdate() { onFixedUpdate(); }
+
 void abcg::OpenGLWindow::paint() {
+  ABCG_TRACE_ZONE("OpenGLWindow::paint");
+
+  m_frameProfiler.beginPhase(FramePhase::Update);
   onUpdate();
 
-  if (m_hidden || m_minimized)
+  if ((m_hidden || m_minimized) && !abcg::Window::isOfflineRendering()) {
+    m_frameProfiler.discardFrame();
     return;
+  }
 
   SDL_GL_MakeCurrent(abcg::Window::getSDLWindow(), m_GLContext);
 
+  // Write the captures of previous frames whose readbacks are complete. A
+  // failed capture only stops an offline render, since it must not miss a
+  // frame. Otherwise, the recording is stopped and the application goes on
+  try {
+    m_frameCapture.poll();
+  } catch (abcg::Exception const &exception) {
+    if (abcg::Window::isOfflineRendering()) {
+      throw;
+    }
+    fmt::print("Warning: {}\n", exception.what());
+    m_frameCapture.stopRecording();
+  }
+
+  if (abcg::Window::isOfflineRendering()) {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offlineFramebuffer);
+  }
+
 #if defined(__EMSCRIPTEN__)
   // Force window size in windowed mode
   EmscriptenFullscreenChangeEvent fullscreenStatus{};
@@ -445,25 +522,59 @@ void abcg::OpenGLWindow::paint() {
 
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL2_NewFrame();
+  if (abcg::Window::isOfflineRendering()) {
+    // Lay out the UI for the offscreen framebuffer and animate it with the
+    // simulated time step
+    auto &guiIO{ImGui::GetIO()};
+    auto const size{getWindowSize()};
+    guiIO.DisplaySize =
+        ImVec2(gsl::narrow<float>(size.x), gsl::narrow<float>(size.y));
+    guiIO.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
+    guiIO.DeltaTime = gsl::narrow_cast<float>(abcg::Window::getDeltaTime());
+  }
+  m_frameProfiler.beginPhase(FramePhase::PaintUI);
   ImGui::NewFrame();
 
   onPaintUI();
 
   ImGui::Render();
 
-  onPaint();
+  m_frameProfiler.beginPhase(FramePhase::Paint);
+  {
+    ABCG_TRACE_ZONE("OpenGLWindow::onPaint");
+    onPaint();
+  }
 
+  m_frameProfiler.beginPhase(FramePhase::RenderUI);
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  if (m_openGLSettings.doubleBuffering) {
+
+  if (abcg::Window::isOfflineRendering()) {
+    captureOfflineFrame();
+  } else if (m_frameCapture.isRecording()) {
+    glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
+    m_frameCapture.captureFrame(getWindowSize());
+  }
+
+  m_frameProfiler.beginPhase(FramePhase::Swap);
+  ABCG_TRACE_ZONE("OpenGLWindow::swap");
+  if (abcg::Window::isOfflineRendering()) {
+    // Nothing is presented, so don't wait for the vertical retrace
+    glFlush();
+  } else if (m_openGLSettings.doubleBuffering) {
     SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
   } else {
     glFinish();
   }
+  m_frameProfiler.endFrame();
 }
 
 void abcg::OpenGLWindow::destroy() {
   onDestroy();
 
+  m_frameCapture.destroy();
+  m_frameProfiler.destroy();
+  destroyOfflineFramebuffer();
+
   if (ImGui::GetCurrentContext() != nullptr) {
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
@@ -476,9 +587,98 @@ void abcg::OpenGLWindow::destroy() {
 }
 
 [[nodiscard]] glm::ivec2 abcg::OpenGLWindow::getWindowSize() const {
+  if (abcg::Window::isOfflineRendering()) {
+    if (auto const size{abcg::Window::getOfflineRenderSettings().size};
+        size.x > 0 && size.y > 0) {
+      return size;
+    }
+    auto const &windowSettings{abcg::Window::getWindowSettings()};
+    return {windowSettings.width, windowSettings.height};
+  }
+
   glm::ivec2 size{};
   if (auto *window{abcg::Window::getSDLWindow()}; window != nullptr) {
     SDL_GL_GetDrawableSize(window, &size.x, &size.y);
   }
   return size;
 }
+
+void abcg::OpenGLWindow::createOfflineFramebuffer() {
+  auto const size{getWindowSize()};
+
+  GLint maxSamples{};
+  glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  auto const samples{std::min(m_openGLSettings.samples, maxSamples)};
+
+  auto const createColorbuffer{[&size](GLsizei colorSamples) {
+    GLuint renderbuffer{};
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, colorSamples, GL_RGBA8,
+                                     size.x, size.y);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, renderbuffer);
+    return renderbuffer;
+  }};
+
+  glGenFramebuffers(1, &m_offlineFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offlineFramebuffer);
+  m_offlineColorbuffer = createColorbuffer(samples);
+
+  auto const hasStencil{m_openGLSettings.stencilBufferSize > 0};
+  glGenRenderbuffers(1, &m_offlineDepthbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_offlineDepthbuffer);
+  glRenderbufferStorageMultisample(
+      GL_RENDERBUFFER, samples,
+      hasStencil ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24, size.x, size.y);
+  glFramebufferRenderbuffer(
+      GL_FRAMEBUFFER,
+      hasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+      GL_RENDERBUFFER, m_offlineDepthbuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw abcg::RuntimeError("Failed to create offscreen framebuffer");
+  }
+
+  // Multisampled framebuffers cannot be read back directly
+  if (samples > 0) {
+    glGenFramebuffers(1, &m_offlineResolveFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offlineResolveFramebuffer);
+    m_offlineResolveColorbuffer = createColorbuffer(0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw abcg::RuntimeError("Failed to create offscreen framebuffer");
+    }
+  }
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offlineFramebuffer);
+}
+
+void abcg::OpenGLWindow::captureOfflineFrame() {
+  ABCG_TRACE_ZONE("OpenGLWindow::captureOfflineFrame");
+
+  auto const size{getWindowSize()};
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, m_offlineFramebuffer);
+  if (m_offlineResolveFramebuffer != 0) {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_offlineResolveFramebuffer);
+    glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_offlineResolveFramebuffer);
+  }
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  m_frameCapture.captureFrame(size);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offlineFramebuffer);
+}
+
+void abcg::OpenGLWindow::destroyOfflineFramebuffer() {
+  glDeleteFramebuffers(1, &m_offlineResolveFramebuffer);
+  glDeleteRenderbuffers(1, &m_offlineResolveColorbuffer);
+  glDeleteFramebuffers(1, &m_offlineFramebuffer);
+  glDeleteRenderbuffers(1, &m_offlineDepthbuffer);
+  glDeleteRenderbuffers(1, &m_offlineColorbuffer);
+  m_offlineResolveFramebuffer = 0;
+  m_offlineResolveColorbuffer = 0;
+  m_offlineFramebuffer = 0;
+  m_offlineDepthbuffer = 0;
+  m_offlineColorbuffer = 0;
+}
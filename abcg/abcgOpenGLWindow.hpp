@@ -16,7 +16,9 @@
 #include <string>
 
 #include "abcgExternal.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLFrameProfiler.hpp"
 #include "abcgWindow.hpp"
 
 namespace abcg {
@@ -77,6 +79,14 @@ struct abcg::OpenGLSettings {
   bool vSync{false};
   /** @brief Whether the output is double buffered. */
   bool doubleBuffering{true};
+  /** @brief Directory where linked program binaries are cached. The cache is
+   * disabled if empty, and is not supported on WebGL.
+   *
+   * The directory must be writable, e.g., a subdirectory of
+   * abcg::Application::getUserDataPath.
+   *
+   * @sa abcg::setOpenGLProgramCachePath. */
+  std::string programCachePath{};
 };
 
 /**
@@ -92,6 +102,8 @@ struct abcg::OpenGLSettings {
  * @sa abcg::OpenGLWindow::onPaintUI for UI rendering.
  * @sa abcg::OpenGLWindow::onResize for handling of window resize events.
  * @sa abcg::OpenGLWindow::onUpdate for commands to be called every frame.
+ * @sa abcg::OpenGLWindow::onFixedUpdate for commands to be called at a fixed
+ * rate.
  * @sa abcg::OpenGLWindow::onDestroy for cleaning up OpenGL resources.
 
  * @remark Objects of this type cannot be copied or copy-constructed.
@@ -100,7 +112,8 @@ class abcg::OpenGLWindow : public Window {
 public:
   [[nodiscard]] OpenGLSettings const &getOpenGLSettings() const noexcept;
   void setOpenGLSettings(OpenGLSettings const &openGLSettings) noexcept;
-  void saveScreenshotPNG(std::string_view filename) const;
+  void saveScreenshotPNG(std::string_view filename);
+  [[nodiscard]] OpenGLFrameCapture &getFrameCapture() noexcept;
 
 protected:
   virtual void onEvent(SDL_Event const &event);
@@ -109,20 +122,37 @@ protected:
   virtual void onPaintUI();
   virtual void onResize(glm::ivec2 const &size);
   virtual void onUpdate();
+  virtual void onFixedUpdate();
   virtual void onDestroy();
 
 private:
   void handleEvent(SDL_Event const &event) final;
   void create() final;
   void paint() final;
+  void beginFrame() final;
+  void fixedUpdate() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
+  void createOfflineFramebuffer();
+  void captureOfflineFrame();
+  void destroyOfflineFramebuffer();
 
   OpenGLSettings m_openGLSettings;
   std::string m_GLSLVersion;
   SDL_GLContext m_GLContext{};
   bool m_hidden{};
   bool m_minimized{};
+
+  OpenGLFrameProfiler m_frameProfiler;
+  OpenGLFrameCapture m_frameCapture;
+
+  // Offscreen target of an offline render, resolved to a single-sampled
+  // framebuffer before readback if multisampled
+  GLuint m_offlineFramebuffer{};
+  GLuint m_offlineColorbuffer{};
+  GLuint m_offlineDepthbuffer{};
+  GLuint m_offlineResolveFramebuffer{};
+  GLuint m_offlineResolveColorbuffer{};
 };
 
 #endif
@@ -0,0 +1,231 @@
+/**
+ * @file abcgTrace.cpp
+ * @brief Definition of abcg::TraceZone members and trace functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgTrace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Number of events kept per thread (must be a power of two)
+constexpr std::size_t traceCapacity{std::size_t{1} << 15};
+
+// Single-producer ring of complete events. Only the owning thread writes to
+// it; abcg::dumpTrace reads it concurrently and discards the slots that may
+// have been overwritten while it was reading.
+struct TraceBuffer {
+  struct Event {
+    std::atomic<char const *> name{};
+    std::atomic<std::int64_t> start{};
+    std::atomic<std::int64_t> duration{};
+  };
+
+  std::size_t threadIndex{};
+  std::atomic<std::uint64_t> head{};
+  std::array<Event, traceCapacity> events{};
+};
+
+struct TraceRegistry {
+  std::mutex mutex;
+  // Buffers are never released so that events of finished threads can still
+  // be dumped
+  std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+std::atomic<bool> traceEnabled{};
+Clock::time_point const traceEpoch{Clock::now()};
+
+TraceRegistry &registry() {
+  static TraceRegistry instance;
+  return instance;
+}
+
+TraceBuffer &threadBuffer() {
+  thread_local TraceBuffer *buffer{[] {
+    auto &reg{registry()};
+    std::scoped_lock const lock{reg.mutex};
+    auto &newBuffer{reg.buffers.emplace_back(std::make_unique<TraceBuffer>())};
+    newBuffer->threadIndex = reg.buffers.size() - 1;
+    return newBuffer.get();
+  }()};
+  return *buffer;
+}
+
+std::int64_t toNanoseconds(Clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+std::string escapeJSON(std::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (auto const character : text) {
+    switch (character) {
+    case '"':
+      result += "\\\"";
+      break;
+    case '\\':
+      result += "\\\\";
+      break;
+    default:
+      if (static_cast<unsigned char>(character) < 0x20) {
+        result += fmt::format("\\u{:04x}", static_cast<int>(character));
+      } else {
+        result += character;
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+/**
+ * @brief Enables or disables the recording of trace zones.
+ *
+ * Tracing is disabled by default. It is enabled by abcg::Application::run if
+ * the environment variable `ABCG_TRACE` is set to the name of the file that
+ * will receive the trace at exit.
+ *
+ * @param enabled Whether zones should be recorded.
+ */
+void abcg::setTraceEnabled(bool enabled) noexcept {
+  traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns whether trace zones are being recorded.
+ *
+ * @return True if tracing is enabled.
+ */
+bool abcg::isTraceEnabled() noexcept {
+  return traceEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Writes the recorded zones of all threads to a JSON file.
+ *
+ * The file uses the Trace Event Format and can be opened in
+ * `about://tracing` or in Perfetto (https://ui.perfetto.dev). Zones can keep
+ * being recorded while the trace is dumped.
+ *
+ * @param filename Path of the output file.
+ *
+ * @return True if the file was written; false otherwise.
+ */
+bool abcg::dumpTrace(std::string_view filename) {
+  std::ofstream stream{std::string{filename}};
+  if (!stream) {
+    fmt::print(stderr, "Failed to open trace file {}\n", filename);
+    return false;
+  }
+
+  auto &reg{registry()};
+  std::scoped_lock const lock{reg.mutex};
+
+  stream << "{\"traceEvents\":[\n";
+  auto first{true};
+  auto const separator{[&first]() -> std::string_view {
+    return std::exchange(first, false) ? "" : ",\n";
+  }};
+
+  for (auto const &buffer : reg.buffers) {
+    stream << separator()
+           << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                          "\"tid\":{0},\"args\":{{\"name\":\"Thread {0}\"}}}}",
+                          buffer->threadIndex);
+
+    auto const end{buffer->head.load(std::memory_order_acquire)};
+    auto const begin{end > traceCapacity ? end - traceCapacity : 0};
+
+    struct Snapshot {
+      char const *name;
+      std::int64_t start;
+      std::int64_t duration;
+    };
+    std::vector<Snapshot> snapshots;
+    snapshots.reserve(end - begin);
+    for (auto index{begin}; index < end; ++index) {
+      auto const &event{buffer->events.at(index & (traceCapacity - 1))};
+      snapshots.push_back({event.name.load(std::memory_order_relaxed),
+                           event.start.load(std::memory_order_relaxed),
+                           event.duration.load(std::memory_order_relaxed)});
+    }
+
+    // Skip the slots the owning thread may have overwritten meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const newEnd{buffer->head.load(std::memory_order_relaxed)};
+    auto const validBegin{newEnd >= traceCapacity ? newEnd - traceCapacity + 1
+                                                  : 0};
+    auto const skip{std::min<std::uint64_t>(
+        validBegin > begin ? validBegin - begin : 0, snapshots.size())};
+
+    for (auto iter{snapshots.begin() + static_cast<std::ptrdiff_t>(skip)};
+         iter != snapshots.end(); ++iter) {
+      stream << separator()
+             << fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+                            "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                            escapeJSON(iter->name), buffer->threadIndex,
+                            static_cast<double>(iter->start) / 1000.0,
+                            static_cast<double>(iter->duration) / 1000.0);
+    }
+  }
+
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return static_cast<bool>(stream);
+}
+
+/**
+ * @brief Starts a zone.
+ *
+ * @param name Name of the zone. Must remain valid until the trace is dumped
+ * (e.g., a string literal).
+ */
+abcg::TraceZone::TraceZone(char const *name) noexcept {
+  if (isTraceEnabled()) {
+    m_name = name;
+    m_start = Clock::now();
+  }
+}
+
+/**
+ * @brief Ends the zone and records it in the buffer of the calling thread.
+ */
+abcg::TraceZone::~TraceZone() {
+  if (m_name == nullptr) {
+    return;
+  }
+  auto const end{Clock::now()};
+
+  auto &buffer{threadBuffer()};
+  auto const index{buffer.head.load(std::memory_order_relaxed)};
+  auto &event{buffer.events.at(index & (traceCapacity - 1))};
+  // Pairs with the fence in abcg::dumpTrace so that a reader that sees any of
+  // the stores below also sees that the slot is being reused
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(m_name, std::memory_order_relaxed);
+  event.start.store(toNanoseconds(m_start - traceEpoch),
+                    std::memory_order_relaxed);
+  event.duration.store(toNanoseconds(end - m_start),
+                       std::memory_order_relaxed);
+  buffer.head.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file abcgTrace.hpp
+ * @brief Header file of abcg::TraceZone and related functions.
+ *
+ * Declaration of abcg::TraceZone, abcg::setTraceEnabled, abcg::isTraceEnabled
+ * and abcg::dumpTrace.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TRACE_HPP_
+#define ABCG_TRACE_HPP_
+
+#include <chrono>
+#include <string_view>
+
+namespace abcg {
+class TraceZone;
+void setTraceEnabled(bool enabled) noexcept;
+[[nodiscard]] bool isTraceEnabled() noexcept;
+bool dumpTrace(std::string_view filename);
+} // namespace abcg
+
+/**
+ * @brief Scoped profiling zone.
+ *
+ * Records the time elapsed between its construction and destruction as a
+ * complete event of the trace of the calling thread. Events are stored in a
+ * fixed-size per-thread ring buffer without locking, so the oldest events are
+ * overwritten when the buffer is full.
+ *
+ * Zones are only recorded while tracing is enabled with abcg::setTraceEnabled.
+ * When tracing is disabled, a zone costs a single relaxed atomic load.
+ *
+ * Use the ABCG_TRACE_ZONE macro to create a zone that lasts until the end of
+ * the enclosing scope.
+ *
+ * @sa abcg::dumpTrace.
+ */
+class abcg::TraceZone {
+public:
+  explicit TraceZone(char const *name) noexcept;
+  TraceZone(TraceZone const &) = delete;
+  TraceZone &operator=(TraceZone const &) = delete;
+  TraceZone(TraceZone &&) = delete;
+  TraceZone &operator=(TraceZone &&) = delete;
+  ~TraceZone();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  char const *m_name{};
+  Clock::time_point m_start{};
+};
+
+#define ABCG_TRACE_CONCAT_IMPL(a, b) a##b
+#define ABCG_TRACE_CONCAT(a, b) ABCG_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Creates an abcg::TraceZone that lasts until the end of the scope.
+ *
+ * @param name Name of the zone. Must be a string with static storage duration
+ * (e.g., a string literal).
+ */
+#define ABCG_TRACE_ZONE(name)                                                  \
+  abcg::TraceZone const ABCG_TRACE_CONCAT(abcgTraceZone, __LINE__) { name }
+
+#endif
@@ -18,8 +18,11 @@
 #include "abcg.hpp"
 #include "abcgVulkanBuffer.hpp"
 #include "abcgVulkanImage.hpp"
+#include "abcgVulkanParallelRecorder.hpp"
 #include "abcgVulkanPipeline.hpp"
+#include "abcgVulkanRingBuffer.hpp"
 #include "abcgVulkanShader.hpp"
+#include "abcgVulkanUploadContext.hpp"
 #include "abcgVulkanWindow.hpp"
 
 #endif
@@ -16,56 +16,100 @@
 
 #include "abcgException.hpp"
 
+/**
+ * @brief Creates the buffer and waits for its data to be uploaded.
+ *
+ * @param device Vulkan device.
+ * @param createInfo Creation info.
+ *
+ * @sa abcg::VulkanBuffer::create(VulkanDevice const &,
+ * VulkanBufferCreateInfo const &, VulkanUploadContext &) for creating several
+ * buffers with a single submission.
+ */
 void abcg::VulkanBuffer::create(VulkanDevice const &device,
                                 VulkanBufferCreateInfo const &createInfo) {
+  if (createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible ||
+      !createInfo.data.has_value()) {
+    // Nothing to be uploaded
+    VulkanUploadContext uploads;
+    create(device, createInfo, uploads);
+    return;
+  }
+
+  VulkanUploadContext uploads;
+  uploads.create(device, createInfo.size);
+  try {
+    create(device, createInfo, uploads);
+    uploads.wait(uploads.submit());
+  } catch (...) {
+    uploads.destroy();
+    throw;
+  }
+  uploads.destroy();
+}
+
+/**
+ * @brief Creates the buffer, recording the upload of its data into an upload
+ * context.
+ *
+ * If the buffer is not host visible, the data is copied to staging memory of
+ * the upload context and the copy to the buffer is recorded into the batch
+ * being recorded. The buffer must not be used before the ticket returned by
+ * the next call to abcg::VulkanUploadContext::submit is complete.
+ *
+ * @param device Vulkan device.
+ * @param createInfo Creation info.
+ * @param uploads Upload context. Not used if the buffer is host visible or
+ * has no data.
+ */
+void abcg::VulkanBuffer::create(VulkanDevice const &device,
+                                VulkanBufferCreateInfo const &createInfo,
+                                VulkanUploadContext &uploads) {
   m_device = static_cast<vk::Device>(device);
+  m_memoryAllocator = &device.getMemoryAllocator();
 
   if (createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) {
-    std::tie(m_buffer, m_deviceMemory) = createBuffer(
+    std::tie(m_buffer, m_allocation) = createBuffer(
         device, createInfo.size, createInfo.usage, createInfo.properties);
 
     if (createInfo.data.has_value()) {
       loadData(createInfo.data.value(), createInfo.size);
     }
   } else if (createInfo.data.has_value()) {
-    // Use a staging buffer for mapping, and a device local buffer as the final
+    // Use staging memory for mapping, and a device local buffer as the final
     // destination
-    auto [stagingBuffer, stagingBufferMemory]{createBuffer(
-        device, createInfo.size, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible |
-            vk::MemoryPropertyFlagBits::eHostCoherent)};
-
-    // Copy data to mapped staging buffer
-    // Transfer of data to the GPU will happen in the background before the next
-    // call to vkQueueSubmit
-    void *data{m_device.mapMemory(stagingBufferMemory, vk::DeviceSize{0},
-                                  createInfo.size)};
-    memcpy(data, createInfo.data->get(), createInfo.size);
-    m_device.unmapMemory(stagingBufferMemory);
+    auto const staging{uploads.stage(createInfo.data->get(), createInfo.size)};
 
     // Create buffer in device local memory
-    std::tie(m_buffer, m_deviceMemory) =
+    std::tie(m_buffer, m_allocation) =
         createBuffer(device, createInfo.size,
                      createInfo.usage | vk::BufferUsageFlagBits::eTransferDst,
                      vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    // Copy from staging buffer to device local buffer
-    device.withCommandBuffer(
-        [this, &stagingBuffer, &createInfo](const auto &commandBuffer) {
-          commandBuffer.copyBuffer(stagingBuffer, m_buffer,
-                                   {{.size = createInfo.size}});
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Release staging buffer
-    m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+    // Copy from staging memory to device local buffer
+    uploads.record([this, &staging, &createInfo](auto const &commandBuffer) {
+      commandBuffer.copyBuffer(
+          staging.buffer, m_buffer,
+          {{.srcOffset = staging.offset, .size = createInfo.size}});
+    });
+
+    // Make the copy visible to the graphics queue, whatever the usage
+    uploads.transferOwnership(
+        {.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+         .dstAccessMask = vk::AccessFlagBits::eMemoryRead,
+         .buffer = m_buffer,
+         .size = VK_WHOLE_SIZE},
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eAllCommands);
   }
 }
 
 void abcg::VulkanBuffer::destroy() {
   m_device.destroyBuffer(m_buffer);
-  m_device.freeMemory(m_deviceMemory);
+  if (m_memoryAllocator != nullptr) {
+    m_memoryAllocator->free(m_allocation);
+  }
+  m_allocation = {};
 }
 
 /**
@@ -74,19 +118,27 @@ void abcg::VulkanBuffer::destroy() {
  * @param data Pointer to the beginning of the data.
  * @param size Size of the data fo the copied, in bytes.
  * @param offset Offset from the beginning of the buffer memory.
+ *
+ * @throw abcg::RuntimeError if the buffer is not host visible.
  */
 void abcg::VulkanBuffer::loadData(gsl::not_null<void const *> data,
                                   vk::DeviceSize size, vk::DeviceSize offset) {
+  // The memory block of the buffer is kept mapped by the allocator, as it may
+  // be shared with other buffers
+  if (m_allocation.mappedData == nullptr) {
+    throw abcg::RuntimeError("Buffer memory is not host visible");
+  }
+
   // Transfer of data to the GPU will happen in the background before the next
   // call to vkQueueSubmit
-  auto *mappedData{m_device.mapMemory(m_deviceMemory, offset, size)};
-  memcpy(mappedData, data, size);
-  m_device.unmapMemory(m_deviceMemory);
+  memcpy(m_allocation.mappedData + offset, data, size);
+  m_memoryAllocator->flush(m_allocation, offset, size);
 }
 
-std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
-    VulkanDevice const &device, vk::DeviceSize size, vk::BufferUsageFlags usage,
-    vk::MemoryPropertyFlags properties) const {
+std::pair<vk::Buffer, abcg::VulkanAllocation>
+abcg::VulkanBuffer::createBuffer(VulkanDevice const &device, vk::DeviceSize size,
+                                 vk::BufferUsageFlags usage,
+                                 vk::MemoryPropertyFlags properties) const {
   auto const &physicalDevice{device.getPhysicalDevice()};
   auto const &queuesFamilies{physicalDevice.getQueuesFamilies()};
 
@@ -114,20 +166,20 @@ std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
   // Get memory requirements
   auto const memoryRequirements{m_device.getBufferMemoryRequirements(buffer)};
 
-  // Allocate buffer memory
-  auto const memoryType{physicalDevice.findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
+  // Sub-allocate buffer memory
+  VulkanAllocation allocation;
+  try {
+    allocation = device.getMemoryAllocator().allocate(
+        memoryRequirements, properties, VulkanResourceTiling::Linear);
+  } catch (...) {
+    m_device.destroyBuffer(buffer);
+    throw;
   }
-  auto bufferMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
 
   // Associate buffer memory to buffer
-  m_device.bindBufferMemory(buffer, bufferMemory, 0);
+  m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
 
-  return {buffer, bufferMemory};
+  return {buffer, allocation};
 }
 
 /**
@@ -141,8 +193,34 @@ abcg::VulkanBuffer::operator vk::Buffer const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with the buffer.
  *
+ * The memory object may be shared with other resources. The buffer starts at
+ * the offset returned by abcg::VulkanBuffer::getMemoryOffset.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanBuffer::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
-}
\ No newline at end of file
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the offset of the buffer in its device memory object.
+ *
+ * @return Offset in bytes.
+ */
+vk::DeviceSize abcg::VulkanBuffer::getMemoryOffset() const noexcept {
+  return m_allocation.offset;
+}
+/**
+ * @brief Returns a pointer to the memory of the buffer.
+ *
+ * Host-visible buffers stay mapped for as long as they exist, so the data can
+ * be written directly without calling abcg::VulkanBuffer::loadData. Writes to
+ * memory that is not host coherent must be followed by a call to
+ * abcg::VulkanMemoryAllocator::flush.
+ *
+ * @return Pointer to the beginning of the buffer, or `nullptr` if the buffer
+ * is not host visible.
+ */
+std::byte *abcg::VulkanBuffer::getMappedData() const noexcept {
+  return m_allocation.mappedData;
+}
@@ -14,9 +14,12 @@
 #define ABCG_VULKAN_BUFFER_HPP_
 
 #include "abcgVulkanDevice.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/pointers>
 
+#include <cstddef>
+
 namespace abcg {
 struct VulkanBufferCreateInfo;
 class VulkanBuffer;
@@ -42,6 +45,9 @@ class abcg::VulkanBuffer {
 public:
   void create(VulkanDevice const &device,
               VulkanBufferCreateInfo const &createInfo);
+  void create(VulkanDevice const &device,
+              VulkanBufferCreateInfo const &createInfo,
+              VulkanUploadContext &uploads);
   void destroy();
   void loadData(gsl::not_null<void const *> data, vk::DeviceSize size,
                 vk::DeviceSize offset = 0UL);
@@ -49,15 +55,18 @@ public:
   explicit operator vk::Buffer const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] vk::DeviceSize getMemoryOffset() const noexcept;
+  [[nodiscard]] std::byte *getMappedData() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Buffer, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Buffer, VulkanAllocation>
   createBuffer(VulkanDevice const &device, vk::DeviceSize size,
                vk::BufferUsageFlags usage,
                vk::MemoryPropertyFlags properties) const;
 
   vk::Buffer m_buffer;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanMemoryAllocator *m_memoryAllocator{};
   vk::Device m_device;
 };
 
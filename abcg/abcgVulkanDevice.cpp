@@ -12,10 +12,23 @@
 
 #include <gsl/gsl>
 
+#include <limits>
 #include <set>
 
+#include "abcgException.hpp"
+
+/**
+ * @brief Creates the logical device and its queues, command pools, pipeline
+ * cache and memory allocator.
+ *
+ * @param physicalDevice Physical device.
+ * @param extensions Device extensions to enable.
+ * @param pipelineCachePath Path of the file the pipeline cache is loaded from
+ * and saved to. If empty, the cache is not persisted.
+ */
 void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
-                                std::vector<char const *> const &extensions) {
+                                std::vector<char const *> const &extensions,
+                                std::string_view pipelineCachePath) {
   m_physicalDevice = physicalDevice;
   auto const &queuesFamilies{m_physicalDevice.getQueuesFamilies()};
   auto const graphicsQueueFamily{queuesFamilies.graphics.value_or(0)};
@@ -66,9 +79,20 @@ void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
   }
 
   createCommandPools();
+
+  m_pipelineCache.create(static_cast<vk::PhysicalDevice>(m_physicalDevice),
+                         m_device, pipelineCachePath);
+
+  m_memoryAllocator = std::make_shared<VulkanMemoryAllocator>();
+  m_memoryAllocator->create(m_physicalDevice, m_device);
 }
 
 void abcg::VulkanDevice::destroy() {
+  if (m_memoryAllocator) {
+    m_memoryAllocator->destroy();
+    m_memoryAllocator.reset();
+  }
+  m_pipelineCache.destroy();
   destroyCommandPools();
   m_device.destroy();
 }
@@ -109,6 +133,31 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
   return m_commandPools;
 }
 
+/**
+ * @brief Returns the pipeline cache of this device.
+ *
+ * abcg::VulkanPipeline::create uses this cache unless another cache is given
+ * in abcg::VulkanPipelineCreateInfo::pipelineCache.
+ *
+ * @return Pipeline cache.
+ */
+vk::PipelineCache const &abcg::VulkanDevice::getPipelineCache() const noexcept {
+  return static_cast<vk::PipelineCache const &>(m_pipelineCache);
+}
+
+/**
+ * @brief Returns the memory allocator of this device.
+ *
+ * abcg::VulkanBuffer and abcg::VulkanImage sub-allocate their memory from this
+ * allocator.
+ *
+ * @return Memory allocator.
+ */
+abcg::VulkanMemoryAllocator &
+abcg::VulkanDevice::getMemoryAllocator() const noexcept {
+  return *m_memoryAllocator;
+}
+
 /**
  * @brief Allocates and creates a command buffer to be immediately submitted and
  * released.
@@ -119,6 +168,8 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
  * command pool is the default.
  * @param level Whether a primary (default) or secondary command buffer will be
  * created.
+ *
+ * @sa abcg::VulkanUploadContext for batching uploads without waiting.
  */
 void abcg::VulkanDevice::withCommandBuffer(
     std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
@@ -156,14 +207,22 @@ void abcg::VulkanDevice::withCommandBuffer(
   commandBuffer.end();
 
   // Queue command buffer
+  auto const fence{m_device.createFence({})};
   queue->submit({{.commandBufferCount = 1, .pCommandBuffers = &commandBuffer}},
-                vk::Fence{});
+                fence);
 
-  // Wait until completion
-  queue->waitIdle();
+  // Wait until completion of this submission only, rather than of all work in
+  // the queue
+  auto const result{m_device.waitForFences(
+      fence, VK_TRUE, std::numeric_limits<uint64_t>::max())};
 
   // Cleanup
+  m_device.destroyFence(fence);
   m_device.freeCommandBuffers(*commandPool, {commandBuffer});
+
+  if (result != vk::Result::eSuccess) {
+    throw abcg::RuntimeError("Failed to wait for command buffer");
+  }
 }
 
 void abcg::VulkanDevice::createCommandPools() {
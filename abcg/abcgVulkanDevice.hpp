@@ -13,9 +13,13 @@
 #ifndef ABCG_VULKAN_DEVICE_HPP_
 #define ABCG_VULKAN_DEVICE_HPP_
 
+#include "abcgVulkanMemoryAllocator.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
+#include "abcgVulkanPipelineCache.hpp"
 
 #include <functional>
+#include <memory>
+#include <string_view>
 
 namespace abcg {
 struct VulkanCommandPools;
@@ -50,12 +54,15 @@ struct abcg::VulkanQueues {
  * resources.
  *
  * This class creates and manages the Vulkan logical device, queues, descriptor
- * pool, and command pools.
+ * pool, command pools, the pipeline cache and the memory allocator.
+ *
+ * Copies of a device share the same memory allocator.
  */
 class abcg::VulkanDevice {
 public:
   void create(VulkanPhysicalDevice const &physicalDevice,
-              std::vector<char const *> const &extensions = {});
+              std::vector<char const *> const &extensions = {},
+              std::string_view pipelineCachePath = {});
   void destroy();
 
   explicit operator vk::Device const &() const noexcept;
@@ -63,6 +70,8 @@ public:
   [[nodiscard]] VulkanPhysicalDevice const &getPhysicalDevice() const noexcept;
   [[nodiscard]] VulkanQueues const &getQueues() const noexcept;
   [[nodiscard]] VulkanCommandPools const &getCommandPools() const noexcept;
+  [[nodiscard]] vk::PipelineCache const &getPipelineCache() const noexcept;
+  [[nodiscard]] VulkanMemoryAllocator &getMemoryAllocator() const noexcept;
 
   void withCommandBuffer(
       std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
@@ -77,6 +86,8 @@ private:
   VulkanPhysicalDevice m_physicalDevice;
   VulkanCommandPools m_commandPools;
   VulkanQueues m_queues;
+  VulkanPipelineCache m_pipelineCache;
+  std::shared_ptr<VulkanMemoryAllocator> m_memoryAllocator;
 };
 
 #endif
\ No newline at end of file
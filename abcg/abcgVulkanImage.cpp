@@ -9,7 +9,6 @@
  */
 
 #include "abcgVulkanImage.hpp"
-#include "abcgVulkanBuffer.hpp"
 
 #include <SDL_image.h>
 #include <cppitertools/itertools.hpp>
@@ -17,17 +16,75 @@
 #include <gsl/gsl>
 
 #include "abcgException.hpp"
+#include "abcgImage.hpp"
+#include "abcgTrace.hpp"
 
+/**
+ * @brief Creates an image from a file and waits for the upload to complete.
+ *
+ * @param device Vulkan device.
+ * @param path Path of the image file.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ *
+ * @throw abcg::RuntimeError if the file cannot be loaded.
+ *
+ * @sa abcg::VulkanImage::create(VulkanDevice const &, std::string_view,
+ * VulkanUploadContext &, bool) for loading several images with a single
+ * submission.
+ */
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                std::string_view path, bool generateMipmaps) {
+  VulkanUploadContext uploads;
+  uploads.create(device);
+  try {
+    create(device, path, uploads, generateMipmaps);
+    uploads.wait(uploads.submit());
+  } catch (...) {
+    uploads.destroy();
+    throw;
+  }
+  uploads.destroy();
+}
+
+/**
+ * @brief Creates an image from a file, recording its upload into an upload
+ * context.
+ *
+ * The pixels are copied to staging memory of the upload context, and the
+ * copy, layout transitions and mipmap generation are recorded into the batch
+ * being recorded. The image must not be used before the ticket returned by
+ * the next call to abcg::VulkanUploadContext::submit is complete.
+ *
+ * KTX2 files are copied as stored, with the mipmap levels they contain, and
+ * `generateMipmaps` is ignored for them.
+ *
+ * @param device Vulkan device.
+ * @param path Path of the image file.
+ * @param uploads Upload context.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ *
+ * @throw abcg::RuntimeError if the file cannot be loaded, or if the format of
+ * a KTX2 file is not supported by the device.
+ */
+void abcg::VulkanImage::create(VulkanDevice const &device,
+                               std::string_view path,
+                               VulkanUploadContext &uploads,
+                               bool generateMipmaps) {
+  ABCG_TRACE_ZONE("VulkanImage::create");
+
   m_device = static_cast<vk::Device>(device);
+  m_memoryAllocator = &device.getMemoryAllocator();
+
+  if (isKTX2Path(path)) {
+    createFromKTX2(device, path, uploads);
+    return;
+  }
 
   // Load the bitmap
   if (SDL_Surface *const surface{IMG_Load(path.data())}) {
     // Enforce RGBA
     SDL_Surface *formattedSurface{
-        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
-    SDL_FreeSurface(surface);
+        convertSurface(surface, SDL_PIXELFORMAT_RGBA32)};
 
     auto const texWidth{gsl::narrow<uint32_t>(formattedSurface->w)};
     auto const texHeight{gsl::narrow<uint32_t>(formattedSurface->h)};
@@ -40,22 +97,20 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
                     1;
     }
 
-    // Create staging buffer
-    abcg::VulkanBuffer stagingBuffer{};
-    stagingBuffer.create(
-        device, {.size = imageSize,
-                 .usage = vk::BufferUsageFlagBits::eTransferSrc,
-                 .properties = vk::MemoryPropertyFlagBits::eHostVisible |
-                               vk::MemoryPropertyFlagBits::eHostCoherent,
-                 .data = formattedSurface->pixels});
+    // Copy to staging memory
+    auto const staging{uploads.stage(formattedSurface->pixels, imageSize)};
 
     SDL_FreeSurface(formattedSurface);
 
     // TODO: Look for other formats if RGBA8 is not supported
     auto const imageFormat{vk::Format::eR8G8B8A8Srgb};
 
+    if (m_mipLevels > 1) {
+      checkLinearBlitSupport(device, imageFormat);
+    }
+
     // Create image buffer
-    std::tie(m_image, m_deviceMemory) = createImage(
+    std::tie(m_image, m_allocation) = createImage(
         device,
         {.imageType = vk::ImageType::e2D,
          .format = imageFormat,
@@ -72,43 +127,55 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
          .initialLayout = vk::ImageLayout::eUndefined},
         vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    transitionImageLayout(device, vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal,
-                          {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                           .levelCount = m_mipLevels,
-                           .layerCount = 1});
+    vk::ImageSubresourceRange const allLevels{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .levelCount = m_mipLevels,
+        .layerCount = 1};
 
     vk::BufferImageCopy const region{
+        .bufferOffset = staging.offset,
         .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
                              .layerCount = 1},
         .imageExtent = {texWidth, texHeight, 1}};
 
-    // Execute the layout transition
-    device.withCommandBuffer(
-        [&stagingBuffer, this,
-         &region](vk::CommandBuffer const &commandBuffer) {
-          commandBuffer.copyBufferToImage(
-              static_cast<vk::Buffer>(stagingBuffer), m_image,
-              vk::ImageLayout::eTransferDstOptimal, region);
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Generate the mipmap levels
+    uploads.record([&](vk::CommandBuffer const &commandBuffer) {
+      recordLayoutTransition(commandBuffer, vk::ImageLayout::eUndefined,
+                             vk::ImageLayout::eTransferDstOptimal, allLevels);
+      commandBuffer.copyBufferToImage(staging.buffer, m_image,
+                                      vk::ImageLayout::eTransferDstOptimal,
+                                      region);
+    });
+
     if (m_mipLevels > 1) {
-      // Transitioned to vk::ImageLayout::eShaderReadOnlyOptimal while
-      // generating the mipmaps
-      createMipmaps(device, m_image, imageFormat, texWidth, texHeight,
-                    m_mipLevels);
+      // Blits require a graphics queue. The image is transitioned to
+      // vk::ImageLayout::eShaderReadOnlyOptimal while generating the mipmaps
+      uploads.transferOwnership(
+          {.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+           .dstAccessMask = vk::AccessFlagBits::eTransferRead |
+                            vk::AccessFlagBits::eTransferWrite,
+           .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+           .newLayout = vk::ImageLayout::eTransferDstOptimal,
+           .image = m_image,
+           .subresourceRange = allLevels},
+          vk::PipelineStageFlagBits::eTransfer,
+          vk::PipelineStageFlagBits::eTransfer);
+      uploads.recordOnGraphicsQueue(
+          [&](vk::CommandBuffer const &commandBuffer) {
+            recordMipmaps(commandBuffer, m_image, texWidth, texHeight,
+                          m_mipLevels);
+          });
     } else {
-      transitionImageLayout(device, vk::ImageLayout::eTransferDstOptimal,
-                            vk::ImageLayout::eReadOnlyOptimal,
-                            {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .levelCount = m_mipLevels,
-                             .layerCount = 1});
+      uploads.transferOwnership(
+          {.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+           .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+           .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+           .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+           .image = m_image,
+           .subresourceRange = allLevels},
+          vk::PipelineStageFlagBits::eTransfer,
+          vk::PipelineStageFlagBits::eFragmentShader);
     }
 
-    stagingBuffer.destroy();
-
     // Create image view
     m_imageView = m_device.createImageView(
         {.image = m_image,
@@ -118,33 +185,7 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
                               .levelCount = 1,
                               .layerCount = 1}});
 
-    // Create sampler
-    vk::SamplerCreateInfo samplerCreateInfo{
-        .magFilter = vk::Filter::eLinear,
-        .minFilter = vk::Filter::eLinear,
-        .mipmapMode = vk::SamplerMipmapMode::eLinear,
-        .addressModeU = vk::SamplerAddressMode::eRepeat,
-        .addressModeV = vk::SamplerAddressMode::eRepeat,
-        .addressModeW = vk::SamplerAddressMode::eRepeat,
-        .mipLodBias = 0.0f,
-        .anisotropyEnable = VK_TRUE,
-        .maxAnisotropy =
-            static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
-                .getProperties()
-                .limits.maxSamplerAnisotropy,
-        .compareEnable = VK_FALSE,
-        .compareOp = vk::CompareOp::eAlways,
-        .minLod = 0.0f,
-        .maxLod = 0.0f,
-        .borderColor = vk::BorderColor::eIntOpaqueBlack,
-        .unnormalizedCoordinates = VK_FALSE};
-
-    if (m_mipLevels > 1) {
-      samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-      samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
-      // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
-    }
-    m_sampler = m_device.createSampler(samplerCreateInfo);
+    createSampler(device);
 
     // Create descriptor info
     m_descriptorImageInfo = {.sampler = m_sampler,
@@ -157,13 +198,99 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
   }
 }
 
+void abcg::VulkanImage::createFromKTX2(VulkanDevice const &device,
+                                       std::string_view path,
+                                       VulkanUploadContext &uploads) {
+  auto const image{loadKTX2(path)};
+  auto const imageFormat{static_cast<vk::Format>(image.format)};
+
+  // Block-compressed formats are optional features of the device
+  vk::FormatProperties const formatProperties{
+      static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+          .getFormatProperties(imageFormat)};
+  if (!(formatProperties.optimalTilingFeatures &
+        vk::FormatFeatureFlagBits::eSampledImage)) {
+    throw abcg::RuntimeError(fmt::format(
+        "Texture format {} of {} is not supported by the device",
+        vk::to_string(imageFormat), path));
+  }
+
+  auto const texWidth{image.levels.front().width};
+  auto const texHeight{image.levels.front().height};
+  m_mipLevels = gsl::narrow<uint32_t>(image.levels.size());
+
+  std::tie(m_image, m_allocation) = createImage(
+      device,
+      {.imageType = vk::ImageType::e2D,
+       .format = imageFormat,
+       .extent = {.width = texWidth, .height = texHeight, .depth = 1},
+       .mipLevels = m_mipLevels,
+       .arrayLayers = 1,
+       .samples = vk::SampleCountFlagBits::e1,
+       .tiling = vk::ImageTiling::eOptimal,
+       .usage = vk::ImageUsageFlagBits::eTransferDst |
+                vk::ImageUsageFlagBits::eSampled,
+       .initialLayout = vk::ImageLayout::eUndefined},
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  vk::ImageSubresourceRange const allLevels{
+      .aspectMask = vk::ImageAspectFlagBits::eColor,
+      .levelCount = m_mipLevels,
+      .layerCount = 1};
+
+  uploads.record([&](vk::CommandBuffer const &commandBuffer) {
+    recordLayoutTransition(commandBuffer, vk::ImageLayout::eUndefined,
+                           vk::ImageLayout::eTransferDstOptimal, allLevels);
+  });
+
+  // Levels may be staged into different blocks, so each one is copied with
+  // its own command
+  for (auto &&[mipLevel, level] : iter::enumerate(image.levels)) {
+    auto const staging{uploads.stage(level.data.data(), level.data.size())};
+    vk::BufferImageCopy const region{
+        .bufferOffset = staging.offset,
+        .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .mipLevel = gsl::narrow<uint32_t>(mipLevel),
+                             .layerCount = 1},
+        .imageExtent = {level.width, level.height, 1}};
+    uploads.record([&](vk::CommandBuffer const &commandBuffer) {
+      commandBuffer.copyBufferToImage(staging.buffer, m_image,
+                                      vk::ImageLayout::eTransferDstOptimal,
+                                      region);
+    });
+  }
+
+  uploads.transferOwnership(
+      {.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+       .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+       .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+       .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+       .image = m_image,
+       .subresourceRange = allLevels},
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eFragmentShader);
+
+  m_imageView = m_device.createImageView({.image = m_image,
+                                          .viewType = vk::ImageViewType::e2D,
+                                          .format = imageFormat,
+                                          .subresourceRange = allLevels});
+
+  createSampler(device);
+
+  m_descriptorImageInfo = {.sampler = m_sampler,
+                           .imageView = m_imageView,
+                           .imageLayout =
+                               vk::ImageLayout::eShaderReadOnlyOptimal};
+}
+
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                VulkanImageCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_memoryAllocator = &device.getMemoryAllocator();
 
   // Create image only if createInfo.viewInfo.image is undefined
   if (!createInfo.viewInfo.image) {
-    std::tie(m_image, m_deviceMemory) =
+    std::tie(m_image, m_allocation) =
         createImage(device, createInfo.info, createInfo.properties);
   }
 
@@ -185,9 +312,10 @@ void abcg::VulkanImage::destroy() {
   if (m_image) {
     m_device.destroyImage(m_image);
   }
-  if (m_deviceMemory) {
-    m_device.freeMemory(m_deviceMemory);
+  if (m_memoryAllocator != nullptr) {
+    m_memoryAllocator->free(m_allocation);
   }
+  m_allocation = {};
 }
 
 /**
@@ -201,10 +329,22 @@ abcg::VulkanImage::operator vk::Image const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with this image.
  *
+ * The memory object may be shared with other resources. The image starts at
+ * the offset returned by abcg::VulkanImage::getMemoryOffset.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanImage::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the offset of the image in its device memory object.
+ *
+ * @return Offset in bytes.
+ */
+vk::DeviceSize abcg::VulkanImage::getMemoryOffset() const noexcept {
+  return m_allocation.offset;
 }
 
 /**
@@ -241,7 +381,7 @@ uint32_t abcg::VulkanImage::getMipLevels() const noexcept {
   return m_mipLevels;
 }
 
-std::pair<vk::Image, vk::DeviceMemory>
+std::pair<vk::Image, abcg::VulkanAllocation>
 abcg::VulkanImage::createImage(VulkanDevice const &device,
                                vk::ImageCreateInfo const &imageInfo,
                                vk::MemoryPropertyFlags properties) const {
@@ -251,24 +391,56 @@ abcg::VulkanImage::createImage(VulkanDevice const &device,
   // Get memory requirements
   auto const memoryRequirements{m_device.getImageMemoryRequirements(image)};
 
-  // Allocate image memory
-  auto const memoryType{device.getPhysicalDevice().findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
+  // Sub-allocate image memory
+  VulkanAllocation allocation;
+  try {
+    allocation = device.getMemoryAllocator().allocate(
+        memoryRequirements, properties,
+        imageInfo.tiling == vk::ImageTiling::eOptimal
+            ? VulkanResourceTiling::Optimal
+            : VulkanResourceTiling::Linear);
+  } catch (...) {
+    m_device.destroyImage(image);
+    throw;
   }
-  auto imageMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
 
   // Associate image memory to image
-  m_device.bindImageMemory(image, imageMemory, 0);
+  m_device.bindImageMemory(image, allocation.memory, allocation.offset);
 
-  return {image, imageMemory};
+  return {image, allocation};
 }
 
-void abcg::VulkanImage::transitionImageLayout(
-    VulkanDevice const &device, vk::ImageLayout oldImageLayout,
+void abcg::VulkanImage::createSampler(VulkanDevice const &device) {
+  vk::SamplerCreateInfo samplerCreateInfo{
+      .magFilter = vk::Filter::eLinear,
+      .minFilter = vk::Filter::eLinear,
+      .mipmapMode = vk::SamplerMipmapMode::eLinear,
+      .addressModeU = vk::SamplerAddressMode::eRepeat,
+      .addressModeV = vk::SamplerAddressMode::eRepeat,
+      .addressModeW = vk::SamplerAddressMode::eRepeat,
+      .mipLodBias = 0.0f,
+      .anisotropyEnable = VK_TRUE,
+      .maxAnisotropy =
+          static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+              .getProperties()
+              .limits.maxSamplerAnisotropy,
+      .compareEnable = VK_FALSE,
+      .compareOp = vk::CompareOp::eAlways,
+      .minLod = 0.0f,
+      .maxLod = 0.0f,
+      .borderColor = vk::BorderColor::eIntOpaqueBlack,
+      .unnormalizedCoordinates = VK_FALSE};
+
+  if (m_mipLevels > 1) {
+    samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
+    // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
+  }
+  m_sampler = m_device.createSampler(samplerCreateInfo);
+}
+
+void abcg::VulkanImage::recordLayoutTransition(
+    vk::CommandBuffer const &commandBuffer, vk::ImageLayout oldImageLayout,
     vk::ImageLayout newImageLayout,
     vk::ImageSubresourceRange subresourceRange) const {
 
@@ -324,20 +496,13 @@ void abcg::VulkanImage::transitionImageLayout(
   auto srcStageMask{stageMask(oldImageLayout)};
   auto destStageMask{stageMask(newImageLayout)};
 
-  // Execute the layout transition
-  device.withCommandBuffer(
-      [&](const auto &commandBuffer) {
-        commandBuffer.pipelineBarrier(srcStageMask, destStageMask,
-                                      vk::DependencyFlags(), nullptr, nullptr,
-                                      imageMemoryBarrier);
-      },
-      vk::QueueFlagBits::eTransfer);
+  commandBuffer.pipelineBarrier(srcStageMask, destStageMask,
+                                vk::DependencyFlags(), nullptr, nullptr,
+                                imageMemoryBarrier);
 }
 
-void abcg::VulkanImage::createMipmaps(VulkanDevice const &device,
-                                      vk::Image image, vk::Format imageFormat,
-                                      uint32_t texWidth, uint32_t texHeight,
-                                      uint32_t mipLevels) {
+void abcg::VulkanImage::checkLinearBlitSupport(VulkanDevice const &device,
+                                               vk::Format imageFormat) {
   // Check if image format supports linear blitting
   vk::FormatProperties const formatProperties{
       static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
@@ -349,79 +514,79 @@ void abcg::VulkanImage::createMipmaps(VulkanDevice const &device,
     throw abcg::RuntimeError(
         "Texture image format does not support linear blitting");
   }
+}
+
+void abcg::VulkanImage::recordMipmaps(vk::CommandBuffer const &commandBuffer,
+                                      vk::Image image, uint32_t texWidth,
+                                      uint32_t texHeight, uint32_t mipLevels) {
+  vk::ImageMemoryBarrier barrier{
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                           .levelCount = 1,
+                           .baseArrayLayer = 0,
+                           .layerCount = 1}};
+
+  auto mipWidth{gsl::narrow<int32_t>(texWidth)};
+  auto mipHeight{gsl::narrow<int32_t>(texHeight)};
+
+  for (auto const mipLevel : iter::range(1U, mipLevels)) {
+    barrier.subresourceRange.baseMipLevel = mipLevel - 1;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlagBits{}, {}, {},
+                                  {{barrier}});
+
+    vk::ImageBlit blit{};
+    blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
+    blit.srcOffsets[1] = vk::Offset3D{mipWidth, mipHeight, 1};
+    blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    blit.srcSubresource.mipLevel = mipLevel - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.dstOffsets[0] = vk::Offset3D{0, 0, 0};
+    blit.dstOffsets[1] =
+        vk::Offset3D{mipWidth > 1 ? mipWidth / 2 : 1,
+                     mipHeight > 1 ? mipHeight / 2 : 1, 1};
+    blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    blit.dstSubresource.mipLevel = mipLevel;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount = 1;
+
+    commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal,
+                            image, vk::ImageLayout::eTransferDstOptimal,
+                            {blit}, vk::Filter::eLinear);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eFragmentShader,
+        vk::DependencyFlagBits{}, {}, {}, {barrier});
+
+    if (mipWidth > 1)
+      mipWidth /= 2;
+    if (mipHeight > 1)
+      mipHeight /= 2;
+  }
+
+  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-  device.withCommandBuffer(
-      [&](vk::CommandBuffer const &commandBuffer) {
-        vk::ImageMemoryBarrier barrier{
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = image,
-            .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                                 .levelCount = 1,
-                                 .baseArrayLayer = 0,
-                                 .layerCount = 1}};
-
-        auto mipWidth{gsl::narrow<int32_t>(texWidth)};
-        auto mipHeight{gsl::narrow<int32_t>(texHeight)};
-
-        for (auto const mipLevel : iter::range(1U, mipLevels)) {
-          barrier.subresourceRange.baseMipLevel = mipLevel - 1;
-          barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-          barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-          barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-          barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-          commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                        vk::PipelineStageFlagBits::eTransfer,
-                                        vk::DependencyFlagBits{}, {}, {},
-                                        {{barrier}});
-
-          vk::ImageBlit blit{};
-          blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
-          blit.srcOffsets[1] = vk::Offset3D{mipWidth, mipHeight, 1};
-          blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-          blit.srcSubresource.mipLevel = mipLevel - 1;
-          blit.srcSubresource.baseArrayLayer = 0;
-          blit.srcSubresource.layerCount = 1;
-          blit.dstOffsets[0] = vk::Offset3D{0, 0, 0};
-          blit.dstOffsets[1] =
-              vk::Offset3D{mipWidth > 1 ? mipWidth / 2 : 1,
-                           mipHeight > 1 ? mipHeight / 2 : 1, 1};
-          blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-          blit.dstSubresource.mipLevel = mipLevel;
-          blit.dstSubresource.baseArrayLayer = 0;
-          blit.dstSubresource.layerCount = 1;
-
-          commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal,
-                                  image, vk::ImageLayout::eTransferDstOptimal,
-                                  {blit}, vk::Filter::eLinear);
-
-          barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-          barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-          barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-          barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-          commandBuffer.pipelineBarrier(
-              vk::PipelineStageFlagBits::eTransfer,
-              vk::PipelineStageFlagBits::eFragmentShader,
-              vk::DependencyFlagBits{}, {}, {}, {barrier});
-
-          if (mipWidth > 1)
-            mipWidth /= 2;
-          if (mipHeight > 1)
-            mipHeight /= 2;
-        }
-
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        commandBuffer.pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            vk::DependencyFlagBits{}, {}, {}, {barrier});
-      },
-      vk::QueueFlagBits::eGraphics);
+  commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eFragmentShader,
+      vk::DependencyFlagBits{}, {}, {}, {barrier});
 }
@@ -13,7 +13,9 @@
 #ifndef ABCG_VULKAN_IMAGE_HPP_
 #define ABCG_VULKAN_IMAGE_HPP_
 
+#include "abcgKTX2.hpp"
 #include "abcgVulkanDevice.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/pointers>
 
@@ -41,6 +43,8 @@ class abcg::VulkanImage {
 public:
   void create(VulkanDevice const &device, std::string_view path,
               bool generateMipmaps = true);
+  void create(VulkanDevice const &device, std::string_view path,
+              VulkanUploadContext &uploads, bool generateMipmaps = true);
   void create(VulkanDevice const &device,
               VulkanImageCreateInfo const &createInfo);
   void destroy();
@@ -48,29 +52,36 @@ public:
   explicit operator vk::Image const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] vk::DeviceSize getMemoryOffset() const noexcept;
   [[nodiscard]] vk::ImageView const &getView() const noexcept;
   [[nodiscard]] vk::DescriptorImageInfo const &
   getDescriptorImageInfo() const noexcept;
   [[nodiscard]] uint32_t getMipLevels() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Image, vk::DeviceMemory>
+  void createFromKTX2(VulkanDevice const &device, std::string_view path,
+                      VulkanUploadContext &uploads);
+  [[nodiscard]] std::pair<vk::Image, VulkanAllocation>
   createImage(VulkanDevice const &device, vk::ImageCreateInfo const &imageInfo,
               vk::MemoryPropertyFlags properties) const;
-  void transitionImageLayout(VulkanDevice const &device,
-                             vk::ImageLayout oldImageLayout,
-                             vk::ImageLayout newImageLayout,
-                             vk::ImageSubresourceRange subresourceRange = {
-                                 .aspectMask = vk::ImageAspectFlagBits::eColor,
-                                 .levelCount = 1,
-                                 .layerCount = 1}) const;
+  void createSampler(VulkanDevice const &device);
+  void recordLayoutTransition(vk::CommandBuffer const &commandBuffer,
+                              vk::ImageLayout oldImageLayout,
+                              vk::ImageLayout newImageLayout,
+                              vk::ImageSubresourceRange subresourceRange = {
+                                  .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                  .levelCount = 1,
+                                  .layerCount = 1}) const;
 
-  static void createMipmaps(VulkanDevice const &device, vk::Image image,
-                            vk::Format imageFormat, uint32_t texWidth,
+  static void checkLinearBlitSupport(VulkanDevice const &device,
+                                     vk::Format imageFormat);
+  static void recordMipmaps(vk::CommandBuffer const &commandBuffer,
+                            vk::Image image, uint32_t texWidth,
                             uint32_t texHeight, uint32_t mipLevels);
 
   vk::Image m_image;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanMemoryAllocator *m_memoryAllocator{};
   vk::ImageView m_imageView;
   vk::Sampler m_sampler;
   vk::DescriptorImageInfo m_descriptorImageInfo;
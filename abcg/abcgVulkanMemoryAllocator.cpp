@@ -0,0 +1,333 @@
+/**
+ * @file abcgVulkanMemoryAllocator.cpp
+ * @brief Definition of abcg::VulkanMemoryAllocator
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanMemoryAllocator.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include <algorithm>
+
+#include "abcgException.hpp"
+
+namespace {
+[[nodiscard]] vk::DeviceSize alignUp(vk::DeviceSize value,
+                                     vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+[[nodiscard]] vk::DeviceSize alignDown(vk::DeviceSize value,
+                                       vk::DeviceSize alignment) {
+  return value / alignment * alignment;
+}
+} // namespace
+
+/**
+ * @brief Creates the allocator.
+ *
+ * No memory is allocated until the first call to
+ * abcg::VulkanMemoryAllocator::allocate.
+ *
+ * @param physicalDevice Physical device.
+ * @param device Logical device.
+ * @param blockSize Size in bytes of each block. Smaller blocks are used for
+ * heaps smaller than eight times this size.
+ */
+void abcg::VulkanMemoryAllocator::create(
+    VulkanPhysicalDevice const &physicalDevice, vk::Device const &device,
+    vk::DeviceSize blockSize) {
+  m_device = device;
+  m_physicalDevice = physicalDevice;
+  m_blockSize = blockSize;
+
+  auto const vkPhysicalDevice{
+      static_cast<vk::PhysicalDevice>(m_physicalDevice)};
+  m_memoryProperties = vkPhysicalDevice.getMemoryProperties();
+  auto const &limits{vkPhysicalDevice.getProperties().limits};
+  m_bufferImageGranularity =
+      std::max(limits.bufferImageGranularity, vk::DeviceSize{1});
+  m_nonCoherentAtomSize =
+      std::max(limits.nonCoherentAtomSize, vk::DeviceSize{1});
+
+  std::scoped_lock lock{m_mutex};
+  m_pools.clear();
+  m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+}
+
+/**
+ * @brief Releases all blocks.
+ *
+ * Allocations not yet freed become invalid.
+ */
+void abcg::VulkanMemoryAllocator::destroy() {
+  std::scoped_lock lock{m_mutex};
+  for (auto const &pool : m_pools) {
+    for (auto const &block : pool) {
+      destroyBlock(block);
+    }
+  }
+  m_pools.clear();
+}
+
+/**
+ * @brief Allocates a region of device memory.
+ *
+ * @param requirements Memory requirements of the resource.
+ * @param properties Required memory properties.
+ * @param tiling Tiling of the resource.
+ *
+ * @throw abcg::RuntimeError if no memory type satisfies the requirements.
+ *
+ * @return Allocated region. The resource must be bound at
+ * abcg::VulkanAllocation::offset of abcg::VulkanAllocation::memory.
+ */
+abcg::VulkanAllocation abcg::VulkanMemoryAllocator::allocate(
+    vk::MemoryRequirements const &requirements,
+    vk::MemoryPropertyFlags properties, VulkanResourceTiling tiling) {
+  auto const memoryType{m_physicalDevice.findMemoryType(
+      requirements.memoryTypeBits, properties)};
+  if (!memoryType.has_value()) {
+    throw abcg::RuntimeError("Failed to find suitable memory type");
+  }
+
+  // Blocks are smaller on small heaps (e.g., host-visible device local memory)
+  auto const heapSize{
+      m_memoryProperties
+          .memoryHeaps[m_memoryProperties.memoryTypes[memoryType.value()]
+                           .heapIndex]
+          .size};
+  auto const blockSize{
+      std::min(m_blockSize, std::max(heapSize / 8, vk::DeviceSize{1}))};
+
+  auto const alignment{std::max(requirements.alignment, vk::DeviceSize{1})};
+
+  std::scoped_lock lock{m_mutex};
+  auto &pool{m_pools.at(getPoolIndex(memoryType.value(), tiling))};
+
+  auto const makeAllocation{[&](Block &block, vk::DeviceSize offset) {
+    block.used += requirements.size;
+    ++block.allocationCount;
+    return VulkanAllocation{
+        .memory = block.memory,
+        .offset = offset,
+        .size = requirements.size,
+        .mappedData =
+            block.mappedData != nullptr ? block.mappedData + offset : nullptr,
+        .memoryType = memoryType.value()};
+  }};
+
+  if (requirements.size > blockSize / 2) {
+    auto &block{pool.emplace_back(
+        createBlock(memoryType.value(), requirements.size))};
+    block.dedicated = true;
+    block.freeRanges.clear();
+    return makeAllocation(block, 0);
+  }
+
+  for (auto &block : pool) {
+    if (block.dedicated) {
+      continue;
+    }
+    if (auto const offset{
+            allocateFromBlock(block, requirements.size, alignment)}) {
+      return makeAllocation(block, offset.value());
+    }
+  }
+
+  auto &block{pool.emplace_back(createBlock(memoryType.value(), blockSize))};
+  auto const offset{allocateFromBlock(block, requirements.size, alignment)};
+  return makeAllocation(block, offset.value());
+}
+
+/**
+ * @brief Frees a region allocated with abcg::VulkanMemoryAllocator::allocate.
+ *
+ * Blocks that become empty are released, except for one empty block per
+ * memory type, which is kept for reuse.
+ *
+ * @param allocation Allocated region. Nothing happens if it has no memory.
+ */
+void abcg::VulkanMemoryAllocator::free(VulkanAllocation const &allocation) {
+  if (!allocation.memory) {
+    return;
+  }
+
+  std::scoped_lock lock{m_mutex};
+  for (auto const tiling :
+       {VulkanResourceTiling::Linear, VulkanResourceTiling::Optimal}) {
+    auto &pool{m_pools.at(getPoolIndex(allocation.memoryType, tiling))};
+    auto const iter{std::ranges::find_if(pool, [&](auto const &block) {
+      return block.memory == allocation.memory;
+    })};
+    if (iter == pool.end()) {
+      continue;
+    }
+
+    auto &block{*iter};
+    block.used -= allocation.size;
+    --block.allocationCount;
+    if (!block.dedicated) {
+      freeFromBlock(block,
+                    {.offset = allocation.offset, .size = allocation.size});
+    }
+
+    if (block.allocationCount == 0) {
+      auto const emptyBlocks{std::ranges::count_if(pool, [](auto const &b) {
+        return !b.dedicated && b.allocationCount == 0;
+      })};
+      if (block.dedicated || emptyBlocks > 1) {
+        destroyBlock(block);
+        pool.erase(iter);
+      }
+    }
+    return;
+  }
+}
+
+/**
+ * @brief Makes host writes to a region visible to the device.
+ *
+ * Does nothing if the memory type is host coherent.
+ *
+ * @param allocation Allocated region.
+ * @param offset Offset from the beginning of the region.
+ * @param size Number of bytes to flush.
+ */
+void abcg::VulkanMemoryAllocator::flush(VulkanAllocation const &allocation,
+                                        vk::DeviceSize offset,
+                                        vk::DeviceSize size) const {
+  if (m_memoryProperties.memoryTypes[allocation.memoryType].propertyFlags &
+      vk::MemoryPropertyFlagBits::eHostCoherent) {
+    return;
+  }
+
+  // The range must be aligned to the non-coherent atom size
+  auto const begin{
+      alignDown(allocation.offset + offset, m_nonCoherentAtomSize)};
+  auto const end{
+      alignUp(allocation.offset + offset + size, m_nonCoherentAtomSize)};
+  m_device.flushMappedMemoryRanges({{.memory = allocation.memory,
+                                     .offset = begin,
+                                     .size = end - begin}});
+}
+
+/**
+ * @brief Returns the memory usage of each heap.
+ *
+ * @return Usage statistics, indexed by heap.
+ */
+std::vector<abcg::VulkanHeapStats>
+abcg::VulkanMemoryAllocator::getStats() const {
+  std::vector<VulkanHeapStats> stats(m_memoryProperties.memoryHeapCount);
+  for (auto const heapIndex : iter::range(stats.size())) {
+    stats.at(heapIndex).heap = m_memoryProperties.memoryHeaps.at(heapIndex);
+  }
+
+  std::scoped_lock lock{m_mutex};
+  for (auto &&[poolIndex, pool] : iter::enumerate(m_pools)) {
+    auto const memoryType{gsl::narrow<uint32_t>(poolIndex / 2)};
+    auto &heapStats{stats.at(
+        m_memoryProperties.memoryTypes.at(memoryType).heapIndex)};
+    for (auto const &block : pool) {
+      heapStats.reserved += block.size;
+      heapStats.used += block.used;
+      heapStats.allocationCount += block.allocationCount;
+      ++heapStats.blockCount;
+    }
+  }
+
+  return stats;
+}
+
+std::size_t
+abcg::VulkanMemoryAllocator::getPoolIndex(uint32_t memoryType,
+                                          VulkanResourceTiling tiling) const {
+  // Linear and optimal resources can share blocks if pages are not an issue
+  auto const separate{m_bufferImageGranularity > 1 &&
+                      tiling == VulkanResourceTiling::Optimal};
+  return std::size_t{memoryType} * 2 + (separate ? 1 : 0);
+}
+
+abcg::VulkanMemoryAllocator::Block
+abcg::VulkanMemoryAllocator::createBlock(uint32_t memoryType,
+                                         vk::DeviceSize size) const {
+  // Flushed ranges are rounded to the atom size and must not exceed the block
+  size = alignUp(size, m_nonCoherentAtomSize);
+
+  Block block{.memory = m_device.allocateMemory(
+                  {.allocationSize = size, .memoryTypeIndex = memoryType}),
+              .size = size,
+              .freeRanges = {{.offset = 0, .size = size}}};
+
+  if (m_memoryProperties.memoryTypes.at(memoryType).propertyFlags &
+      vk::MemoryPropertyFlagBits::eHostVisible) {
+    block.mappedData = static_cast<std::byte *>(
+        m_device.mapMemory(block.memory, 0, VK_WHOLE_SIZE));
+  }
+
+  return block;
+}
+
+void abcg::VulkanMemoryAllocator::destroyBlock(Block const &block) const {
+  if (block.mappedData != nullptr) {
+    m_device.unmapMemory(block.memory);
+  }
+  m_device.freeMemory(block.memory);
+}
+
+std::optional<vk::DeviceSize>
+abcg::VulkanMemoryAllocator::allocateFromBlock(Block &block,
+                                               vk::DeviceSize size,
+                                               vk::DeviceSize alignment) {
+  // First fit
+  for (auto iter{block.freeRanges.begin()}; iter != block.freeRanges.end();
+       ++iter) {
+    auto const range{*iter};
+    auto const offset{alignUp(range.offset, alignment)};
+    if (offset + size > range.offset + range.size) {
+      continue;
+    }
+
+    // Keep the padding before and the remainder after the allocation
+    std::vector<Range> split;
+    if (offset > range.offset) {
+      split.push_back({.offset = range.offset, .size = offset - range.offset});
+    }
+    if (auto const end{offset + size}; end < range.offset + range.size) {
+      split.push_back({.offset = end, .size = range.offset + range.size - end});
+    }
+    iter = block.freeRanges.erase(iter);
+    block.freeRanges.insert(iter, split.begin(), split.end());
+    return offset;
+  }
+  return std::nullopt;
+}
+
+void abcg::VulkanMemoryAllocator::freeFromBlock(Block &block, Range range) {
+  auto &ranges{block.freeRanges};
+  auto iter{ranges.insert(
+      std::ranges::upper_bound(ranges, range.offset, {}, &Range::offset),
+      range)};
+
+  // Merge with the next range
+  if (auto next{std::next(iter)};
+      next != ranges.end() && iter->offset + iter->size == next->offset) {
+    iter->size += next->size;
+    ranges.erase(next);
+  }
+
+  // Merge with the previous range
+  if (iter != ranges.begin()) {
+    if (auto prev{std::prev(iter)}; prev->offset + prev->size == iter->offset) {
+      prev->size += iter->size;
+      ranges.erase(iter);
+    }
+  }
+}
@@ -0,0 +1,152 @@
+/**
+ * @file abcgVulkanMemoryAllocator.hpp
+ * @brief Header file of abcg::VulkanMemoryAllocator
+ *
+ * Declaration of abcg::VulkanMemoryAllocator and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_MEMORY_ALLOCATOR_HPP_
+#define ABCG_VULKAN_MEMORY_ALLOCATOR_HPP_
+
+#include "abcgVulkanPhysicalDevice.hpp"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace abcg {
+enum class VulkanResourceTiling;
+struct VulkanAllocation;
+struct VulkanHeapStats;
+class VulkanMemoryAllocator;
+} // namespace abcg
+
+/**
+ * @brief Tiling of the resource bound to an allocation.
+ *
+ * Linear and optimal resources are kept in separate blocks when the device
+ * has a `bufferImageGranularity` greater than one, so that they never share a
+ * page.
+ */
+enum class abcg::VulkanResourceTiling {
+  /** @brief Buffers and images with linear tiling. */
+  Linear,
+  /** @brief Images with optimal tiling. */
+  Optimal
+};
+
+/**
+ * @brief Region of device memory returned by
+ * abcg::VulkanMemoryAllocator::allocate.
+ */
+struct abcg::VulkanAllocation {
+  /** @brief Memory object the region belongs to. */
+  vk::DeviceMemory memory;
+  /** @brief Offset of the region in the memory object. */
+  vk::DeviceSize offset{};
+  /** @brief Size of the region in bytes. */
+  vk::DeviceSize size{};
+  /** @brief Pointer to the beginning of the region, or `nullptr` if the
+   * memory is not host visible.
+   */
+  std::byte *mappedData{};
+  /** @brief Memory type index. */
+  uint32_t memoryType{};
+};
+
+/**
+ * @brief Memory usage of a heap, as returned by
+ * abcg::VulkanMemoryAllocator::getStats.
+ */
+struct abcg::VulkanHeapStats {
+  /** @brief Properties of the heap. */
+  vk::MemoryHeap heap{};
+  /** @brief Bytes allocated from the driver. */
+  vk::DeviceSize reserved{};
+  /** @brief Bytes of the reserved memory handed out to resources. */
+  vk::DeviceSize used{};
+  /** @brief Number of memory objects allocated from the driver. */
+  std::size_t blockCount{};
+  /** @brief Number of sub-allocations. */
+  std::size_t allocationCount{};
+};
+
+/**
+ * @brief A class for sub-allocating device memory.
+ *
+ * Memory is allocated from the driver in large blocks, one list of blocks per
+ * memory type (and per resource tiling, see abcg::VulkanResourceTiling).
+ * Allocations are placed in the first free range that fits, and freed ranges
+ * are merged with their neighbors. Allocations larger than half a block get a
+ * block of their own.
+ *
+ * Blocks of host-visible memory types are mapped for as long as they exist.
+ *
+ * This class is thread-safe. It is owned by abcg::VulkanDevice and used by
+ * abcg::VulkanBuffer and abcg::VulkanImage.
+ *
+ * @sa abcg::VulkanSettings::showMemoryStats.
+ */
+class abcg::VulkanMemoryAllocator {
+public:
+  void create(VulkanPhysicalDevice const &physicalDevice,
+              vk::Device const &device,
+              vk::DeviceSize blockSize = 64UL * 1024UL * 1024UL);
+  void destroy();
+
+  [[nodiscard]] VulkanAllocation
+  allocate(vk::MemoryRequirements const &requirements,
+           vk::MemoryPropertyFlags properties, VulkanResourceTiling tiling);
+  void free(VulkanAllocation const &allocation);
+  void flush(VulkanAllocation const &allocation, vk::DeviceSize offset,
+             vk::DeviceSize size) const;
+
+  [[nodiscard]] std::vector<VulkanHeapStats> getStats() const;
+
+private:
+  struct Range {
+    vk::DeviceSize offset{};
+    vk::DeviceSize size{};
+  };
+
+  struct Block {
+    vk::DeviceMemory memory;
+    vk::DeviceSize size{};
+    vk::DeviceSize used{};
+    std::size_t allocationCount{};
+    std::byte *mappedData{};
+    bool dedicated{};
+    // Free ranges sorted by offset
+    std::vector<Range> freeRanges;
+  };
+
+  [[nodiscard]] std::size_t getPoolIndex(uint32_t memoryType,
+                                         VulkanResourceTiling tiling) const;
+  [[nodiscard]] Block createBlock(uint32_t memoryType,
+                                  vk::DeviceSize size) const;
+  void destroyBlock(Block const &block) const;
+  [[nodiscard]] static std::optional<vk::DeviceSize>
+  allocateFromBlock(Block &block, vk::DeviceSize size,
+                    vk::DeviceSize alignment);
+  static void freeFromBlock(Block &block, Range range);
+
+  vk::Device m_device;
+  VulkanPhysicalDevice m_physicalDevice;
+  vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+  vk::DeviceSize m_blockSize{};
+  vk::DeviceSize m_bufferImageGranularity{1};
+  vk::DeviceSize m_nonCoherentAtomSize{1};
+
+  // One pool per memory type and resource tiling
+  std::vector<std::list<Block>> m_pools;
+  mutable std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,273 @@
+/**
+ * @file abcgVulkanParallelRecorder.cpp
+ * @brief Definition of abcg::VulkanParallelRecorder
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanParallelRecorder.hpp"
+
+#include <cppitertools/itertools.hpp>
+
+#include <algorithm>
+
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+/**
+ * @brief Destructor.
+ *
+ * Stops the worker threads. Vulkan objects are only released by
+ * abcg::VulkanParallelRecorder::destroy.
+ */
+abcg::VulkanParallelRecorder::~VulkanParallelRecorder() { stopWorkers(); }
+
+/**
+ * @brief Creates the worker threads.
+ *
+ * @param device Vulkan device. The device must outlive the recorder.
+ * @param threadCount Number of threads that record command buffers, including
+ * the thread that calls abcg::VulkanParallelRecorder::record. If zero, the
+ * number of hardware threads is used.
+ */
+void abcg::VulkanParallelRecorder::create(VulkanDevice const &device,
+                                          std::size_t threadCount) {
+  destroy();
+
+  auto const &queuesFamilies{device.getPhysicalDevice().getQueuesFamilies()};
+  if (!queuesFamilies.graphics.has_value()) {
+    throw abcg::RuntimeError("Graphics queue family not found");
+  }
+
+  m_device = static_cast<vk::Device>(device);
+  m_graphicsQueueFamily = queuesFamilies.graphics.value();
+  m_threadCount =
+      threadCount > 0
+          ? threadCount
+          : std::max(std::size_t{1},
+                     std::size_t{std::thread::hardware_concurrency()});
+
+  // Workers wait for jobs newer than the last one started
+  m_stopping = false;
+  for (auto const index : iter::range(std::size_t{1}, m_threadCount)) {
+    m_workers.emplace_back([this, index, generation = m_jobGeneration] {
+      workerLoop(index, generation);
+    });
+  }
+}
+
+/**
+ * @brief Stops the worker threads and destroys the command pools.
+ */
+void abcg::VulkanParallelRecorder::destroy() {
+  stopWorkers();
+
+  for (auto const &framePools : m_pools) {
+    for (auto const &pool : framePools) {
+      m_device.destroyCommandPool(pool.commandPool);
+    }
+  }
+  m_pools.clear();
+  m_frameIndex = 0;
+  m_threadCount = 0;
+}
+
+/**
+ * @brief Selects the command pools of a frame and resets them.
+ *
+ * Call this once per frame in abcg::VulkanWindow::onPaint, before the first
+ * call to abcg::VulkanParallelRecorder::record.
+ *
+ * @param frame Frame being recorded.
+ */
+void abcg::VulkanParallelRecorder::beginFrame(VulkanFrame const &frame) {
+  m_frameIndex = frame.index;
+
+  // Pools of a new frame in flight are created on first use
+  if (m_frameIndex >= m_pools.size()) {
+    m_pools.resize(m_frameIndex + 1);
+  }
+  auto &framePools{m_pools.at(m_frameIndex)};
+  if (framePools.empty()) {
+    framePools.resize(m_threadCount);
+    for (auto &pool : framePools) {
+      pool.commandPool = m_device.createCommandPool(
+          {.flags = vk::CommandPoolCreateFlagBits::eTransient,
+           .queueFamilyIndex = m_graphicsQueueFamily});
+    }
+  }
+
+  for (auto &pool : framePools) {
+    m_device.resetCommandPool(pool.commandPool);
+    pool.usedCommandBuffers = 0;
+  }
+}
+
+/**
+ * @brief Records a range of items on all threads and executes the result in
+ * the primary command buffer of the frame.
+ *
+ * Must be called between `beginRenderPass` with
+ * vk::SubpassContents::eSecondaryCommandBuffers and `endRenderPass` on
+ * abcg::VulkanFrame::commandBuffer. Returns after all chunks are recorded.
+ *
+ * @param frame Frame being recorded.
+ * @param renderPass Render pass the commands are recorded for (e.g.,
+ * abcg::VulkanSwapchain::getMainRenderPass). The commands are recorded for
+ * its first subpass.
+ * @param itemCount Number of items to be recorded.
+ * @param fun Function that records a chunk of items. Called concurrently by
+ * different threads, once per chunk.
+ * @param minItemsPerChunk Minimum number of items of each chunk. Use larger
+ * values when recording an item is cheap, so that the cost of waking up the
+ * workers is not larger than the work itself.
+ *
+ * @throw abcg::RuntimeError if abcg::VulkanParallelRecorder::beginFrame was
+ * not called for the frame.
+ * @throw Any exception thrown by `fun`. The first one, in chunk order, is
+ * rethrown after all threads finish. Nothing is executed in this case.
+ */
+void abcg::VulkanParallelRecorder::record(VulkanFrame const &frame,
+                                          vk::RenderPass const &renderPass,
+                                          std::size_t itemCount,
+                                          RecordFunction const &fun,
+                                          std::size_t minItemsPerChunk) {
+  ABCG_TRACE_ZONE("VulkanParallelRecorder::record");
+
+  if (m_frameIndex >= m_pools.size() || frame.index != m_frameIndex) {
+    throw abcg::RuntimeError(
+        "VulkanParallelRecorder::beginFrame was not called for this frame");
+  }
+  if (itemCount == 0) {
+    return;
+  }
+
+  // Split the items into contiguous chunks of similar size
+  minItemsPerChunk = std::max(minItemsPerChunk, std::size_t{1});
+  auto const chunkCount{std::min(
+      m_threadCount, (itemCount + minItemsPerChunk - 1) / minItemsPerChunk)};
+  m_chunks.assign(chunkCount, {});
+  for (auto &&[index, chunk] : iter::enumerate(m_chunks)) {
+    chunk.first = index * itemCount / chunkCount;
+    chunk.last = (index + 1) * itemCount / chunkCount;
+  }
+
+  m_inheritanceInfo = vk::CommandBufferInheritanceInfo{
+      .renderPass = renderPass, .subpass = 0};
+  m_fun = &fun;
+  m_nextChunk = 0;
+
+  // Workers are only woken up if there is more than one chunk
+  auto const parallel{chunkCount > 1 && !m_workers.empty()};
+  if (parallel) {
+    {
+      std::scoped_lock lock{m_mutex};
+      ++m_jobGeneration;
+      m_busyWorkers = m_workers.size();
+    }
+    m_jobStarted.notify_all();
+  }
+
+  recordChunks(0);
+
+  if (parallel) {
+    std::unique_lock lock{m_mutex};
+    m_jobFinished.wait(lock, [this] { return m_busyWorkers == 0; });
+  }
+  m_fun = nullptr;
+
+  for (auto const &chunk : m_chunks) {
+    if (chunk.error) {
+      std::rethrow_exception(chunk.error);
+    }
+  }
+
+  std::vector<vk::CommandBuffer> commandBuffers;
+  commandBuffers.reserve(m_chunks.size());
+  for (auto const &chunk : m_chunks) {
+    commandBuffers.push_back(chunk.commandBuffer);
+  }
+  frame.commandBuffer.executeCommands(commandBuffers);
+}
+
+/**
+ * @brief Returns the number of threads that record command buffers.
+ *
+ * @return Number of worker threads plus one, for the calling thread.
+ */
+std::size_t abcg::VulkanParallelRecorder::getThreadCount() const noexcept {
+  return m_threadCount;
+}
+
+void abcg::VulkanParallelRecorder::stopWorkers() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_jobStarted.notify_all();
+  m_workers.clear();
+}
+
+void abcg::VulkanParallelRecorder::workerLoop(std::size_t threadIndex,
+                                              uint64_t generation) {
+  while (true) {
+    {
+      std::unique_lock lock{m_mutex};
+      m_jobStarted.wait(lock, [&] {
+        return m_stopping || m_jobGeneration != generation;
+      });
+      if (m_stopping) {
+        return;
+      }
+      generation = m_jobGeneration;
+    }
+
+    recordChunks(threadIndex);
+
+    {
+      std::scoped_lock lock{m_mutex};
+      --m_busyWorkers;
+    }
+    m_jobFinished.notify_one();
+  }
+}
+
+void abcg::VulkanParallelRecorder::recordChunks(std::size_t threadIndex) {
+  ABCG_TRACE_ZONE("VulkanParallelRecorder::recordChunks");
+
+  // Each thread takes the next chunk not yet taken until none is left
+  for (auto index{m_nextChunk++}; index < m_chunks.size();
+       index = m_nextChunk++) {
+    auto &chunk{m_chunks.at(index)};
+    try {
+      chunk.commandBuffer = acquireCommandBuffer(threadIndex);
+      chunk.commandBuffer.begin(
+          {.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue |
+                    vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+           .pInheritanceInfo = &m_inheritanceInfo});
+      (*m_fun)(chunk.commandBuffer, chunk.first, chunk.last);
+      chunk.commandBuffer.end();
+    } catch (...) {
+      chunk.error = std::current_exception();
+    }
+  }
+}
+
+vk::CommandBuffer
+abcg::VulkanParallelRecorder::acquireCommandBuffer(std::size_t threadIndex) {
+  // Only the thread of the given index uses this pool
+  auto &pool{m_pools.at(m_frameIndex).at(threadIndex)};
+  if (pool.usedCommandBuffers == pool.commandBuffers.size()) {
+    pool.commandBuffers.push_back(
+        m_device
+            .allocateCommandBuffers(
+                {.commandPool = pool.commandPool,
+                 .level = vk::CommandBufferLevel::eSecondary,
+                 .commandBufferCount = 1})
+            .front());
+  }
+  return pool.commandBuffers.at(pool.usedCommandBuffers++);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file abcgVulkanParallelRecorder.hpp
+ * @brief Header file of abcg::VulkanParallelRecorder
+ *
+ * Declaration of abcg::VulkanParallelRecorder
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_PARALLEL_RECORDER_HPP_
+#define ABCG_VULKAN_PARALLEL_RECORDER_HPP_
+
+#include "abcgVulkanSwapchain.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace abcg {
+class VulkanParallelRecorder;
+} // namespace abcg
+
+/**
+ * @brief A class for recording the draw commands of a render pass on several
+ * threads.
+ *
+ * abcg::VulkanParallelRecorder::record splits a range of items (e.g., the
+ * objects of a scene) into contiguous chunks. Each chunk is recorded into a
+ * secondary command buffer by one of a set of persistent worker threads or by
+ * the calling thread, and the secondary command buffers are then executed by
+ * the primary command buffer of the frame in the order of the chunks.
+ *
+ * Each thread allocates its secondary command buffers from a command pool of
+ * its own, one per frame in flight. abcg::VulkanParallelRecorder::beginFrame
+ * resets the pools of the frame being recorded. This is safe because
+ * abcg::VulkanSwapchain::render waits for the fence of the frame before
+ * calling abcg::VulkanWindow::onPaint.
+ *
+ * Typical use in abcg::VulkanWindow::onPaint:
+ *
+ * @code
+ * m_recorder.beginFrame(frame);
+ * frame.commandBuffer.begin(
+ *     {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+ * frame.commandBuffer.beginRenderPass(
+ *     renderPassBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+ * m_recorder.record(
+ *     frame, getSwapchain().getMainRenderPass(), m_objects.size(),
+ *     [&](vk::CommandBuffer const &commandBuffer, std::size_t first,
+ *         std::size_t last) {
+ *       commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+ *                                  pipeline);
+ *       for (auto const index : iter::range(first, last)) {
+ *         m_objects.at(index).draw(commandBuffer);
+ *       }
+ *     });
+ * frame.commandBuffer.endRenderPass();
+ * frame.commandBuffer.end();
+ * @endcode
+ *
+ * The record function is called concurrently and must not modify shared
+ * state without synchronization. Dynamic state, such as the viewport, is not
+ * inherited from the primary command buffer and must be set in each chunk.
+ *
+ * @remark Objects of this type cannot be copied or copy-constructed.
+ */
+class abcg::VulkanParallelRecorder {
+public:
+  /**
+   * @brief Function that records the commands of the items in the range
+   * [`first`, `last`) into a secondary command buffer.
+   */
+  using RecordFunction = std::function<void(
+      vk::CommandBuffer const &commandBuffer, std::size_t first,
+      std::size_t last)>;
+
+  VulkanParallelRecorder() = default;
+  VulkanParallelRecorder(VulkanParallelRecorder const &) = delete;
+  VulkanParallelRecorder &operator=(VulkanParallelRecorder const &) = delete;
+  VulkanParallelRecorder(VulkanParallelRecorder &&) = delete;
+  VulkanParallelRecorder &operator=(VulkanParallelRecorder &&) = delete;
+  ~VulkanParallelRecorder();
+
+  void create(VulkanDevice const &device, std::size_t threadCount = 0);
+  void destroy();
+
+  void beginFrame(VulkanFrame const &frame);
+  void record(VulkanFrame const &frame, vk::RenderPass const &renderPass,
+              std::size_t itemCount, RecordFunction const &fun,
+              std::size_t minItemsPerChunk = 1);
+
+  [[nodiscard]] std::size_t getThreadCount() const noexcept;
+
+private:
+  // Command pool of a thread for a frame in flight
+  struct ThreadPool {
+    vk::CommandPool commandPool;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    std::size_t usedCommandBuffers{};
+  };
+
+  struct Chunk {
+    std::size_t first{};
+    std::size_t last{};
+    vk::CommandBuffer commandBuffer;
+    std::exception_ptr error;
+  };
+
+  void stopWorkers();
+  void workerLoop(std::size_t threadIndex, uint64_t generation);
+  void recordChunks(std::size_t threadIndex);
+  [[nodiscard]] vk::CommandBuffer
+  acquireCommandBuffer(std::size_t threadIndex);
+
+  vk::Device m_device;
+  uint32_t m_graphicsQueueFamily{};
+  std::size_t m_threadCount{};
+
+  // Pools indexed by frame in flight, then by thread
+  std::vector<std::vector<ThreadPool>> m_pools;
+  std::size_t m_frameIndex{};
+
+  // Job shared with the workers
+  std::vector<std::jthread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_jobStarted;
+  std::condition_variable m_jobFinished;
+  uint64_t m_jobGeneration{};
+  std::size_t m_busyWorkers{};
+  bool m_stopping{};
+  vk::CommandBufferInheritanceInfo m_inheritanceInfo;
+  RecordFunction const *m_fun{};
+  std::vector<Chunk> m_chunks;
+  std::atomic<std::size_t> m_nextChunk{};
+};
+
+#endif
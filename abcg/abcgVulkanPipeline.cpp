@@ -120,8 +120,12 @@ void abcg::VulkanPipeline::create(VulkanSwapchain const &swapchain,
       // .basePipelineIndex = -1
   };
 
-  auto result{m_device.createGraphicsPipeline(createInfo.pipelineCache,
-                                              pipelineCreateInfo)};
+  // Use the cache of the device unless the caller provides one
+  auto const pipelineCache{createInfo.pipelineCache
+                               ? createInfo.pipelineCache
+                               : swapchain.getDevice().getPipelineCache()};
+  auto result{
+      m_device.createGraphicsPipeline(pipelineCache, pipelineCreateInfo)};
   m_pipeline = result.value;
 }
 
@@ -0,0 +1,126 @@
+/**
+ * @file abcgVulkanPipelineCache.cpp
+ * @brief Definition of abcg::VulkanPipelineCache
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanPipelineCache.hpp"
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <vector>
+
+namespace {
+// Returns whether the data was created by the same driver and device
+[[nodiscard]] bool isCompatible(std::vector<char> const &data,
+                                vk::PhysicalDeviceProperties const &properties) {
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::ranges::equal(header.pipelineCacheUUID,
+                            properties.pipelineCacheUUID);
+}
+} // namespace
+
+/**
+ * @brief Creates the pipeline cache.
+ *
+ * @param physicalDevice Physical device the cache data must match.
+ * @param device Logical device.
+ * @param path Path of the cache file. If empty, the cache is not loaded from or
+ * saved to disk.
+ */
+void abcg::VulkanPipelineCache::create(vk::PhysicalDevice const &physicalDevice,
+                                       vk::Device const &device,
+                                       std::string_view path) {
+  m_device = device;
+  m_path = path;
+
+  std::vector<char> data;
+  if (!m_path.empty()) {
+    if (std::ifstream stream{m_path, std::ios::binary}; stream) {
+      data.assign(std::istreambuf_iterator<char>{stream},
+                  std::istreambuf_iterator<char>{});
+    }
+    // Data from another driver or device would be ignored or rejected anyway
+    if (!data.empty() && !isCompatible(data, physicalDevice.getProperties())) {
+      fmt::print("Discarding incompatible pipeline cache {}\n", m_path);
+      data.clear();
+    }
+  }
+
+  m_pipelineCache = m_device.createPipelineCache(
+      {.initialDataSize = data.size(), .pInitialData = data.data()});
+}
+
+/**
+ * @brief Writes the contents of the cache to the cache file.
+ *
+ * Does nothing if no path was given to abcg::VulkanPipelineCache::create.
+ * Failures are reported but not thrown, as the cache is only an optimization.
+ */
+void abcg::VulkanPipelineCache::save() const {
+  if (m_path.empty() || !m_pipelineCache) {
+    return;
+  }
+
+  auto const data{m_device.getPipelineCacheData(m_pipelineCache)};
+
+  // Write to a temporary file first so that a partially written cache is never
+  // loaded
+  std::filesystem::path const file{m_path};
+  auto temporaryFile{file};
+  temporaryFile += ".tmp";
+  std::error_code error;
+  if (file.has_parent_path()) {
+    std::filesystem::create_directories(file.parent_path(), error);
+  }
+  std::ofstream stream{temporaryFile, std::ios::binary};
+  stream.write(reinterpret_cast<char const *>(data.data()),
+               gsl::narrow<std::streamsize>(data.size()));
+  stream.close();
+  if (stream) {
+    std::filesystem::rename(temporaryFile, file, error);
+  }
+  if (!stream || error) {
+    std::filesystem::remove(temporaryFile, error);
+    fmt::print("Failed to write pipeline cache {}\n", m_path);
+  }
+}
+
+/**
+ * @brief Saves the cache to disk and destroys it.
+ */
+void abcg::VulkanPipelineCache::destroy() {
+  if (!m_device) {
+    return;
+  }
+  save();
+  m_device.destroyPipelineCache(m_pipelineCache);
+  m_pipelineCache = vk::PipelineCache{};
+}
+
+/**
+ * @brief Conversion to vk::PipelineCache.
+ */
+abcg::VulkanPipelineCache::operator vk::PipelineCache const &() const noexcept {
+  return m_pipelineCache;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file abcgVulkanPipelineCache.hpp
+ * @brief Header file of abcg::VulkanPipelineCache
+ *
+ * Declaration of abcg::VulkanPipelineCache.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_PIPELINE_CACHE_HPP_
+#define ABCG_VULKAN_PIPELINE_CACHE_HPP_
+
+#include <string>
+#include <string_view>
+
+#include "abcgVulkanExternal.hpp"
+
+namespace abcg {
+class VulkanPipelineCache;
+} // namespace abcg
+
+/**
+ * @brief A class for representing a Vulkan pipeline cache that persists
+ * between runs.
+ *
+ * The cache is created from the file given to
+ * abcg::VulkanPipelineCache::create, if the header of the file matches the
+ * vendor ID, device ID and pipeline cache UUID of the physical device.
+ * Otherwise, the cache starts empty. The contents of the cache are written back
+ * to the file by abcg::VulkanPipelineCache::destroy.
+ *
+ * Even without a file, the cache speeds up the creation of pipelines that are
+ * created again during the same run (e.g., after the swapchain is recreated).
+ */
+class abcg::VulkanPipelineCache {
+public:
+  void create(vk::PhysicalDevice const &physicalDevice, vk::Device const &device,
+              std::string_view path = {});
+  void save() const;
+  void destroy();
+
+  explicit operator vk::PipelineCache const &() const noexcept;
+
+private:
+  vk::PipelineCache m_pipelineCache;
+  vk::Device m_device;
+  std::string m_path;
+};
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * @file abcgVulkanRingBuffer.cpp
+ * @brief Definition of abcg::VulkanRingBuffer
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanRingBuffer.hpp"
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cstring>
+
+#include "abcgException.hpp"
+
+/**
+ * @brief Creates the buffer.
+ *
+ * @param device Vulkan device.
+ * @param frameSize Number of bytes available to each frame. Rounded up to the
+ * alignment of the slices.
+ * @param usage Usage of the buffer (e.g.,
+ * vk::BufferUsageFlagBits::eUniformBuffer or
+ * vk::BufferUsageFlagBits::eVertexBuffer).
+ * @param frameCount Number of segments. Use the number of frames in flight
+ * (see abcg::VulkanSettings::maxFramesInFlight).
+ */
+void abcg::VulkanRingBuffer::create(VulkanDevice const &device,
+                                    vk::DeviceSize frameSize,
+                                    vk::BufferUsageFlags usage,
+                                    std::size_t frameCount) {
+  destroy();
+
+  m_frameCount = std::max(frameCount, std::size_t{1});
+
+  // Slices must be usable as dynamic offsets of any kind of descriptor the
+  // buffer is used with
+  auto const &limits{
+      static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+          .getProperties()
+          .limits};
+  m_alignment = 16;
+  if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+    m_alignment = std::max(m_alignment, limits.minUniformBufferOffsetAlignment);
+  }
+  if (usage & vk::BufferUsageFlagBits::eStorageBuffer) {
+    m_alignment = std::max(m_alignment, limits.minStorageBufferOffsetAlignment);
+  }
+  m_frameSize = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+
+  // Host coherent, so that slices never need to be flushed
+  m_buffer.create(device,
+                  {.size = m_frameSize * m_frameCount,
+                   .usage = usage,
+                   .properties = vk::MemoryPropertyFlagBits::eHostVisible |
+                                 vk::MemoryPropertyFlagBits::eHostCoherent});
+
+  m_head = 0;
+  m_end = 0;
+}
+
+/**
+ * @brief Destroys the buffer.
+ */
+void abcg::VulkanRingBuffer::destroy() {
+  if (m_frameCount == 0) {
+    return;
+  }
+  m_buffer.destroy();
+  m_frameCount = 0;
+}
+
+/**
+ * @brief Selects the segment of a frame and discards its previous slices.
+ *
+ * Call this once per frame in abcg::VulkanWindow::onPaint, before the first
+ * call to abcg::VulkanRingBuffer::allocate.
+ *
+ * The buffer is never recreated here, since descriptors written with it would
+ * be left pointing to a destroyed buffer. If the number of frames in flight
+ * can grow, compare it with abcg::VulkanRingBuffer::getFrameCount beforehand,
+ * and recreate the buffer and its descriptors when needed.
+ *
+ * @param frame Frame being recorded.
+ *
+ * @throw abcg::RuntimeError if the index of the frame is not less than the
+ * number of segments.
+ */
+void abcg::VulkanRingBuffer::beginFrame(VulkanFrame const &frame) {
+  if (frame.index >= m_frameCount) {
+    throw abcg::RuntimeError(
+        fmt::format("Ring buffer has {} segments but frame index is {}",
+                    m_frameCount, frame.index));
+  }
+
+  m_head = m_frameSize * frame.index;
+  m_end = m_head + m_frameSize;
+}
+
+/**
+ * @brief Allocates a slice in the segment of the current frame.
+ *
+ * @param size Size of the slice in bytes.
+ *
+ * @throw abcg::RuntimeError if the segment is full.
+ *
+ * @return Slice of the buffer. Its contents can be written until the command
+ * buffer of the frame is submitted.
+ */
+abcg::VulkanRingSlice abcg::VulkanRingBuffer::allocate(vk::DeviceSize size) {
+  if (m_head + size > m_end) {
+    throw abcg::RuntimeError(fmt::format(
+        "Ring buffer frame size of {} bytes exceeded", m_frameSize));
+  }
+
+  VulkanRingSlice const slice{.buffer = static_cast<vk::Buffer>(m_buffer),
+                              .offset = gsl::narrow<uint32_t>(m_head),
+                              .size = size,
+                              .data = m_buffer.getMappedData() + m_head};
+  m_head = std::min(m_end, (m_head + size + m_alignment - 1) / m_alignment *
+                               m_alignment);
+  return slice;
+}
+
+/**
+ * @brief Copies data to a new slice.
+ *
+ * @param data Pointer to the data.
+ * @param size Size of the data in bytes.
+ *
+ * @return Slice containing the copy.
+ */
+abcg::VulkanRingSlice abcg::VulkanRingBuffer::push(void const *data,
+                                                   vk::DeviceSize size) {
+  auto const slice{allocate(size)};
+  std::memcpy(slice.data, data, gsl::narrow<std::size_t>(size));
+  return slice;
+}
+
+/**
+ * @brief Conversion to vk::Buffer.
+ */
+abcg::VulkanRingBuffer::operator vk::Buffer const &() const noexcept {
+  return static_cast<vk::Buffer const &>(m_buffer);
+}
+
+/**
+ * @brief Returns the number of bytes available to each frame.
+ *
+ * @return Size of a segment in bytes.
+ */
+vk::DeviceSize abcg::VulkanRingBuffer::getFrameSize() const noexcept {
+  return m_frameSize;
+}
+
+/**
+ * @brief Returns the number of segments.
+ *
+ * @return Number of frames that can be in flight, or 0 if the buffer was not
+ * created.
+ */
+std::size_t abcg::VulkanRingBuffer::getFrameCount() const noexcept {
+  return m_frameCount;
+}
+
+/**
+ * @brief Returns the alignment of the slices.
+ *
+ * @return Alignment in bytes.
+ */
+vk::DeviceSize abcg::VulkanRingBuffer::getAlignment() const noexcept {
+  return m_alignment;
+}
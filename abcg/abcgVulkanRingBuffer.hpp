@@ -0,0 +1,102 @@
+/**
+ * @file abcgVulkanRingBuffer.hpp
+ * @brief Header file of abcg::VulkanRingBuffer
+ *
+ * Declaration of abcg::VulkanRingBuffer
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_RING_BUFFER_HPP_
+#define ABCG_VULKAN_RING_BUFFER_HPP_
+
+#include "abcgVulkanBuffer.hpp"
+#include "abcgVulkanSwapchain.hpp"
+
+#include <cstddef>
+
+namespace abcg {
+struct VulkanRingSlice;
+class VulkanRingBuffer;
+} // namespace abcg
+
+/**
+ * @brief Slice of a abcg::VulkanRingBuffer, valid until the end of the frame.
+ */
+struct abcg::VulkanRingSlice {
+  /** @brief Buffer the slice belongs to. Same for all slices of a ring. */
+  vk::Buffer buffer;
+  /** @brief Offset of the slice in the buffer. Can be used as a dynamic
+   * offset in `vk::CommandBuffer::bindDescriptorSets`.
+   */
+  uint32_t offset{};
+  /** @brief Size of the slice in bytes. */
+  vk::DeviceSize size{};
+  /** @brief Pointer to the mapped memory of the slice. */
+  std::byte *data{};
+};
+
+/**
+ * @brief A class for streaming per-frame data (e.g., uniforms or instance
+ * data) through a persistently mapped buffer.
+ *
+ * The buffer is split into one segment per frame in flight.
+ * abcg::VulkanRingBuffer::beginFrame selects the segment of the frame being
+ * recorded. This is safe because abcg::VulkanSwapchain::render waits for the
+ * fence of the frame before calling abcg::VulkanWindow::onPaint, so the GPU
+ * is done with the previous contents of the segment. Slices returned by
+ * abcg::VulkanRingBuffer::allocate are aligned for use with dynamic uniform
+ * and storage buffer descriptors.
+ *
+ * Typical use in abcg::VulkanWindow::onPaint:
+ *
+ * @code
+ * m_ring.beginFrame(frame);
+ * auto const slice{m_ring.push(uniforms)};
+ * frame.commandBuffer.bindDescriptorSets(
+ *     vk::PipelineBindPoint::eGraphics, layout, 0, descriptorSet,
+ *     slice.offset);
+ * @endcode
+ */
+class abcg::VulkanRingBuffer {
+public:
+  void create(VulkanDevice const &device, vk::DeviceSize frameSize,
+              vk::BufferUsageFlags usage, std::size_t frameCount);
+  void destroy();
+
+  void beginFrame(VulkanFrame const &frame);
+  [[nodiscard]] VulkanRingSlice allocate(vk::DeviceSize size);
+  VulkanRingSlice push(void const *data, vk::DeviceSize size);
+
+  /**
+   * @brief Copies a value to a new slice.
+   *
+   * @param value Value to be copied.
+   *
+   * @return Slice containing the copy.
+   */
+  template <typename T> VulkanRingSlice push(T const &value) {
+    return push(&value, sizeof(T));
+  }
+
+  explicit operator vk::Buffer const &() const noexcept;
+
+  [[nodiscard]] vk::DeviceSize getFrameSize() const noexcept;
+  [[nodiscard]] std::size_t getFrameCount() const noexcept;
+  [[nodiscard]] vk::DeviceSize getAlignment() const noexcept;
+
+private:
+  VulkanBuffer m_buffer;
+  vk::DeviceSize m_frameSize{};
+  vk::DeviceSize m_alignment{1};
+  std::size_t m_frameCount{};
+
+  // Bounds of the segment of the current frame
+  vk::DeviceSize m_head{};
+  vk::DeviceSize m_end{};
+};
+
+#endif
@@ -10,16 +10,33 @@
 
 #include "abcgVulkanShader.hpp"
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
+#include "abcgUtil.hpp"
 
 #include <glslang/SPIRV/GlslangToSpv.h>
+#include <glslang/SPIRV/spirv.hpp>
 
+#include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
 
 namespace {
+// Directory of the SPIR-V cache. Empty if the cache is disabled
+std::string shaderCachePath;
+
 TBuiltInResource InitResources() {
   TBuiltInResource Resources{
       .maxLights = 32,
@@ -252,17 +269,97 @@ abcgStageToVulkanStage(abcg::ShaderStage stage) {
   }
   return source.str();
 }
+
+// Initializes glslang on first use. The process is finalized at exit
+void initializeGlslang() {
+  static std::once_flag initialized;
+  std::call_once(initialized, [] {
+    glslang::InitializeProcess();
+    std::atexit([] { glslang::FinalizeProcess(); });
+  });
+}
+
+[[nodiscard]] bool isSPIRVFile(std::string_view path) {
+  return path.ends_with(".spv") && std::filesystem::exists(path);
+}
+
+// Reads a SPIR-V binary. Returns an empty vector if the file cannot be read or
+// does not start with the SPIR-V magic number
+[[nodiscard]] std::vector<uint32_t>
+readSPIRV(std::filesystem::path const &path) {
+  std::ifstream stream{path, std::ios::binary};
+  if (!stream) {
+    return {};
+  }
+  std::vector<char> const bytes{std::istreambuf_iterator<char>{stream},
+                                std::istreambuf_iterator<char>{}};
+  if (bytes.size() < sizeof(uint32_t) || bytes.size() % sizeof(uint32_t) != 0) {
+    return {};
+  }
+
+  std::vector<uint32_t> code(bytes.size() / sizeof(uint32_t));
+  std::memcpy(code.data(), bytes.data(), bytes.size());
+  if (code.front() != spv::MagicNumber) {
+    return {};
+  }
+  return code;
+}
+
+// Writes a SPIR-V binary to the cache. Failures are not fatal since the shader
+// can always be compiled again
+void writeSPIRV(std::filesystem::path const &path,
+                std::vector<uint32_t> const &code) {
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  // The name of the temporary file is unique per thread, as the same shader
+  // may be compiled by several threads at once
+  auto temporaryFile{path};
+  temporaryFile += fmt::format(
+      ".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  std::ofstream stream{temporaryFile, std::ios::binary};
+  stream.write(reinterpret_cast<char const *>(code.data()),
+               gsl::narrow<std::streamsize>(code.size() * sizeof(uint32_t)));
+  stream.close();
+  if (stream) {
+    std::filesystem::rename(temporaryFile, path, error);
+  }
+  if (!stream || error) {
+    std::filesystem::remove(temporaryFile, error);
+    fmt::print("Failed to write shader cache file {}\n", path.string());
+  }
+}
+
+// Returns the cache file of the SPIR-V code of a GLSL source, or an empty path
+// if the cache is disabled. The key includes the compiler version, since the
+// generated code may change between versions of glslang
+[[nodiscard]] std::filesystem::path
+shaderCacheFile(abcg::ShaderSource const &source) {
+  if (shaderCachePath.empty()) {
+    return {};
+  }
+  auto const version{glslang::GetVersion()};
+  auto const hash{abcg::hashCombine(
+      source.source, static_cast<int>(source.stage), version.major,
+      version.minor, version.patch, std::string_view{version.flavor},
+      glslang::GetSpirvGeneratorVersion())};
+  return std::filesystem::path{shaderCachePath} /
+         fmt::format("{:016x}.spv", hash);
+}
 } // namespace
 
-// Compiles the given GLSL shader source into Vulkan SPIR-V.
-std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
-  // Prints out log info for compiling and linking
-  auto printLog{[](glslang::TShader &shader, std::string_view name) {
-    if (std::string const log{shader.getInfoLog()}; !log.empty()) {
-      fmt::print("Shader information log ({} shader):\n{}\n", name, log);
+// Compiles the given GLSL shader source into Vulkan SPIR-V. On failure, the
+// information logs are appended to log
+std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource const &shaderSource,
+                                std::string &log) {
+  // Collects log info for compiling and linking
+  auto appendLog{[&log](glslang::TShader &shader, std::string_view name) {
+    if (std::string const info{shader.getInfoLog()}; !info.empty()) {
+      log += fmt::format("Shader information log ({} shader):\n{}\n", name,
+                         info);
     }
-    if (std::string const log{shader.getInfoDebugLog()}; !log.empty()) {
-      fmt::print("Shader information debug log ({} shader):\n{}\n", name, log);
+    if (std::string const info{shader.getInfoDebugLog()}; !info.empty()) {
+      log += fmt::format("Shader information debug log ({} shader):\n{}\n",
+                         name, info);
     }
   }};
 
@@ -280,7 +377,7 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   TBuiltInResource const resources{InitResources()};
   if (!shader.parse(&resources, 100, false, messages)) {
     auto const *shaderStage{glslangStageToText(stage)};
-    printLog(shader, shaderStage);
+    appendLog(shader, shaderStage);
     throw abcg::RuntimeError(
         fmt::format("Failed to compile {} shader", shaderStage));
   }
@@ -290,7 +387,7 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   program.addShader(&shader);
   if (!program.link(messages)) {
     auto const *shaderStage{glslangStageToText(stage)};
-    printLog(shader, shaderStage);
+    appendLog(shader, shaderStage);
     throw abcg::RuntimeError(
         fmt::format("Failed to link {} shader", shaderStage));
   }
@@ -301,30 +398,176 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   return outCode;
 }
 
+namespace {
+// Returns the SPIR-V code of a shader, read from a .spv file or from the cache,
+// or compiled from its GLSL source. Compile logs are appended to log. Safe to
+// call from several threads at once
+[[nodiscard]] std::vector<uint32_t>
+toSPIRV(abcg::ShaderSource const &pathOrSource, std::string &log) {
+  ABCG_TRACE_ZONE("toSPIRV");
+
+  if (isSPIRVFile(pathOrSource.source)) {
+    auto code{readSPIRV(pathOrSource.source)};
+    if (code.empty()) {
+      throw abcg::RuntimeError(
+          fmt::format("Invalid SPIR-V file {}", pathOrSource.source));
+    }
+    return code;
+  }
+
+  abcg::ShaderSource const source{.source = toSource(pathOrSource.source),
+                                  .stage = pathOrSource.stage};
+
+  auto const cacheFile{shaderCacheFile(source)};
+  if (!cacheFile.empty()) {
+    if (auto code{readSPIRV(cacheFile)}; !code.empty()) {
+      return code;
+    }
+  }
+
+  initializeGlslang();
+  auto code{GLSLtoSPV(source, log)};
+  if (!cacheFile.empty()) {
+    writeSPIRV(cacheFile, code);
+  }
+  return code;
+}
+} // namespace
+
 /**
  * @brief Compiles a GLSL shader to SPIR-V and creates its module.
  *
+ * If `pathOrSource` is the path to a `.spv` file, the SPIR-V code is read
+ * from the file and no compilation is done.
+ *
+ * If the SPIR-V cache is enabled with abcg::setVulkanShaderCachePath, the code
+ * of a GLSL shader is looked up in the cache by a hash of its source, stage and
+ * glslang version, and is only compiled on a cache miss.
+ *
  * @param device Vulkan device to be used to create the shader module.
  * @param pathOrSource Path or source code of the GLSL shader to be compiled to
- * SPIR-V.
+ * SPIR-V, or path of a SPIR-V file.
  *
  * @throw abcg::RuntimeError if the shader could not be read from file or has
  * failed to compile.
+ *
+ * @sa abcg::createVulkanShaders for compiling several shaders in parallel.
  */
 void abcg::VulkanShader::create(VulkanDevice const &device,
                                 ShaderSource const &pathOrSource) {
-  m_device = static_cast<vk::Device>(device);
+  ABCG_TRACE_ZONE("VulkanShader::create");
 
-  ShaderSource const source{.source = toSource(pathOrSource.source),
-                            .stage = pathOrSource.stage};
+  std::string log;
+  std::vector<uint32_t> code;
+  try {
+    code = toSPIRV(pathOrSource, log);
+  } catch (...) {
+    fmt::print("{}", log);
+    throw;
+  }
 
-  glslang::InitializeProcess();
-  std::vector<uint32_t> shader{GLSLtoSPV(source)};
-  m_stage = abcgStageToVulkanStage(source.stage);
-  glslang::FinalizeProcess();
+  create(device, pathOrSource.stage, code);
+}
 
+/**
+ * @brief Creates the shader module from SPIR-V code.
+ *
+ * @param device Vulkan device to be used to create the shader module.
+ * @param stage Shader stage.
+ * @param code SPIR-V code.
+ */
+void abcg::VulkanShader::create(VulkanDevice const &device, ShaderStage stage,
+                                std::vector<uint32_t> const &code) {
+  m_device = static_cast<vk::Device>(device);
+  m_stage = abcgStageToVulkanStage(stage);
   m_module = m_device.createShaderModule(
-      {.codeSize = shader.size() * sizeof(uint32_t), .pCode = shader.data()});
+      {.codeSize = code.size() * sizeof(uint32_t), .pCode = code.data()});
+}
+
+/**
+ * @brief Compiles a group of GLSL shaders to SPIR-V in parallel and creates
+ * their modules.
+ *
+ * The shaders are distributed among up to `std::thread::hardware_concurrency`
+ * threads, including the calling thread, each with its own glslang objects.
+ * Shaders are read from `.spv` files or from the SPIR-V cache as in
+ * abcg::VulkanShader::create. The compile logs of all shaders are printed in
+ * input order after all threads finish.
+ *
+ * @param device Vulkan device to be used to create the shader modules.
+ * @param pathsOrSources Paths or source codes of the shaders.
+ *
+ * @throw abcg::RuntimeError if any shader could not be read from file or has
+ * failed to compile. No module is left created in this case.
+ *
+ * @return Shaders in the same order as `pathsOrSources`.
+ */
+std::vector<abcg::VulkanShader>
+abcg::createVulkanShaders(VulkanDevice const &device,
+                          std::vector<ShaderSource> const &pathsOrSources) {
+  ABCG_TRACE_ZONE("createVulkanShaders");
+
+  auto const count{pathsOrSources.size()};
+  std::vector<std::vector<uint32_t>> codes(count);
+  std::vector<std::string> logs(count);
+  std::vector<std::exception_ptr> errors(count);
+
+  // Each thread takes the next shader not yet taken until none is left
+  std::atomic<std::size_t> next{};
+  auto const compile{[&] {
+    for (auto index{next++}; index < count; index = next++) {
+      try {
+        codes.at(index) = toSPIRV(pathsOrSources.at(index), logs.at(index));
+      } catch (...) {
+        errors.at(index) = std::current_exception();
+      }
+    }
+  }};
+
+  auto const threadCount{std::min<std::size_t>(
+      count, std::max(1U, std::thread::hardware_concurrency()))};
+  {
+    std::vector<std::jthread> threads;
+    for ([[maybe_unused]] auto const index :
+         iter::range(std::size_t{1}, threadCount)) {
+      threads.emplace_back(compile);
+    }
+    compile();
+  }
+
+  std::size_t failures{};
+  std::exception_ptr firstError;
+  for (auto const index : iter::range(count)) {
+    fmt::print("{}", logs.at(index));
+    if (errors.at(index)) {
+      ++failures;
+      if (!firstError) {
+        firstError = errors.at(index);
+      }
+    }
+  }
+  if (failures == 1) {
+    std::rethrow_exception(firstError);
+  }
+  if (failures > 1) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to compile {} of {} shaders", failures, count));
+  }
+
+  std::vector<VulkanShader> shaders(count);
+  try {
+    for (auto const index : iter::range(count)) {
+      shaders.at(index).create(device, pathsOrSources.at(index).stage,
+                               codes.at(index));
+    }
+  } catch (...) {
+    // Do not leak the modules created so far
+    for (auto &shader : shaders) {
+      shader.destroy();
+    }
+    throw;
+  }
+  return shaders;
 }
 
 /**
@@ -354,4 +597,20 @@ vk::ShaderStageFlagBits const &abcg::VulkanShader::getStage() const noexcept {
  */
 vk::ShaderModule const &abcg::VulkanShader::getModule() const noexcept {
   return m_module;
+}
+
+/**
+ * @brief Sets the directory of the SPIR-V cache.
+ *
+ * The cache is used by abcg::VulkanShader::create to skip the compilation of
+ * GLSL shaders that were already compiled in a previous run. The directory is
+ * created when the first shader is stored.
+ *
+ * abcg::VulkanWindow calls this function with
+ * abcg::VulkanSettings::shaderCachePath before abcg::VulkanWindow::onCreate.
+ *
+ * @param path Path of the cache directory. An empty path disables the cache.
+ */
+void abcg::setVulkanShaderCachePath(std::string_view path) {
+  shaderCachePath = path;
 }
\ No newline at end of file
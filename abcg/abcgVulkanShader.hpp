@@ -14,19 +14,26 @@
 #include "abcgShader.hpp"
 #include "abcgVulkanDevice.hpp"
 
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
 namespace abcg {
 class VulkanShader;
+void setVulkanShaderCachePath(std::string_view path);
 } // namespace abcg
 
 /**
  * @brief A class for representing a Vulkan shader.
  *
- * This class compiles a GLSL shader into a Vulkan SPIR-V shader and creates the
- * corresponding vk::ShaderModule.
+ * This class compiles a GLSL shader into a Vulkan SPIR-V shader, or reads a
+ * precompiled `.spv` file, and creates the corresponding vk::ShaderModule.
  */
 class abcg::VulkanShader {
 public:
   void create(VulkanDevice const &device, ShaderSource const &pathOrSource);
+  void create(VulkanDevice const &device, ShaderStage stage,
+              std::vector<uint32_t> const &code);
   void destroy();
 
   [[nodiscard]] vk::ShaderStageFlagBits const &getStage() const noexcept;
@@ -38,4 +45,10 @@ private:
   vk::Device m_device;
 };
 
+namespace abcg {
+[[nodiscard]] std::vector<VulkanShader>
+createVulkanShaders(VulkanDevice const &device,
+                    std::vector<ShaderSource> const &pathsOrSources);
+} // namespace abcg
+
 #endif
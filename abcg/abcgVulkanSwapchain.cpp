@@ -10,10 +10,13 @@
 
 #include "abcgVulkanSwapchain.hpp"
 
-#include <functional>
+#include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 #include <imgui_impl_vulkan.h>
 
+#include <algorithm>
+#include <functional>
+
 #include "abcgException.hpp"
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
@@ -130,16 +133,25 @@ void abcg::VulkanSwapchain::render(
     std::function<void(VulkanFrame const &)> const &fun) {
   auto const &device{static_cast<vk::Device>(m_device)};
 
-  // Get current set of semaphores
+  auto &frame{m_frames.at(m_currentFrame)};
+
+  // Wait until the command buffers of this frame in flight have finished
+  // executing
+  while (vk::Result::eTimeout ==
+         device.waitForFences(frame.fence, VK_TRUE,
+                              std::numeric_limits<uint64_t>::max()))
+    ;
+
+  // Get semaphores of this frame in flight
   auto [presentCompleteSemaphore,
-        renderCompleteSemaphore]{m_frameSemaphores.at(m_currentSemaphore)};
+        renderCompleteSemaphore]{m_frameSemaphores.at(m_currentFrame)};
 
   // Acquire an image from the swapchain
   vk::Result result{};
   try {
     result = device.acquireNextImageKHR(
         m_swapchainKHR, std::numeric_limits<uint64_t>::max(),
-        presentCompleteSemaphore, vk::Fence{}, &m_currentFrame);
+        presentCompleteSemaphore, vk::Fence{}, &m_currentImage);
   } catch (vk::OutOfDateKHRError const &) {
     result = vk::Result::eErrorOutOfDateKHR;
   }
@@ -149,16 +161,24 @@ void abcg::VulkanSwapchain::render(
     return;
   }
 
-  auto const &frame{m_frames.at(m_currentFrame)};
+  // Wait until the image is no longer used by another frame in flight. This
+  // happens when there are more frames in flight than swapchain images
+  auto &image{m_images.at(m_currentImage)};
+  if (image.fence && image.fence != frame.fence) {
+    while (vk::Result::eTimeout ==
+           device.waitForFences(image.fence, VK_TRUE,
+                                std::numeric_limits<uint64_t>::max()))
+      ;
+  }
+  image.fence = frame.fence;
 
-  // Wait until command buffer for acquired image has finished executing
-  while (vk::Result::eTimeout ==
-         device.waitForFences(frame.fence, VK_TRUE,
-                              std::numeric_limits<uint64_t>::max()))
-    ;
   device.resetFences(frame.fence);
   device.resetCommandPool(frame.commandPool);
 
+  frame.imageIndex = m_currentImage;
+  frame.colorImage = image.colorImage;
+  frame.framebufferMain = image.framebufferMain;
+
   // Main pass
   fun(frame);
 
@@ -206,7 +226,7 @@ void abcg::VulkanSwapchain::present() {
     return;
 
   // Set semaphores to wait
-  auto &frameSemaphore{m_frameSemaphores.at(m_currentSemaphore)};
+  auto &frameSemaphore{m_frameSemaphores.at(m_currentFrame)};
   std::array waitSemaphores{frameSemaphore.renderComplete};
 
   // Set swapchains
@@ -219,7 +239,7 @@ void abcg::VulkanSwapchain::present() {
         .pWaitSemaphores = waitSemaphores.data(),
         .swapchainCount = gsl::narrow<uint32_t>(swapchains.size()),
         .pSwapchains = swapchains.data(),
-        .pImageIndices = &m_currentFrame // Index of in-flight frame
+        .pImageIndices = &m_currentImage
     });
   } catch (vk::OutOfDateKHRError const &) {
     result = vk::Result::eErrorOutOfDateKHR;
@@ -230,9 +250,9 @@ void abcg::VulkanSwapchain::present() {
     return;
   }
 
-  // Use the next set of semaphores
-  m_currentSemaphore =
-      (m_currentSemaphore + 1) % gsl::narrow<uint32_t>(m_frames.size());
+  // Use the next frame in flight
+  m_currentFrame =
+      (m_currentFrame + 1) % gsl::narrow<uint32_t>(m_frames.size());
 }
 
 bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
@@ -354,7 +374,7 @@ bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
 
   createRenderPasses(settings);
 
-  createFrames();
+  createFrames(settings);
 
   if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
     createDepthResources(settings);
@@ -445,29 +465,69 @@ abcg::VulkanImage const &abcg::VulkanSwapchain::getDepthImage() const noexcept {
   return m_depthImage;
 }
 
-void abcg::VulkanSwapchain::createFrames() {
-  auto const swapchainImages{
-      static_cast<vk::Device>(m_device).getSwapchainImagesKHR(m_swapchainKHR)};
+void abcg::VulkanSwapchain::createFrames(VulkanSettings const &settings) {
+  auto const &device{static_cast<vk::Device>(m_device)};
+  auto const swapchainImages{device.getSwapchainImagesKHR(m_swapchainKHR)};
 
   // Create image views
-  m_currentFrame = 0;
-  m_frames.resize(swapchainImages.size());
-  m_currentSemaphore = 0;
-  m_frameSemaphores.resize(swapchainImages.size());
-
-  for (auto &&[frame, image, index] :
-       iter::zip(m_frames, swapchainImages, iter::range(m_frames.size()))) {
-    frame.index = gsl::narrow<uint32_t>(index);
-    frame.colorImage.create(
+  m_currentImage = 0;
+  m_images.resize(swapchainImages.size());
+  for (auto &&[image, swapchainImage] : iter::zip(m_images, swapchainImages)) {
+    image.colorImage.create(
         m_device,
         {.viewInfo = {
-             .image = image,
+             .image = swapchainImage,
              .viewType = vk::ImageViewType::e2D,
              .format = m_swapchainImageFormat,
              .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
                                   .levelCount = 1,
                                   .layerCount = 1}}});
   }
+
+  auto const &queuesFamilies{m_device.getPhysicalDevice().getQueuesFamilies()};
+  if (!queuesFamilies.graphics.has_value()) {
+    throw abcg::RuntimeError("Graphics queue family not found");
+  }
+  auto const graphicsQueueFamily{queuesFamilies.graphics.value()};
+
+  // Create the resources of each frame in flight
+  m_currentFrame = 0;
+  m_frames.resize(gsl::narrow<std::size_t>(
+      std::max(settings.maxFramesInFlight, 1)));
+  m_frameSemaphores.resize(m_frames.size());
+  for (auto &&[frame, frameSemaphore, index] :
+       iter::zip(m_frames, m_frameSemaphores, iter::range(m_frames.size()))) {
+    frame.index = gsl::narrow<uint32_t>(index);
+
+    // Each frame has its own transient graphics command pool
+    frame.commandPool = device.createCommandPool(
+        {.flags = vk::CommandPoolCreateFlagBits::eTransient,
+         .queueFamilyIndex = graphicsQueueFamily});
+
+    // Create a primary command buffer
+    frame.commandBuffer =
+        device
+            .allocateCommandBuffers({.commandPool = frame.commandPool,
+                                     .level = vk::CommandBufferLevel::ePrimary,
+                                     .commandBufferCount = 1})
+            .front();
+
+    // Create a primary command buffer for the UI
+    frame.commandBufferUI =
+        device
+            .allocateCommandBuffers({.commandPool = frame.commandPool,
+                                     .level = vk::CommandBufferLevel::ePrimary,
+                                     .commandBufferCount = 1})
+            .front();
+
+    // Create fence
+    frame.fence =
+        device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
+
+    // Create semaphores
+    frameSemaphore.presentComplete = device.createSemaphore({});
+    frameSemaphore.renderComplete = device.createSemaphore({});
+  }
 }
 
 void abcg::VulkanSwapchain::destroyFrames() {
@@ -476,8 +536,6 @@ void abcg::VulkanSwapchain::destroyFrames() {
   for (auto &frame : m_frames) {
     device.destroyCommandPool(frame.commandPool);
     device.destroyFence(frame.fence);
-    frame.colorImage.destroy();
-    device.destroyFramebuffer(frame.framebufferMain);
   }
 
   for (auto &frameSemaphore : m_frameSemaphores) {
@@ -485,8 +543,14 @@ void abcg::VulkanSwapchain::destroyFrames() {
     device.destroySemaphore(frameSemaphore.renderComplete);
   }
 
+  for (auto &image : m_images) {
+    image.colorImage.destroy();
+    device.destroyFramebuffer(image.framebufferMain);
+  }
+
   m_frames.clear();
   m_frameSemaphores.clear();
+  m_images.clear();
 }
 
 // TODO:
@@ -785,40 +849,9 @@ void abcg::VulkanSwapchain::destroyRenderPasses() {
 
 void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
   auto const &device{static_cast<vk::Device>(m_device)};
-  auto const &queuesFamilies{m_device.getPhysicalDevice().getQueuesFamilies()};
   auto const sampleCount{m_device.getPhysicalDevice().getSampleCount()};
 
-  if (!queuesFamilies.graphics.has_value()) {
-    throw abcg::RuntimeError("Graphics queue family not found");
-  }
-  auto const graphicsQueueFamily{queuesFamilies.graphics.value()};
-
-  for (auto &frame : m_frames) {
-    // Each frame has its own transient graphics command pool
-    frame.commandPool = device.createCommandPool(
-        {.flags = vk::CommandPoolCreateFlagBits::eTransient,
-         .queueFamilyIndex = graphicsQueueFamily});
-
-    // Create a primary command buffer
-    frame.commandBuffer =
-        device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
-                                     .level = vk::CommandBufferLevel::ePrimary,
-                                     .commandBufferCount = 1})
-            .front();
-
-    // Create a primary command buffer for the UI
-    frame.commandBufferUI =
-        device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
-                                     .level = vk::CommandBufferLevel::ePrimary,
-                                     .commandBufferCount = 1})
-            .front();
-
-    // Create fence
-    frame.fence =
-        device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
-
+  for (auto &image : m_images) {
     // Set attachments
     std::vector<vk::ImageView> attachments{};
     if (sampleCount > vk::SampleCountFlagBits::e1) {
@@ -829,18 +862,18 @@ void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
       if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
         attachments.push_back(m_depthImage.getView());
       }
-      attachments.push_back(frame.colorImage.getView());
+      attachments.push_back(image.colorImage.getView());
     } else {
       // 0: Color buffer
       // 1: Depth buffer (optional)
-      attachments.push_back(frame.colorImage.getView());
+      attachments.push_back(image.colorImage.getView());
       if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
         attachments.push_back(m_depthImage.getView());
       }
     }
 
     // Create framebuffers
-    frame.framebufferMain = device.createFramebuffer(
+    image.framebufferMain = device.createFramebuffer(
         {.renderPass = m_renderPassMain,
          .attachmentCount = gsl::narrow<uint32_t>(attachments.size()),
          .pAttachments = attachments.data(),
@@ -848,10 +881,4 @@ void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
          .height = m_swapchainExtent.height,
          .layers = 1});
   }
-
-  // Create semaphores
-  for (auto &frameSemaphore : m_frameSemaphores) {
-    frameSemaphore.presentComplete = device.createSemaphore({});
-    frameSemaphore.renderComplete = device.createSemaphore({});
-  }
 }
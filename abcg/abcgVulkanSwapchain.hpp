@@ -30,9 +30,17 @@ class VulkanWindow;
 /**
  * @brief Data needed by a rendering frame.
  *
+ * The command pool, command buffers and fence belong to the frame in flight.
+ * The color image and framebuffer belong to the swapchain image acquired for
+ * the frame.
  */
 struct abcg::VulkanFrame {
+  /** @brief Index of the frame in flight, from 0 to
+   * abcg::VulkanSettings::maxFramesInFlight - 1.
+   */
   uint32_t index{};
+  /** @brief Index of the swapchain image acquired for the frame. */
+  uint32_t imageIndex{};
   vk::CommandPool commandPool;
   vk::CommandBuffer commandBuffer;
   vk::CommandBuffer commandBufferUI;
@@ -68,7 +76,7 @@ public:
   [[nodiscard]] VulkanImage const &getDepthImage() const noexcept;
 
 private:
-  void createFrames();
+  void createFrames(VulkanSettings const &settings);
   void destroyFrames();
 
   [[nodiscard]] vk::Format getDepthFormat(VulkanSettings const &settings);
@@ -96,13 +104,22 @@ private:
     vk::Semaphore renderComplete;
   };
 
+  // Data of each swapchain image
+  struct SwapchainImage {
+    VulkanImage colorImage;
+    vk::Framebuffer framebufferMain;
+    // Fence of the frame in flight that last rendered to the image
+    vk::Fence fence;
+  };
+
+  // Frames in flight and their semaphores
   uint32_t m_currentFrame{};
   std::vector<VulkanFrame> m_frames;
-  // Current set of swapchain wait semaphores we're using (needs to be distinct
-  // from per frame data)
-  uint32_t m_currentSemaphore{};
   std::vector<FrameSemaphores> m_frameSemaphores;
 
+  uint32_t m_currentImage{};
+  std::vector<SwapchainImage> m_images;
+
   VulkanImage m_depthImage;
   VulkanImage m_MSAAImage;
 
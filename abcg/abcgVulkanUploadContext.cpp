@@ -0,0 +1,527 @@
+/**
+ * @file abcgVulkanUploadContext.cpp
+ * @brief Definition of abcg::VulkanUploadContext
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanUploadContext.hpp"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+// Staging blocks kept for reuse. Larger blocks are allocated for uploads that
+// do not fit a regular block, but are released as soon as they are consumed
+constexpr std::size_t maxFreeStagingBlocks{4};
+
+// Buffer to image copies need offsets that are multiples of 4 and of the
+// texel block size. This covers the block sizes that are powers of two up to
+// 16 bytes. Other sizes (e.g., 12-byte RGB32F texels) must be passed to
+// abcg::VulkanUploadContext::stage
+constexpr vk::DeviceSize minStagingAlignment{16};
+
+void recordBarrier(vk::CommandBuffer const &commandBuffer,
+                   vk::PipelineStageFlags srcStageMask,
+                   vk::PipelineStageFlags dstStageMask,
+                   vk::ImageMemoryBarrier const &barrier) {
+  commandBuffer.pipelineBarrier(srcStageMask, dstStageMask,
+                                vk::DependencyFlags{}, {}, {}, barrier);
+}
+
+void recordBarrier(vk::CommandBuffer const &commandBuffer,
+                   vk::PipelineStageFlags srcStageMask,
+                   vk::PipelineStageFlags dstStageMask,
+                   vk::BufferMemoryBarrier const &barrier) {
+  commandBuffer.pipelineBarrier(srcStageMask, dstStageMask,
+                                vk::DependencyFlags{}, {}, barrier, {});
+}
+} // namespace
+
+/**
+ * @brief Creates the upload context.
+ *
+ * @param device Vulkan device. The device must outlive the context.
+ * @param stagingBlockSize Size in bytes of each block of staging memory.
+ * Uploads larger than this get a block of their own.
+ */
+void abcg::VulkanUploadContext::create(VulkanDevice const &device,
+                                       vk::DeviceSize stagingBlockSize) {
+  destroy();
+
+  m_device = static_cast<vk::Device>(device);
+  m_physicalDevice = &device.getPhysicalDevice();
+  m_stagingBlockSize = stagingBlockSize;
+
+  auto const &queuesFamilies{m_physicalDevice->getQueuesFamilies()};
+  auto const &queues{device.getQueues()};
+  auto const &commandPools{device.getCommandPools()};
+
+  m_graphicsQueueFamily = queuesFamilies.graphics.value_or(0);
+  m_graphicsQueue = queues.graphics;
+  m_graphicsPool = commandPools.graphics;
+
+  // Fall back to the graphics queue if there is no transfer queue
+  if (queuesFamilies.transfer.has_value() && queues.transfer) {
+    m_transferQueueFamily = queuesFamilies.transfer.value();
+    m_transferQueue = queues.transfer;
+    m_transferPool = commandPools.transfer;
+  } else {
+    m_transferQueueFamily = m_graphicsQueueFamily;
+    m_transferQueue = m_graphicsQueue;
+    m_transferPool = m_graphicsPool;
+  }
+
+  m_stagingAlignment = std::max(
+      minStagingAlignment,
+      static_cast<vk::PhysicalDevice>(*m_physicalDevice)
+          .getProperties()
+          .limits.optimalBufferCopyOffsetAlignment);
+}
+
+/**
+ * @brief Waits for the submitted batches and releases all resources.
+ *
+ * Commands recorded but not submitted are discarded.
+ */
+void abcg::VulkanUploadContext::destroy() {
+  if (!m_device) {
+    return;
+  }
+
+  waitAll();
+
+  // Discard the batch being recorded
+  for (auto const &block : m_recording.stagingBlocks) {
+    destroyStagingBlock(block);
+  }
+  if (m_recording.transfer) {
+    m_device.freeCommandBuffers(m_transferPool, m_recording.transfer);
+  }
+  if (m_recording.graphics) {
+    m_device.freeCommandBuffers(m_graphicsPool, m_recording.graphics);
+  }
+  m_recording = {};
+
+  for (auto const &block : m_freeStagingBlocks) {
+    destroyStagingBlock(block);
+  }
+  m_freeStagingBlocks.clear();
+  for (auto const &fence : m_freeFences) {
+    m_device.destroyFence(fence);
+  }
+  m_freeFences.clear();
+  for (auto const &semaphore : m_freeSemaphores) {
+    m_device.destroySemaphore(semaphore);
+  }
+  m_freeSemaphores.clear();
+
+  m_device = vk::Device{};
+}
+
+/**
+ * @brief Copies data to staging memory.
+ *
+ * The memory is kept until the batch that is being recorded is complete, so
+ * the returned region can be used as the source of transfer commands recorded
+ * in the same batch.
+ *
+ * @param data Pointer to the data.
+ * @param size Size of the data in bytes.
+ * @param alignment Alignment of the offset in bytes, in addition to the
+ * alignment required by the device for buffer copies. Use the texel block
+ * size when copying to an image of a format whose block size is not a power
+ * of two.
+ *
+ * @return Staging buffer and offset of the copy.
+ */
+abcg::VulkanStagingAllocation
+abcg::VulkanUploadContext::stage(void const *data, vk::DeviceSize size,
+                                 vk::DeviceSize alignment) {
+  auto &blocks{m_recording.stagingBlocks};
+
+  auto offset{vk::DeviceSize{}};
+  if (!blocks.empty()) {
+    auto const &block{blocks.back()};
+    auto const offsetAlignment{
+        std::lcm(m_stagingAlignment, std::max<vk::DeviceSize>(alignment, 1))};
+    offset = (block.used + offsetAlignment - 1) / offsetAlignment *
+             offsetAlignment;
+  }
+  if (blocks.empty() || offset + size > blocks.back().size) {
+    blocks.push_back(acquireStagingBlock(size));
+    offset = 0;
+  }
+
+  auto &block{blocks.back()};
+  std::memcpy(block.mapped + offset, data, gsl::narrow<std::size_t>(size));
+  block.used = offset + size;
+
+  return {.buffer = block.buffer, .offset = offset};
+}
+
+/**
+ * @brief Records commands into the transfer command buffer of the batch being
+ * recorded.
+ *
+ * @param fun Function called with the command buffer.
+ */
+void abcg::VulkanUploadContext::record(RecordFunction const &fun) {
+  if (!m_recording.transfer) {
+    m_recording.transfer = beginCommandBuffer(m_transferPool);
+  }
+  fun(m_recording.transfer);
+}
+
+/**
+ * @brief Records commands that require a graphics queue (e.g., blits).
+ *
+ * The commands are executed after the transfer commands of the same batch. If
+ * the transfer queue and the graphics queue are from the same family, this is
+ * the same as abcg::VulkanUploadContext::record.
+ *
+ * @param fun Function called with the command buffer.
+ */
+void abcg::VulkanUploadContext::recordOnGraphicsQueue(
+    RecordFunction const &fun) {
+  if (!hasSeparateTransferQueue()) {
+    record(fun);
+    return;
+  }
+  if (!m_recording.graphics) {
+    m_recording.graphics = beginCommandBuffer(m_graphicsPool);
+  }
+  fun(m_recording.graphics);
+}
+
+/**
+ * @brief Records an image barrier that hands the image over from the transfer
+ * queue to the graphics queue.
+ *
+ * With a separate transfer queue, this records the release barrier into the
+ * transfer command buffer and the acquire barrier into the graphics command
+ * buffer. Otherwise, the barrier is recorded as is.
+ *
+ * @param barrier Image barrier. The queue family indices are ignored.
+ * @param srcStageMask Stages of the transfer commands that the barrier waits
+ * for.
+ * @param dstStageMask Stages of the graphics commands that wait for the
+ * barrier.
+ */
+void abcg::VulkanUploadContext::transferOwnership(
+    vk::ImageMemoryBarrier barrier, vk::PipelineStageFlags srcStageMask,
+    vk::PipelineStageFlags dstStageMask) {
+  recordOwnershipTransfer(barrier, srcStageMask, dstStageMask);
+}
+
+/**
+ * @brief Records a buffer barrier that hands the buffer over from the
+ * transfer queue to the graphics queue.
+ *
+ * Buffers written by transfer commands must be handed over this way before
+ * being used by the graphics queue, as they are created with exclusive
+ * sharing.
+ *
+ * @param barrier Buffer barrier. The queue family indices are ignored.
+ * @param srcStageMask Stages of the transfer commands that the barrier waits
+ * for.
+ * @param dstStageMask Stages of the graphics commands that wait for the
+ * barrier.
+ */
+void abcg::VulkanUploadContext::transferOwnership(
+    vk::BufferMemoryBarrier barrier, vk::PipelineStageFlags srcStageMask,
+    vk::PipelineStageFlags dstStageMask) {
+  recordOwnershipTransfer(barrier, srcStageMask, dstStageMask);
+}
+
+template <typename Barrier>
+void abcg::VulkanUploadContext::recordOwnershipTransfer(
+    Barrier barrier, vk::PipelineStageFlags srcStageMask,
+    vk::PipelineStageFlags dstStageMask) {
+  if (!hasSeparateTransferQueue()) {
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    record([&](vk::CommandBuffer const &commandBuffer) {
+      recordBarrier(commandBuffer, srcStageMask, dstStageMask, barrier);
+    });
+    return;
+  }
+
+  barrier.srcQueueFamilyIndex = m_transferQueueFamily;
+  barrier.dstQueueFamilyIndex = m_graphicsQueueFamily;
+
+  auto release{barrier};
+  release.dstAccessMask = vk::AccessFlags{};
+  record([&](vk::CommandBuffer const &commandBuffer) {
+    recordBarrier(commandBuffer, srcStageMask,
+                  vk::PipelineStageFlagBits::eBottomOfPipe, release);
+  });
+
+  auto acquire{barrier};
+  acquire.srcAccessMask = vk::AccessFlags{};
+  recordOnGraphicsQueue([&](vk::CommandBuffer const &commandBuffer) {
+    recordBarrier(commandBuffer, vk::PipelineStageFlagBits::eTopOfPipe,
+                  dstStageMask, acquire);
+  });
+}
+
+/**
+ * @brief Submits the batch being recorded.
+ *
+ * This function does not wait for the GPU. Resources written by the batch must
+ * not be used before the ticket is complete.
+ *
+ * @return Ticket of the batch, or a default-constructed ticket if nothing was
+ * recorded.
+ */
+abcg::VulkanUploadTicket abcg::VulkanUploadContext::submit() {
+  ABCG_TRACE_ZONE("VulkanUploadContext::submit");
+
+  if (!m_recording.transfer && !m_recording.graphics) {
+    // Blocks staged without commands are not read by the GPU
+    for (auto &block : m_recording.stagingBlocks) {
+      releaseStagingBlock(block);
+    }
+    m_recording.stagingBlocks.clear();
+    return {};
+  }
+
+  auto batch{std::move(m_recording)};
+  m_recording = {};
+  batch.ticket = m_nextTicket++;
+
+  if (m_freeFences.empty()) {
+    batch.fence = m_device.createFence({});
+  } else {
+    batch.fence = m_freeFences.back();
+    m_freeFences.pop_back();
+  }
+
+  if (batch.transfer) {
+    batch.transfer.end();
+  }
+  if (batch.graphics) {
+    batch.graphics.end();
+  }
+
+  if (batch.transfer && batch.graphics) {
+    // The graphics commands wait for the transfer commands
+    if (m_freeSemaphores.empty()) {
+      batch.semaphore = m_device.createSemaphore({});
+    } else {
+      batch.semaphore = m_freeSemaphores.back();
+      m_freeSemaphores.pop_back();
+    }
+    m_transferQueue.submit({{.commandBufferCount = 1,
+                             .pCommandBuffers = &batch.transfer,
+                             .signalSemaphoreCount = 1,
+                             .pSignalSemaphores = &batch.semaphore}},
+                           vk::Fence{});
+
+    vk::PipelineStageFlags const waitStage{
+        vk::PipelineStageFlagBits::eAllCommands};
+    m_graphicsQueue.submit({{.waitSemaphoreCount = 1,
+                             .pWaitSemaphores = &batch.semaphore,
+                             .pWaitDstStageMask = &waitStage,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &batch.graphics}},
+                           batch.fence);
+  } else if (batch.transfer) {
+    m_transferQueue.submit(
+        {{.commandBufferCount = 1, .pCommandBuffers = &batch.transfer}},
+        batch.fence);
+  } else {
+    m_graphicsQueue.submit(
+        {{.commandBufferCount = 1, .pCommandBuffers = &batch.graphics}},
+        batch.fence);
+  }
+
+  VulkanUploadTicket const ticket{batch.ticket};
+  m_pending.push_back(std::move(batch));
+  return ticket;
+}
+
+/**
+ * @brief Returns whether the batch of a ticket is complete, without waiting.
+ *
+ * Completed batches are recycled as a side effect.
+ *
+ * @param ticket Ticket returned by abcg::VulkanUploadContext::submit.
+ *
+ * @return True if the GPU has executed the batch.
+ */
+bool abcg::VulkanUploadContext::isComplete(VulkanUploadTicket ticket) {
+  if (ticket.value > m_completedTicket) {
+    collect();
+  }
+  return ticket.value <= m_completedTicket;
+}
+
+/**
+ * @brief Waits until the batch of a ticket is complete.
+ *
+ * Batches submitted before the ticket are waited on as well.
+ *
+ * @param ticket Ticket returned by abcg::VulkanUploadContext::submit.
+ */
+void abcg::VulkanUploadContext::wait(VulkanUploadTicket ticket) {
+  if (ticket.value <= m_completedTicket) {
+    return;
+  }
+  if (ticket.value >= m_nextTicket) {
+    throw abcg::RuntimeError("Invalid upload ticket");
+  }
+
+  ABCG_TRACE_ZONE("VulkanUploadContext::wait");
+
+  std::vector<vk::Fence> fences;
+  for (auto const &batch : m_pending) {
+    if (batch.ticket > ticket.value) {
+      break;
+    }
+    fences.push_back(batch.fence);
+  }
+  if (!fences.empty()) {
+    auto const result{m_device.waitForFences(
+        fences, VK_TRUE, std::numeric_limits<uint64_t>::max())};
+    if (result != vk::Result::eSuccess) {
+      throw abcg::RuntimeError("Failed to wait for upload batch");
+    }
+  }
+  collect();
+}
+
+/**
+ * @brief Waits until all submitted batches are complete.
+ */
+void abcg::VulkanUploadContext::waitAll() {
+  if (!m_pending.empty()) {
+    wait({m_pending.back().ticket});
+  }
+}
+
+/**
+ * @brief Recycles the command buffers and staging memory of the completed
+ * batches.
+ *
+ * This is called by abcg::VulkanUploadContext::isComplete and
+ * abcg::VulkanUploadContext::wait, but can also be called once per frame to
+ * release memory early.
+ */
+void abcg::VulkanUploadContext::collect() {
+  while (!m_pending.empty() &&
+         m_device.getFenceStatus(m_pending.front().fence) ==
+             vk::Result::eSuccess) {
+    auto &batch{m_pending.front()};
+    m_completedTicket = batch.ticket;
+    releaseBatch(batch);
+    m_pending.pop_front();
+  }
+}
+
+/**
+ * @brief Returns whether transfers and graphics commands run on queues of
+ * different families.
+ *
+ * @return True if there is a transfer queue separate from the graphics queue.
+ */
+bool abcg::VulkanUploadContext::hasSeparateTransferQueue() const noexcept {
+  return m_transferQueueFamily != m_graphicsQueueFamily;
+}
+
+abcg::VulkanUploadContext::StagingBlock
+abcg::VulkanUploadContext::acquireStagingBlock(vk::DeviceSize size) {
+  if (auto iter{std::ranges::find_if(
+          m_freeStagingBlocks,
+          [size](auto const &block) { return block.size >= size; })};
+      iter != m_freeStagingBlocks.end()) {
+    auto block{*iter};
+    m_freeStagingBlocks.erase(iter);
+    return block;
+  }
+
+  StagingBlock block{.size = std::max(size, m_stagingBlockSize)};
+  block.buffer =
+      m_device.createBuffer({.size = block.size,
+                             .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                             .sharingMode = vk::SharingMode::eExclusive});
+
+  auto const memoryRequirements{
+      m_device.getBufferMemoryRequirements(block.buffer)};
+  auto const memoryType{m_physicalDevice->findMemoryType(
+      memoryRequirements.memoryTypeBits,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent)};
+  if (!memoryType.has_value()) {
+    m_device.destroyBuffer(block.buffer);
+    throw abcg::RuntimeError("Failed to find suitable memory type");
+  }
+  block.memory =
+      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
+                               .memoryTypeIndex = memoryType.value()});
+  m_device.bindBufferMemory(block.buffer, block.memory, 0);
+
+  // Kept mapped until the block is destroyed
+  block.mapped = static_cast<std::byte *>(
+      m_device.mapMemory(block.memory, 0, VK_WHOLE_SIZE));
+
+  return block;
+}
+
+void abcg::VulkanUploadContext::releaseStagingBlock(StagingBlock block) {
+  if (block.size > m_stagingBlockSize ||
+      m_freeStagingBlocks.size() >= maxFreeStagingBlocks) {
+    destroyStagingBlock(block);
+    return;
+  }
+  block.used = 0;
+  m_freeStagingBlocks.push_back(block);
+}
+
+void abcg::VulkanUploadContext::destroyStagingBlock(
+    StagingBlock const &block) const {
+  m_device.unmapMemory(block.memory);
+  m_device.destroyBuffer(block.buffer);
+  m_device.freeMemory(block.memory);
+}
+
+vk::CommandBuffer
+abcg::VulkanUploadContext::beginCommandBuffer(vk::CommandPool pool) {
+  auto commandBuffer{
+      m_device
+          .allocateCommandBuffers({.commandPool = pool,
+                                   .level = vk::CommandBufferLevel::ePrimary,
+                                   .commandBufferCount = 1})
+          .front()};
+  commandBuffer.begin(
+      {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  return commandBuffer;
+}
+
+void abcg::VulkanUploadContext::releaseBatch(Batch &batch) {
+  if (batch.transfer) {
+    m_device.freeCommandBuffers(m_transferPool, batch.transfer);
+  }
+  if (batch.graphics) {
+    m_device.freeCommandBuffers(m_graphicsPool, batch.graphics);
+  }
+  m_device.resetFences(batch.fence);
+  m_freeFences.push_back(batch.fence);
+  if (batch.semaphore) {
+    m_freeSemaphores.push_back(batch.semaphore);
+  }
+  for (auto &block : batch.stagingBlocks) {
+    releaseStagingBlock(block);
+  }
+  batch.stagingBlocks.clear();
+}
@@ -0,0 +1,147 @@
+/**
+ * @file abcgVulkanUploadContext.hpp
+ * @brief Header file of abcg::VulkanUploadContext
+ *
+ * Declaration of abcg::VulkanUploadContext
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+#define ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+
+#include "abcgVulkanDevice.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace abcg {
+struct VulkanUploadTicket;
+struct VulkanStagingAllocation;
+class VulkanUploadContext;
+} // namespace abcg
+
+/**
+ * @brief Handle to a batch of uploads submitted by
+ * abcg::VulkanUploadContext::submit.
+ *
+ * A default-constructed ticket refers to no batch and is always complete.
+ */
+struct abcg::VulkanUploadTicket {
+  uint64_t value{};
+};
+
+/**
+ * @brief Region of staging memory returned by
+ * abcg::VulkanUploadContext::stage.
+ */
+struct abcg::VulkanStagingAllocation {
+  vk::Buffer buffer;
+  vk::DeviceSize offset{};
+};
+
+/**
+ * @brief A class for batching uploads to device local memory.
+ *
+ * Commands recorded with abcg::VulkanUploadContext::record go to a single
+ * command buffer of the transfer queue, and commands recorded with
+ * abcg::VulkanUploadContext::recordOnGraphicsQueue (e.g., mipmap blits) go to
+ * a command buffer of the graphics queue that waits for the transfers of the
+ * same batch. abcg::VulkanUploadContext::submit submits both with a single
+ * fence and returns a ticket that can be polled or waited on.
+ *
+ * Data copied with abcg::VulkanUploadContext::stage lives in persistently
+ * mapped staging blocks that are reused once the batch that read them is
+ * complete.
+ *
+ * This class is not thread-safe. It allocates from the command pools of the
+ * device, so it must be used on the same thread as the other users of these
+ * pools.
+ */
+class abcg::VulkanUploadContext {
+public:
+  /**
+   * @brief Function that records commands into a command buffer.
+   */
+  using RecordFunction = std::function<void(vk::CommandBuffer const &)>;
+
+  void create(VulkanDevice const &device,
+              vk::DeviceSize stagingBlockSize = 8UL * 1024UL * 1024UL);
+  void destroy();
+
+  [[nodiscard]] VulkanStagingAllocation stage(void const *data,
+                                              vk::DeviceSize size,
+                                              vk::DeviceSize alignment = 1);
+  void record(RecordFunction const &fun);
+  void recordOnGraphicsQueue(RecordFunction const &fun);
+  void transferOwnership(vk::ImageMemoryBarrier barrier,
+                         vk::PipelineStageFlags srcStageMask,
+                         vk::PipelineStageFlags dstStageMask);
+  void transferOwnership(vk::BufferMemoryBarrier barrier,
+                         vk::PipelineStageFlags srcStageMask,
+                         vk::PipelineStageFlags dstStageMask);
+
+  VulkanUploadTicket submit();
+  [[nodiscard]] bool isComplete(VulkanUploadTicket ticket);
+  void wait(VulkanUploadTicket ticket);
+  void waitAll();
+  void collect();
+
+  [[nodiscard]] bool hasSeparateTransferQueue() const noexcept;
+
+private:
+  struct StagingBlock {
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+    std::byte *mapped{};
+    vk::DeviceSize size{};
+    vk::DeviceSize used{};
+  };
+
+  struct Batch {
+    uint64_t ticket{};
+    vk::CommandBuffer transfer;
+    vk::CommandBuffer graphics;
+    vk::Semaphore semaphore;
+    vk::Fence fence;
+    std::vector<StagingBlock> stagingBlocks;
+  };
+
+  template <typename Barrier>
+  void recordOwnershipTransfer(Barrier barrier,
+                               vk::PipelineStageFlags srcStageMask,
+                               vk::PipelineStageFlags dstStageMask);
+  [[nodiscard]] StagingBlock acquireStagingBlock(vk::DeviceSize size);
+  void releaseStagingBlock(StagingBlock block);
+  void destroyStagingBlock(StagingBlock const &block) const;
+  [[nodiscard]] vk::CommandBuffer beginCommandBuffer(vk::CommandPool pool);
+  void releaseBatch(Batch &batch);
+
+  vk::Device m_device;
+  VulkanPhysicalDevice const *m_physicalDevice{};
+  vk::Queue m_transferQueue;
+  vk::Queue m_graphicsQueue;
+  vk::CommandPool m_transferPool;
+  vk::CommandPool m_graphicsPool;
+  uint32_t m_transferQueueFamily{};
+  uint32_t m_graphicsQueueFamily{};
+  vk::DeviceSize m_stagingBlockSize{};
+  vk::DeviceSize m_stagingAlignment{};
+
+  // Batch being recorded, and batches submitted but not yet collected, in
+  // submission order
+  Batch m_recording;
+  std::deque<Batch> m_pending;
+  std::vector<StagingBlock> m_freeStagingBlocks;
+  std::vector<vk::Fence> m_freeFences;
+  std::vector<vk::Semaphore> m_freeSemaphores;
+  uint64_t m_nextTicket{1};
+  uint64_t m_completedTicket{};
+};
+
+#endif
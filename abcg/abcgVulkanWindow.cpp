@@ -12,14 +12,17 @@
 
 #include <SDL_vulkan.h>
 #include <algorithm>
+#include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_vulkan.h>
 
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
 #include "abcgVulkanError.hpp"
 #include "abcgVulkanInstance.hpp"
+#include "abcgVulkanShader.hpp"
 #include "abcgWindow.hpp"
 
 namespace {
@@ -56,6 +59,43 @@ getRequiredExtensions(gsl::not_null<SDL_Window *> window) {
   return extensions;
 }
 
+// Shows the memory usage of each heap that has memory reserved
+void paintMemoryStats(abcg::VulkanMemoryAllocator const &allocator) {
+  auto const toMiB{[](vk::DeviceSize bytes) {
+    return gsl::narrow_cast<double>(bytes) / (1024.0 * 1024.0);
+  }};
+
+  auto const displaySize{ImGui::GetIO().DisplaySize};
+  ImGui::SetNextWindowPos(ImVec2(displaySize.x - 5, 5), ImGuiCond_Always,
+                          ImVec2(1, 0));
+  ImGui::SetNextWindowBgAlpha(0.75f);
+  ImGui::Begin("Memory", nullptr,
+               ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                   ImGuiWindowFlags_NoBringToFrontOnFocus |
+                   ImGuiWindowFlags_NoFocusOnAppearing);
+
+  for (auto &&[heapIndex, stats] : iter::enumerate(allocator.getStats())) {
+    if (stats.reserved == 0) {
+      continue;
+    }
+    auto const deviceLocal{static_cast<bool>(
+        stats.heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal)};
+    ImGui::Text("Heap %zu (%s, %.0f MiB)", heapIndex,
+                deviceLocal ? "device" : "host", toMiB(stats.heap.size));
+    auto const label{fmt::format("{:.1f} / {:.1f} MiB", toMiB(stats.used),
+                                 toMiB(stats.reserved))};
+    ImGui::ProgressBar(gsl::narrow_cast<float>(
+                           gsl::narrow_cast<double>(stats.used) /
+                           gsl::narrow_cast<double>(stats.reserved)),
+                       ImVec2(200, 0), label.c_str());
+    ImGui::Text("%zu allocations in %zu blocks", stats.allocationCount,
+                stats.blockCount);
+  }
+
+  ImGui::End();
+}
+
 void checkVkResultSingleArg(VkResult retCode) { abcg::checkVkResult(retCode); }
 } // namespace
 
@@ -155,8 +195,10 @@ void abcg::VulkanWindow::onPaint([[maybe_unused]] VulkanFrame const &frame) {}
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
- * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
+ * abcg::WindowSettings::showFPS is set to `true`, the memory usage if
+ * abcg::VulkanSettings::showMemoryStats is set to `true`, and a toggle
+ * fullscreen button if abcg::WindowSettings::showFullscreenButton is set to
+ * `true`.
  */
 void abcg::VulkanWindow::onPaintUI() {
   // FPS counter
@@ -187,6 +229,11 @@ void abcg::VulkanWindow::onPaintUI() {
     ImGui::End();
   }
 
+  // Memory usage
+  if (m_vulkanSettings.showMemoryStats) {
+    paintMemoryStats(m_device.getMemoryAllocator());
+  }
+
   // Fullscreen button
   if (abcg::Window::getWindowSettings().showFullscreenButton) {
     auto const windowSize{getWindowSize()};
@@ -230,6 +277,20 @@ void abcg::VulkanWindow::onResize() {}
  */
 void abcg::VulkanWindow::onUpdate() {}
 
+/**
+ * @brief Custom handler called at a fixed rate.
+ *
+ * This virtual function is called zero or more times per frame, before
+ * abcg::VulkanWindow::onUpdate, so that it runs on average
+ * abcg::WindowSettings::fixedUpdateRate times per second. Use
+ * abcg::Window::getFixedDeltaTime as the time step of the simulation, and
+ * abcg::Window::getInterpolationAlpha in abcg::VulkanWindow::onPaint to
+ * interpolate between simulation states.
+ *
+ * Override it for custom behavior. By default, it does nothing.
+ */
+void abcg::VulkanWindow::onFixedUpdate() {}
+
 /**
  * @brief Custom handler for cleaning up Vulkan resources.
  *
@@ -302,7 +363,8 @@ void abcg::VulkanWindow::create() {
                           sampleCount);
 
   // Create logical device
-  m_device.create(m_physicalDevice, m_deviceExtensions);
+  m_device.create(m_physicalDevice, m_deviceExtensions,
+                  m_vulkanSettings.pipelineCachePath);
 
   // Create swapchain
   m_swapchain.create(m_device, m_vulkanSettings, getWindowSize());
@@ -352,11 +414,13 @@ void abcg::VulkanWindow::create() {
       .Device = static_cast<vk::Device>(m_device),
       .QueueFamily = m_physicalDevice.getQueuesFamilies().graphics.value_or(0),
       .Queue = m_device.getQueues().graphics,
-      .PipelineCache = VK_NULL_HANDLE,
+      .PipelineCache = m_device.getPipelineCache(),
       .DescriptorPool = m_UIdescriptorPool,
       .Subpass = 0,
       .MinImageCount = 2,
-      .ImageCount = gsl::narrow<uint32_t>(m_swapchain.getFrames().size()),
+      // Vertex and index buffers of the UI are reused after ImageCount frames
+      .ImageCount = std::max(
+          gsl::narrow<uint32_t>(m_swapchain.getFrames().size()), 2U),
       .MSAASamples =
           static_cast<VkSampleCountFlagBits>(m_physicalDevice.getSampleCount()),
       .Allocator = nullptr,
@@ -393,12 +457,20 @@ void abcg::VulkanWindow::create() {
     ImGui_ImplVulkan_DestroyFontUploadObjects();
   }
 
+  abcg::setVulkanShaderCachePath(m_vulkanSettings.shaderCachePath);
+
   onCreate();
 
   onResize();
 }
 
+void abcg::VulkanWindow::beginFrame() {}
+
+void abcg::VulkanWindow::fixedUpdate() { onFixedUpdate(); }
+
 void abcg::VulkanWindow::paint() {
+  ABCG_TRACE_ZONE("VulkanWindow::paint");
+
   onUpdate();
 
   if (m_hidden || m_minimized)
@@ -13,6 +13,8 @@
 #ifndef ABCG_VULKAN_WINDOW_HPP_
 #define ABCG_VULKAN_WINDOW_HPP_
 
+#include <string>
+
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanInstance.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
@@ -57,6 +59,36 @@ struct abcg::VulkanSettings {
    * comes first.
    */
   bool vSync{false};
+
+  /** @brief Maximum number of frames that can be processed concurrently by
+   * the CPU and the GPU.
+   *
+   * Each frame in flight has its own command pool, command buffers, fence and
+   * semaphores (see abcg::VulkanFrame). This is independent of the number of
+   * swapchain images. Higher values let the CPU record frames further ahead of
+   * the GPU, at the cost of latency. Values smaller than 1 are treated as 1.
+   */
+  int maxFramesInFlight{2};
+
+  /** @brief Path of the file where the pipeline cache is persisted.
+   *
+   * The cache is loaded when the window is created and saved when it is
+   * destroyed. If empty, the cache is only kept in memory.
+   */
+  std::string pipelineCachePath{};
+
+  /** @brief Directory where the SPIR-V code of compiled shaders is cached.
+   *
+   * The cache is disabled if empty.
+   *
+   * @sa abcg::setVulkanShaderCachePath.
+   */
+  std::string shaderCachePath{};
+
+  /** @brief Whether to show an overlay with the device memory used and
+   * reserved by abcg::VulkanMemoryAllocator in each memory heap.
+   */
+  bool showMemoryStats{false};
 };
 
 /**
@@ -72,6 +104,8 @@ struct abcg::VulkanSettings {
  * @sa abcg::VulkanWindow::onPaintUI for UI rendering.
  * @sa abcg::VulkanWindow::onResize for handling swapchain rebuild events.
  * @sa abcg::VulkanWindow::onUpdate for commands to be called every frame.
+ * @sa abcg::VulkanWindow::onFixedUpdate for commands to be called at a fixed
+ * rate.
  * @sa abcg::VulkanWindow::onDestroy for cleaning up Vulkan resources.
  *
  * @remark Objects of this type cannot be copied or copy-constructed.
@@ -92,12 +126,15 @@ protected:
   virtual void onPaintUI();
   virtual void onResize();
   virtual void onUpdate();
+  virtual void onFixedUpdate();
   virtual void onDestroy();
 
 private:
   void handleEvent(SDL_Event const &event) final;
   void create() final;
   void paint() final;
+  void beginFrame() final;
+  void fixedUpdate() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
 
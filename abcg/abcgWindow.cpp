@@ -14,6 +14,9 @@
 
 #include <imgui_impl_sdl2.h>
 
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
 namespace {
 ImVec4 ColorAlpha(ImVec4 const &color, float const alpha) {
   return {color.x, color.y, color.z, alpha};
@@ -162,6 +165,9 @@ abcg::fullscreenchangeCallback(int eventType,
  * that, zero is returned. Internally, the delta time accumulates for the next
  * frame(s) until at least 2ms have passed.
  *
+ * In an offline render, this is always 1 /
+ * abcg::OfflineRenderSettings::frameRate.
+ *
  * @returns Time in seconds.
  */
 double abcg::Window::getDeltaTime() const noexcept { return m_lastDeltaTime; }
@@ -169,9 +175,41 @@ double abcg::Window::getDeltaTime() const noexcept { return m_lastDeltaTime; }
 /**
  * @brief Returns the time that have passed since the window was created.
  *
+ * In an offline render, this is the simulated time of the frames rendered so
+ * far.
+ *
  * @returns Time in seconds.
  */
-double abcg::Window::getElapsedTime() const { return m_elapsedTime.elapsed(); }
+double abcg::Window::getElapsedTime() const {
+  if (isOfflineRendering()) {
+    return gsl::narrow<double>(m_offlineFrame) /
+           m_offlineRenderSettings.frameRate;
+  }
+  return m_elapsedTime.elapsed();
+}
+
+/**
+ * @brief Returns the time step of the fixed-step updates.
+ *
+ * @returns Time in seconds, equal to 1 / abcg::WindowSettings::fixedUpdateRate.
+ */
+double abcg::Window::getFixedDeltaTime() const noexcept {
+  return 1.0 / m_windowSettings.fixedUpdateRate;
+}
+
+/**
+ * @brief Returns how far the current frame is between the last two fixed-step
+ * updates.
+ *
+ * Use this value to interpolate between the previous and current simulation
+ * states when rendering, so that motion looks smooth even when the frame rate
+ * differs from the fixed update rate.
+ *
+ * @returns Value in the range [0, 1).
+ */
+double abcg::Window::getInterpolationAlpha() const noexcept {
+  return m_interpolationAlpha;
+}
 
 /**
  * @brief Returns the current configuration settings of the window.
@@ -184,8 +222,19 @@ abcg::WindowSettings const &abcg::Window::getWindowSettings() const noexcept {
 
 /**
  * @brief Sets the configuration settings of the window.
+ *
+ * @throw abcg::RuntimeError if abcg::WindowSettings::fixedUpdateRate is not
+ * positive, or if abcg::WindowSettings::maxFixedUpdatesPerFrame is less than
+ * 1.
  */
 void abcg::Window::setWindowSettings(WindowSettings const &windowSettings) {
+  if (windowSettings.fixedUpdateRate <= 0) {
+    throw abcg::RuntimeError("Invalid fixed update rate");
+  }
+  if (windowSettings.maxFixedUpdatesPerFrame < 1) {
+    throw abcg::RuntimeError("Invalid maximum number of fixed updates");
+  }
+
   if (m_window != nullptr) {
     if (windowSettings.title != m_windowSettings.title) {
       SDL_SetWindowTitle(m_window, windowSettings.title.c_str());
@@ -209,6 +258,47 @@ void abcg::Window::setWindowSettings(WindowSettings const &windowSettings) {
   m_windowSettings = windowSettings;
 }
 
+/**
+ * @brief Returns the configuration settings of the offline render.
+ *
+ * @returns Reference to the current abcg::OfflineRenderSettings object.
+ */
+abcg::OfflineRenderSettings const &
+abcg::Window::getOfflineRenderSettings() const noexcept {
+  return m_offlineRenderSettings;
+}
+
+/**
+ * @brief Sets the configuration settings of the offline render.
+ *
+ * @param settings Configuration settings. An empty path disables offline
+ * rendering.
+ *
+ * @throw abcg::RuntimeError if the window was already created, or if the frame
+ * rate or the frame count are not positive.
+ */
+void abcg::Window::setOfflineRenderSettings(
+    OfflineRenderSettings const &settings) {
+  if (m_window != nullptr) {
+    throw abcg::RuntimeError(
+        "Offline rendering must be set before creating the window");
+  }
+  if (settings.frameRate <= 0 || settings.frameCount <= 0) {
+    throw abcg::RuntimeError(
+        "Invalid frame rate or frame count for offline rendering");
+  }
+  m_offlineRenderSettings = settings;
+}
+
+/**
+ * @brief Returns whether the window is rendering offline.
+ *
+ * @returns True if abcg::OfflineRenderSettings::path is not empty.
+ */
+bool abcg::Window::isOfflineRendering() const noexcept {
+  return !m_offlineRenderSettings.path.empty();
+}
+
 /**
  * @brief Returns the SDL window previously created with
  * abcg::Window::createOpenGLWindow or abcg::Window::createVulkanWindow.
@@ -391,14 +481,46 @@ void abcg::Window::templateCreate() {
 }
 
 void abcg::Window::templatePaint() {
-  // Cap to 480 Hz
-  if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
+  ABCG_TRACE_ZONE("Window::templatePaint");
+
+  if (isOfflineRendering()) {
+    // Advance by the same step every frame, whatever the time taken to render
+    // it
+    m_lastDeltaTime = 1.0 / m_offlineRenderSettings.frameRate;
+  } else if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
+    // Cap to 480 Hz
     m_lastDeltaTime = m_deltaTime.restart();
   } else {
     m_lastDeltaTime = 0.0;
   }
 
+  beginFrame();
+
+  // Run as many fixed-step updates as needed to catch up with real time
+  auto const fixedDeltaTime{getFixedDeltaTime()};
+  m_fixedUpdateAccumulator += m_lastDeltaTime;
+  auto steps{0};
+  while (m_fixedUpdateAccumulator >= fixedDeltaTime) {
+    if (steps == m_windowSettings.maxFixedUpdatesPerFrame &&
+        !isOfflineRendering()) {
+      // Drop the backlog instead of spiraling
+      m_fixedUpdateAccumulator = 0.0;
+      break;
+    }
+    {
+      ABCG_TRACE_ZONE("Window::fixedUpdate");
+      fixedUpdate();
+    }
+    m_fixedUpdateAccumulator -= fixedDeltaTime;
+    ++steps;
+  }
+  m_interpolationAlpha = m_fixedUpdateAccumulator / fixedDeltaTime;
+
   paint();
+
+  if (isOfflineRendering()) {
+    ++m_offlineFrame;
+  }
 }
 
 void abcg::Window::templateDestroy() {
@@ -410,4 +532,9 @@ void abcg::Window::templateDestroy() {
   SDL_DestroyWindow(m_window);
   m_window = nullptr;
   m_windowID = 0;
-}
\ No newline at end of file
+}
+
+bool abcg::Window::isOfflineRenderComplete() const noexcept {
+  return isOfflineRendering() &&
+         m_offlineFrame >= m_offlineRenderSettings.frameCount;
+}
@@ -23,6 +23,7 @@
 #endif
 
 namespace abcg {
+struct OfflineRenderSettings;
 struct WindowSettings;
 class Application;
 class Window;
@@ -34,6 +35,38 @@ EM_BOOL fullscreenchangeCallback(int eventType,
 #endif
 } // namespace abcg
 
+/**
+ * @brief Configuration settings of an offline render.
+ *
+ * In an offline render, the window advances by a fixed time step of
+ * 1 / @a frameRate seconds per frame, regardless of the wall clock, and each
+ * frame is written to disk. Frames are rendered as fast as possible, so the
+ * render usually runs faster than real time. The application quits after
+ * @a frameCount frames.
+ *
+ * abcg::Application enables it from the command line (see
+ * abcg::Application::Application).
+ *
+ * @remark Only abcg::OpenGLWindow renders offscreen and writes the frames.
+ * Other windows only use the fixed time step.
+ *
+ * @sa abcg::Window::setOfflineRenderSettings.
+ */
+struct abcg::OfflineRenderSettings {
+  /** @brief Output path. Frames are written to a YUV4MPEG2 stream if the
+   * path ends with `.y4m`, or else to PPM images named with the path followed
+   * by the frame number. Offline rendering is disabled if empty.
+   */
+  std::string path{};
+  /** @brief Resolution of the frames, in pixels. The window size is used if
+   * zero. */
+  glm::ivec2 size{};
+  /** @brief Number of frames per second of simulated time. */
+  int frameRate{60};
+  /** @brief Number of frames to render. */
+  int frameCount{600};
+};
+
 /**
  * @brief Configuration settings of a window.
  *
@@ -60,6 +93,13 @@ struct abcg::WindowSettings {
   int height{600};
   /** @brief Whether to show an overlay window with a FPS counter. */
   bool showFPS{true};
+  /** @brief Whether to show an overlay with the CPU and GPU time of each
+   * phase of the frame.
+   *
+   * @remark Only supported by abcg::OpenGLWindow. GPU times are not available
+   * on WebGL and OpenGL ES contexts.
+   */
+  bool showFrameProfiler{false};
   /** @brief Whether to show a button to toggle fullscreen on/off. */
   bool showFullscreenButton{true};
   /** @brief HTML element ID used for registering the fullscreen callback when
@@ -68,6 +108,21 @@ struct abcg::WindowSettings {
   std::string fullscreenElementID{"#canvas"};
   /** @brief String containing the window title. */
   std::string title{"ABCg Window"};
+  /** @brief Number of fixed-step updates per second.
+   *
+   * Must be positive.
+   *
+   * @sa abcg::OpenGLWindow::onFixedUpdate.
+   * @sa abcg::VulkanWindow::onFixedUpdate.
+   */
+  double fixedUpdateRate{60.0};
+  /** @brief Maximum number of fixed-step updates per frame.
+   *
+   * If the frame takes longer than this number of steps, the remaining
+   * simulation time is dropped so that a slow frame cannot trigger an
+   * ever-growing number of updates. Must be at least 1.
+   */
+  int maxFixedUpdatesPerFrame{5};
 };
 
 /**
@@ -106,6 +161,10 @@ public:
 
   [[nodiscard]] WindowSettings const &getWindowSettings() const noexcept;
   void setWindowSettings(WindowSettings const &windowSettings);
+  [[nodiscard]] OfflineRenderSettings const &
+  getOfflineRenderSettings() const noexcept;
+  void setOfflineRenderSettings(OfflineRenderSettings const &settings);
+  [[nodiscard]] bool isOfflineRendering() const noexcept;
 
 protected:
   /**
@@ -134,6 +193,24 @@ protected:
    */
   virtual void paint() = 0;
 
+  /**
+   * @brief Custom handler for the start of a frame.
+   *
+   * This is called once per frame, before the fixed-step updates and
+   * abcg::Window::paint.
+   */
+  virtual void beginFrame() = 0;
+
+  /**
+   * @brief Custom handler for fixed-step updates.
+   *
+   * This is called zero or more times per frame, just before
+   * abcg::Window::paint, so that it runs on average
+   * abcg::WindowSettings::fixedUpdateRate times per second regardless of the
+   * frame rate.
+   */
+  virtual void fixedUpdate() = 0;
+
   /**
    * @brief Custom handler for window cleanup tasks.
    *
@@ -154,6 +231,8 @@ protected:
 
   [[nodiscard]] double getDeltaTime() const noexcept;
   [[nodiscard]] double getElapsedTime() const;
+  [[nodiscard]] double getFixedDeltaTime() const noexcept;
+  [[nodiscard]] double getInterpolationAlpha() const noexcept;
   [[nodiscard]] SDL_Window *getSDLWindow() const noexcept;
   [[nodiscard]] Uint32 getSDLWindowID() const noexcept;
 
@@ -166,15 +245,20 @@ private:
   void templateCreate();
   void templatePaint();
   void templateDestroy();
+  [[nodiscard]] bool isOfflineRenderComplete() const noexcept;
 
   SDL_Window *m_window{};
   Uint32 m_windowID{};
 
   WindowSettings m_windowSettings;
+  OfflineRenderSettings m_offlineRenderSettings;
 
   Timer m_deltaTime;
   Timer m_elapsedTime;
   double m_lastDeltaTime{};
+  double m_fixedUpdateAccumulator{};
+  double m_interpolationAlpha{};
+  int m_offlineFrame{};
 
   bool m_enableResizingEventWatcher{true};
 
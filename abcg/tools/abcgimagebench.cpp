@@ -0,0 +1,179 @@
+/**
+ * @file abcgimagebench.cpp
+ * @brief Benchmark of the image kernels of abcgImage.
+ *
+ * Usage: abcgimagebench [width] [height]
+ *
+ * Times each kernel on a random image of the given size (1920x1080 by
+ * default) and prints its speedup over a plain loop.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcgImage.hpp"
+
+namespace {
+// Times the image kernels of abcgImage on a width x height image against the
+// per-pixel loops that flipVertically and flipHorizontally used before, and
+// against plain loops for the conversions
+void benchmarkImage(std::size_t width, std::size_t height) {
+  std::default_random_engine randomEngine{1};
+  std::uniform_int_distribution<unsigned> randomByte{0, 255};
+
+  auto const pixelCount{width * height};
+  std::vector<std::byte> rgba(pixelCount * 4);
+  std::vector<std::byte> rgb(pixelCount * 3);
+  std::vector<std::byte> output(pixelCount * 4);
+  for (auto &byte : rgba)
+    byte = std::byte(randomByte(randomEngine));
+  for (auto &byte : rgb)
+    byte = std::byte(randomByte(randomEngine));
+
+  // Repeat until about 200 million pixels have been processed
+  auto const repetitions{std::max<std::size_t>(1, 200'000'000 / pixelCount)};
+
+  auto const run{[&](std::string_view name, auto &&operation,
+                     double baseline) {
+    auto const start{std::chrono::steady_clock::now()};
+    for (std::size_t repetition{}; repetition < repetitions; ++repetition) {
+      operation();
+    }
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start};
+    auto const nanoseconds{elapsed.count() * 1e9 /
+                           static_cast<double>(repetitions * pixelCount)};
+    fmt::print("{:>22}: {:.3f} ns/pixel, {:.2f}x\n", name, nanoseconds,
+               baseline > 0.0 ? baseline / nanoseconds : 1.0);
+    return nanoseconds;
+  }};
+
+  auto const rowSize{width * 4};
+  auto const row{[&](std::size_t index) {
+    return std::span{rgba}.subspan(index * rowSize, rowSize);
+  }};
+
+  fmt::print("{}x{} image, {} repetitions, {} kernels\n", width, height,
+             repetitions, abcg::getImageKernelName());
+
+  auto baseline{run(
+      "row copies",
+      [&] {
+        std::vector<std::byte> pixelRow(rowSize);
+        for (std::size_t index{}; index < height / 2; ++index) {
+          std::ranges::copy(row(index), pixelRow.begin());
+          std::ranges::copy(row(height - index - 1), row(index).begin());
+          std::ranges::copy(pixelRow, row(height - index - 1).begin());
+        }
+      },
+      0.0)};
+  run(
+      "swapRows",
+      [&] {
+        for (std::size_t index{}; index < height / 2; ++index) {
+          abcg::swapRows(row(index), row(height - index - 1));
+        }
+      },
+      baseline);
+
+  baseline = run(
+      "pixel copies",
+      [&] {
+        std::vector<std::byte> pixelRow(rowSize);
+        for (std::size_t index{}; index < height; ++index) {
+          auto const pixels{row(index)};
+          for (std::size_t pixel{}; pixel < width; ++pixel) {
+            std::copy_n(pixels.begin() + (width - pixel - 1) * 4, 4,
+                        pixelRow.begin() + pixel * 4);
+          }
+          std::ranges::copy(pixelRow, pixels.begin());
+        }
+      },
+      0.0);
+  run(
+      "reversePixels",
+      [&] {
+        for (std::size_t index{}; index < height; ++index) {
+          abcg::reversePixels(row(index), 4);
+        }
+      },
+      baseline);
+
+  baseline = run(
+      "RGB to RGBA loop",
+      [&] {
+        for (std::size_t pixel{}; pixel < pixelCount; ++pixel) {
+          std::copy_n(rgb.begin() + pixel * 3, 3, output.begin() + pixel * 4);
+          output[pixel * 4 + 3] = std::byte{0xFF};
+        }
+      },
+      0.0);
+  run("expandRGBToRGBA", [&] { abcg::expandRGBToRGBA(rgb, output); },
+      baseline);
+
+  baseline = run(
+      "BGRA to RGBA loop",
+      [&] {
+        for (std::size_t pixel{}; pixel < pixelCount; ++pixel) {
+          std::swap(rgba[pixel * 4], rgba[pixel * 4 + 2]);
+        }
+      },
+      0.0);
+  run("swizzleRedBlue", [&] { abcg::swizzleRedBlue(rgba, rgba, 4); },
+      baseline);
+
+  baseline = run(
+      "premultiply loop",
+      [&] {
+        for (std::size_t pixel{}; pixel < pixelCount; ++pixel) {
+          auto const alpha{std::to_integer<unsigned>(rgba[pixel * 4 + 3])};
+          for (std::size_t channel{}; channel < 3; ++channel) {
+            auto const color{
+                std::to_integer<unsigned>(rgba[pixel * 4 + channel])};
+            output[pixel * 4 + channel] =
+                std::byte((color * alpha + 127) / 255);
+          }
+          output[pixel * 4 + 3] = rgba[pixel * 4 + 3];
+        }
+      },
+      0.0);
+  run("premultiplyAlpha", [&] { abcg::premultiplyAlpha(rgba, output); },
+      baseline);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    auto const width{argc > 1 ? std::stoll(argv[1]) : 1920};
+    auto const height{argc > 2 ? std::stoll(argv[2]) : 1080};
+    if (width <= 0 || height <= 0) {
+      fmt::print(stderr, "Usage: abcgimagebench [width] [height]\n");
+      return -1;
+    }
+    benchmarkImage(static_cast<std::size_t>(width),
+                   static_cast<std::size_t>(height));
+  } catch (std::logic_error const &) {
+    // Thrown by std::stoll for non-numeric or out of range values
+    fmt::print(stderr, "Usage: abcgimagebench [width] [height]\n");
+    return -1;
+  } catch (std::exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
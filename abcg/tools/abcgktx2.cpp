@@ -0,0 +1,450 @@
+/**
+ * @file abcgktx2.cpp
+ * @brief Offline converter of PNG/JPEG images to KTX2 textures.
+ *
+ * Usage: abcgktx2 [options] input output.ktx2
+ *
+ * Options:
+ * - `--format rgba8|bc1|bc3`: pixel format of the texture. The default is
+ *   `bc1` for opaque images and `bc3` for images with transparent pixels.
+ * - `--srgb`: stores the texture in an sRGB format. Mipmap levels are then
+ *   filtered in linear space.
+ * - `--no-mipmaps`: stores only the base level.
+ * - `--flip`: flips the image upside down, as done by
+ *   abcg::loadOpenGLTexture with `flipUpsideDown = true`.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include <SDL_image.h>
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcgException.hpp"
+#include "abcgImage.hpp"
+#include "abcgKTX2.hpp"
+
+namespace {
+enum class Encoding { RGBA8, BC1, BC3 };
+
+struct Options {
+  std::string input;
+  std::string output;
+  std::optional<Encoding> encoding;
+  bool sRGB{};
+  bool generateMipmaps{true};
+  bool flipUpsideDown{};
+};
+
+// RGBA8 pixels, row by row, without padding
+struct Pixels {
+  uint32_t width{};
+  uint32_t height{};
+  std::vector<uint8_t> data;
+};
+
+using Color = std::array<float, 3>;
+
+[[nodiscard]] Options parseOptions(int argc, char **argv) {
+  Options options;
+  std::vector<std::string_view> paths;
+  for (auto index{1}; index < argc; ++index) {
+    std::string_view const argument{argv[index]};
+    if (argument == "--format" && index + 1 < argc) {
+      std::string_view const name{argv[++index]};
+      if (name == "rgba8") {
+        options.encoding = Encoding::RGBA8;
+      } else if (name == "bc1") {
+        options.encoding = Encoding::BC1;
+      } else if (name == "bc3") {
+        options.encoding = Encoding::BC3;
+      } else {
+        throw abcg::RuntimeError(fmt::format("Unknown format {}", name));
+      }
+    } else if (argument == "--srgb") {
+      options.sRGB = true;
+    } else if (argument == "--no-mipmaps") {
+      options.generateMipmaps = false;
+    } else if (argument == "--flip") {
+      options.flipUpsideDown = true;
+    } else if (argument.starts_with("--")) {
+      throw abcg::RuntimeError(fmt::format("Unknown option {}", argument));
+    } else {
+      paths.push_back(argument);
+    }
+  }
+  if (paths.size() != 2) {
+    throw abcg::RuntimeError(
+        "Usage: abcgktx2 [--format rgba8|bc1|bc3] [--srgb] [--no-mipmaps] "
+        "[--flip] input output.ktx2");
+  }
+  options.input = paths.at(0);
+  options.output = paths.at(1);
+  return options;
+}
+
+[[nodiscard]] Pixels loadPixels(Options const &options) {
+  SDL_Surface *const surface{IMG_Load(options.input.c_str())};
+  if (surface == nullptr) {
+    throw abcg::SDLImageError(
+        fmt::format("Failed to load image file {}", options.input));
+  }
+  SDL_Surface *const formattedSurface{
+      abcg::convertSurface(surface, SDL_PIXELFORMAT_RGBA32)};
+  if (formattedSurface == nullptr) {
+    throw abcg::SDLError(
+        fmt::format("Failed to convert image file {}", options.input));
+  }
+
+  Pixels pixels{.width = gsl::narrow<uint32_t>(formattedSurface->w),
+                .height = gsl::narrow<uint32_t>(formattedSurface->h),
+                .data = {}};
+  auto const rowSize{std::size_t{pixels.width} * 4};
+  pixels.data.resize(rowSize * pixels.height);
+
+  // Copy the rows without the padding of the surface
+  SDL_LockSurface(formattedSurface);
+  auto const *const source{
+      static_cast<uint8_t const *>(formattedSurface->pixels)};
+  for (auto const row : iter::range(std::size_t{pixels.height})) {
+    auto const sourceRow{options.flipUpsideDown ? pixels.height - 1 - row
+                                                : row};
+    std::memcpy(pixels.data.data() + row * rowSize,
+                source + sourceRow * std::size_t(formattedSurface->pitch),
+                rowSize);
+  }
+  SDL_UnlockSurface(formattedSurface);
+  SDL_FreeSurface(formattedSurface);
+
+  return pixels;
+}
+
+[[nodiscard]] float sRGBToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f
+                           : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+[[nodiscard]] float linearToSRGB(float value) {
+  return value <= 0.0031308f ? value * 12.92f
+                             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Halves each dimension with a box filter. The last row and column of odd
+// dimensions are repeated
+[[nodiscard]] Pixels downsample(Pixels const &source, bool sRGB) {
+  Pixels target{.width = std::max(source.width / 2, 1U),
+                .height = std::max(source.height / 2, 1U),
+                .data = {}};
+  target.data.resize(std::size_t{target.width} * target.height * 4);
+
+  std::array<float, 256> toLinear{};
+  for (auto &&[index, value] : iter::enumerate(toLinear)) {
+    auto const normalized{gsl::narrow_cast<float>(index) / 255.0f};
+    value = sRGB ? sRGBToLinear(normalized) : normalized;
+  }
+
+  for (auto const y : iter::range(target.height)) {
+    for (auto const x : iter::range(target.width)) {
+      std::array<float, 4> sum{};
+      for (auto const offsetY : iter::range(2U)) {
+        for (auto const offsetX : iter::range(2U)) {
+          auto const sourceX{std::min(x * 2 + offsetX, source.width - 1)};
+          auto const sourceY{std::min(y * 2 + offsetY, source.height - 1)};
+          auto const *const pixel{source.data.data() +
+                                  (std::size_t{sourceY} * source.width +
+                                   sourceX) *
+                                      4};
+          for (auto const channel : iter::range(3)) {
+            sum.at(channel) += toLinear.at(pixel[channel]);
+          }
+          sum.at(3) += gsl::narrow_cast<float>(pixel[3]) / 255.0f;
+        }
+      }
+
+      auto *const pixel{target.data.data() +
+                        (std::size_t{y} * target.width + x) * 4};
+      for (auto const channel : iter::range(4)) {
+        auto value{sum.at(channel) / 4.0f};
+        if (sRGB && channel < 3) {
+          value = linearToSRGB(value);
+        }
+        pixel[channel] =
+            gsl::narrow_cast<uint8_t>(std::lround(value * 255.0f));
+      }
+    }
+  }
+  return target;
+}
+
+// Reads a 4x4 block. Pixels outside the image repeat the edge pixels
+[[nodiscard]] std::array<std::array<uint8_t, 4>, 16>
+readBlock(Pixels const &pixels, uint32_t blockX, uint32_t blockY) {
+  std::array<std::array<uint8_t, 4>, 16> block{};
+  for (auto &&[index, texel] : iter::enumerate(block)) {
+    auto const x{std::min(blockX * 4 + gsl::narrow<uint32_t>(index % 4),
+                          pixels.width - 1)};
+    auto const y{std::min(blockY * 4 + gsl::narrow<uint32_t>(index / 4),
+                          pixels.height - 1)};
+    std::memcpy(texel.data(),
+                pixels.data.data() + (std::size_t{y} * pixels.width + x) * 4,
+                4);
+  }
+  return block;
+}
+
+[[nodiscard]] uint16_t toRGB565(Color const &color) {
+  auto const quantize{[](float value, float levels) {
+    return gsl::narrow_cast<uint16_t>(
+        std::lround(std::clamp(value, 0.0f, 255.0f) * levels / 255.0f));
+  }};
+  return gsl::narrow_cast<uint16_t>(quantize(color.at(0), 31.0f) << 11U |
+                                    quantize(color.at(1), 63.0f) << 5U |
+                                    quantize(color.at(2), 31.0f));
+}
+
+[[nodiscard]] Color fromRGB565(uint16_t value) {
+  return {gsl::narrow_cast<float>((value >> 11U) & 31U) * 255.0f / 31.0f,
+          gsl::narrow_cast<float>((value >> 5U) & 63U) * 255.0f / 63.0f,
+          gsl::narrow_cast<float>(value & 31U) * 255.0f / 31.0f};
+}
+
+// Encodes the colors of a block in the 4-color mode of BC1. The endpoints
+// are the extremes of the colors along their principal axis
+void encodeBC1Colors(std::array<std::array<uint8_t, 4>, 16> const &block,
+                     std::vector<std::byte> &output) {
+  Color mean{};
+  for (auto const &texel : block) {
+    for (auto const channel : iter::range(3)) {
+      mean.at(channel) += gsl::narrow_cast<float>(texel.at(channel)) / 16.0f;
+    }
+  }
+
+  std::array<float, 6> covariance{}; // rr, rg, rb, gg, gb, bb
+  for (auto const &texel : block) {
+    Color delta{};
+    for (auto const channel : iter::range(3)) {
+      delta.at(channel) =
+          gsl::narrow_cast<float>(texel.at(channel)) - mean.at(channel);
+    }
+    covariance.at(0) += delta.at(0) * delta.at(0);
+    covariance.at(1) += delta.at(0) * delta.at(1);
+    covariance.at(2) += delta.at(0) * delta.at(2);
+    covariance.at(3) += delta.at(1) * delta.at(1);
+    covariance.at(4) += delta.at(1) * delta.at(2);
+    covariance.at(5) += delta.at(2) * delta.at(2);
+  }
+
+  // Power iteration
+  Color axis{1.0f, 1.0f, 1.0f};
+  for ([[maybe_unused]] auto const iteration : iter::range(8)) {
+    Color const next{
+        covariance.at(0) * axis.at(0) + covariance.at(1) * axis.at(1) +
+            covariance.at(2) * axis.at(2),
+        covariance.at(1) * axis.at(0) + covariance.at(3) * axis.at(1) +
+            covariance.at(4) * axis.at(2),
+        covariance.at(2) * axis.at(0) + covariance.at(4) * axis.at(1) +
+            covariance.at(5) * axis.at(2)};
+    auto const length{std::max(
+        {std::abs(next.at(0)), std::abs(next.at(1)), std::abs(next.at(2))})};
+    if (length == 0.0f) {
+      break;
+    }
+    for (auto const channel : iter::range(3)) {
+      axis.at(channel) = next.at(channel) / length;
+    }
+  }
+
+  auto const project{[&](std::array<uint8_t, 4> const &texel) {
+    auto dot{0.0f};
+    for (auto const channel : iter::range(3)) {
+      dot += (gsl::narrow_cast<float>(texel.at(channel)) - mean.at(channel)) *
+             axis.at(channel);
+    }
+    return dot;
+  }};
+  auto const [minTexel, maxTexel]{std::ranges::minmax_element(
+      block, {}, [&](auto const &texel) { return project(texel); })};
+
+  Color maxColor{};
+  Color minColor{};
+  for (auto const channel : iter::range(3)) {
+    maxColor.at(channel) = gsl::narrow_cast<float>(maxTexel->at(channel));
+    minColor.at(channel) = gsl::narrow_cast<float>(minTexel->at(channel));
+  }
+  auto color0{toRGB565(maxColor)};
+  auto color1{toRGB565(minColor)};
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  // With color0 > color1, the two other colors are interpolated
+  std::array<Color, 4> palette{fromRGB565(color0), fromRGB565(color1)};
+  for (auto const channel : iter::range(3)) {
+    palette.at(2).at(channel) =
+        (2.0f * palette.at(0).at(channel) + palette.at(1).at(channel)) / 3.0f;
+    palette.at(3).at(channel) =
+        (palette.at(0).at(channel) + 2.0f * palette.at(1).at(channel)) / 3.0f;
+  }
+
+  uint32_t indices{};
+  if (color0 != color1) {
+    for (auto &&[index, texel] : iter::enumerate(block)) {
+      auto const distance{[&](Color const &color) {
+        auto sum{0.0f};
+        for (auto const channel : iter::range(3)) {
+          auto const delta{gsl::narrow_cast<float>(texel.at(channel)) -
+                           color.at(channel)};
+          sum += delta * delta;
+        }
+        return sum;
+      }};
+      auto const nearest{std::ranges::min_element(palette, {}, distance)};
+      indices |= gsl::narrow<uint32_t>(nearest - palette.begin())
+                 << (index * 2);
+    }
+  }
+
+  auto const write{[&output](auto value) {
+    auto const offset{output.size()};
+    output.resize(offset + sizeof(value));
+    std::memcpy(output.data() + offset, &value, sizeof(value));
+  }};
+  write(color0);
+  write(color1);
+  write(indices);
+}
+
+// Encodes the alpha of a block in the 8-value mode of BC3
+void encodeBC3Alpha(std::array<std::array<uint8_t, 4>, 16> const &block,
+                    std::vector<std::byte> &output) {
+  auto const [minTexel, maxTexel]{std::ranges::minmax_element(
+      block, {}, [](auto const &texel) { return texel.at(3); })};
+  auto const alpha0{maxTexel->at(3)};
+  auto const alpha1{minTexel->at(3)};
+
+  // With alpha0 > alpha1, indices 2 to 7 go from alpha0 to alpha1
+  std::array<int, 8> palette{alpha0, alpha1};
+  for (auto const index : iter::range(1, 7)) {
+    palette.at(gsl::narrow<std::size_t>(index + 1)) =
+        ((7 - index) * alpha0 + index * alpha1) / 7;
+  }
+
+  uint64_t indices{};
+  if (alpha0 != alpha1) {
+    for (auto &&[index, texel] : iter::enumerate(block)) {
+      auto const nearest{
+          std::ranges::min_element(palette, {}, [&](int value) {
+            return std::abs(value - texel.at(3));
+          })};
+      indices |= gsl::narrow<uint64_t>(nearest - palette.begin())
+                 << (index * 3);
+    }
+  }
+
+  output.push_back(std::byte{alpha0});
+  output.push_back(std::byte{alpha1});
+  for (auto const byte : iter::range(6U)) {
+    output.push_back(
+        std::byte{gsl::narrow_cast<uint8_t>(indices >> (byte * 8))});
+  }
+}
+
+[[nodiscard]] abcg::KTX2Level encode(Pixels const &pixels,
+                                     Encoding encoding) {
+  abcg::KTX2Level level{
+      .width = pixels.width, .height = pixels.height, .data = {}};
+  if (encoding == Encoding::RGBA8) {
+    level.data.resize(pixels.data.size());
+    std::memcpy(level.data.data(), pixels.data.data(), pixels.data.size());
+    return level;
+  }
+
+  for (auto const blockY : iter::range((pixels.height + 3) / 4)) {
+    for (auto const blockX : iter::range((pixels.width + 3) / 4)) {
+      auto const block{readBlock(pixels, blockX, blockY)};
+      if (encoding == Encoding::BC3) {
+        encodeBC3Alpha(block, level.data);
+      }
+      encodeBC1Colors(block, level.data);
+    }
+  }
+  return level;
+}
+
+[[nodiscard]] abcg::KTX2Format getFormat(Encoding encoding, bool sRGB) {
+  using abcg::KTX2Format;
+  switch (encoding) {
+  case Encoding::RGBA8:
+    return sRGB ? KTX2Format::RGBA8Srgb : KTX2Format::RGBA8Unorm;
+  case Encoding::BC1:
+    return sRGB ? KTX2Format::BC1RGBSrgb : KTX2Format::BC1RGBUnorm;
+  case Encoding::BC3:
+    return sRGB ? KTX2Format::BC3Srgb : KTX2Format::BC3Unorm;
+  }
+  return KTX2Format::RGBA8Unorm;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    auto const options{parseOptions(argc, argv)};
+
+    auto const imageFlags{IMG_INIT_JPG | IMG_INIT_PNG};
+    if (auto const initialized{IMG_Init(imageFlags)};
+        (initialized & imageFlags) != imageFlags) {
+      throw abcg::SDLImageError("IMG_Init failed");
+    }
+
+    auto pixels{loadPixels(options)};
+
+    auto opaque{true};
+    for (auto const index : iter::range(std::size_t{3}, pixels.data.size(),
+                                        std::size_t{4})) {
+      opaque = opaque && pixels.data.at(index) == 255;
+    }
+    auto const encoding{
+        options.encoding.value_or(opaque ? Encoding::BC1 : Encoding::BC3)};
+
+    abcg::KTX2Image image{.format = getFormat(encoding, options.sRGB),
+                          .levels = {}};
+    image.levels.push_back(encode(pixels, encoding));
+    if (options.generateMipmaps) {
+      while (pixels.width > 1 || pixels.height > 1) {
+        pixels = downsample(pixels, options.sRGB);
+        image.levels.push_back(encode(pixels, encoding));
+      }
+    }
+
+    abcg::saveKTX2(options.output, image);
+
+    auto const info{abcg::getKTX2FormatInfo(image.format).value()};
+    std::size_t size{};
+    for (auto const &level : image.levels) {
+      size += level.data.size();
+    }
+    fmt::print("{}: {}x{}, {} levels, {} bytes/block, {} bytes\n",
+               options.output, image.levels.front().width,
+               image.levels.front().height, image.levels.size(),
+               info.bytesPerBlock, size);
+
+    IMG_Quit();
+  } catch (std::exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
@@ -2,10 +2,13 @@
 
 layout(location = 0) in vec2 inPosition;
 
-uniform vec4 color;
-uniform float rotation;
-uniform float scale;
-uniform vec2 translation;
+// Per-object data, bound with a range of the uniform buffer before each draw
+layout(std140) uniform Object {
+  vec4 color;
+  vec2 translation;
+  float scale;
+  float rotation;
+};
 
 out vec4 fragColor;
 
@@ -0,0 +1,22 @@
+#version 300 es
+
+layout(location = 0) in vec2 inPosition;
+
+// Per-instance attributes
+layout(location = 1) in vec2 inTranslation;
+layout(location = 2) in float inScale;
+layout(location = 3) in float inRotation;
+layout(location = 4) in vec4 inColor;
+
+out vec4 fragColor;
+
+void main() {
+  float sinAngle = sin(inRotation);
+  float cosAngle = cos(inRotation);
+  vec2 rotated = vec2(inPosition.x * cosAngle - inPosition.y * sinAngle,
+                      inPosition.x * sinAngle + inPosition.y * cosAngle);
+
+  vec2 newPosition = rotated * inScale + inTranslation;
+  gl_Position = vec4(newPosition, 0, 1);
+  fragColor = inColor;
+}
@@ -1,50 +1,31 @@
 #ifndef BARREIRAS_HPP_
 #define BARREIRAS_HPP_
 
-#include <list>
 #include <random>
 
-#include "abcgOpenGL.hpp"
-
 #include "gamedata.hpp"
 #include "carrinho.hpp"
+#include "obstaclepool.hpp"
 
 class Barreiras {
 public:
-  void create(GLuint program, int quantity);
-  void paint();
-  void destroy();
-  void update(const Carrinho &carrinho, float deltaTime);
+  Barreiras();
 
-  struct Barreira {
-    GLuint m_VAO{};
-    GLuint m_VBO{};
-    GLuint m_EBO{};
-
-    float m_angularVelocity{};
-    glm::vec4 m_color{1};
-    int m_polygonSides{};
-    float m_rotation{};
-    float m_scale{};
-    glm::vec2 m_translation{};
-    glm::vec2 m_velocity{};
-    bool m_hit{};
-  };
+  void seed(unsigned int seed);
+  void spawn(int quantity);
+  void clear();
+  void update(const Carrinho &carrinho, float deltaTime);
 
-  std::list<Barreira> m_barreiras;
+  ObstaclePool m_barreiras;
 
-  Barreira makeBarreira(glm::vec2 translation = {}, float scale = 0.25f);
+  ObstaclePool::Handle makeBarreira(glm::vec2 translation = {},
+                                    float scale = 0.25f);
 
 private:
-  GLuint m_program{};
-  GLint m_colorLoc{};
-  GLint m_rotationLoc{};
-  GLint m_translationLoc{};
-  GLint m_scaleLoc{};
-  GLuint m_EBO{};
+  constexpr static std::size_t m_initialCapacity{64};
 
   std::default_random_engine m_randomEngine;
   std::uniform_real_distribution<float> m_randomDist{-0.8f, +0.8f};
 };
 
-#endif
\ No newline at end of file
+#endif
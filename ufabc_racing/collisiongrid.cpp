@@ -0,0 +1,74 @@
+#include "collisiongrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+void CollisionGrid::build(std::span<float const> xs, std::span<float const> ys,
+                          std::span<float const> sizes, float cellSize) {
+  m_entries.clear();
+  m_x.clear();
+  m_y.clear();
+  m_size.clear();
+  m_cellStart.assign(1, 0);
+  if (ys.empty())
+    return;
+
+  auto const [minY, maxY]{std::ranges::minmax(ys)};
+  m_minY = minY;
+  m_maxY = maxY;
+
+  // Never use more rows than objects, so sparse scenes stay cheap to build
+  auto const maxCells{ys.size()};
+  auto cells{gsl::narrow_cast<std::size_t>((maxY - minY) / cellSize) + 1};
+  if (cells > maxCells) {
+    cells = maxCells;
+    cellSize = (maxY - minY) / gsl::narrow_cast<float>(cells);
+  }
+  m_cellSize = std::max(cellSize, 1e-6f);
+
+  // Count the objects of each row
+  m_cellStart.assign(cells + 1, 0);
+  for (auto const y : ys) {
+    ++m_cellStart[cellOf(y) + 1];
+  }
+
+  // Turn counts into the first entry of each row
+  for (auto const cell : iter::range(cells)) {
+    m_cellStart[cell + 1] += m_cellStart[cell];
+  }
+
+  // Scatter the objects into their rows
+  m_cursor.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+  m_entries.resize(ys.size());
+  m_x.resize(ys.size());
+  m_y.resize(ys.size());
+  m_size.resize(ys.size());
+  for (auto const index : iter::range(ys.size())) {
+    auto const sorted{m_cursor[cellOf(ys[index])]++};
+    m_entries[sorted] = gsl::narrow_cast<std::uint32_t>(index);
+    m_x[sorted] = xs[index];
+    m_y[sorted] = ys[index];
+    m_size[sorted] = sizes[index];
+  }
+}
+
+CollisionGrid::Range CollisionGrid::query(float minY, float maxY) const {
+  if (m_entries.empty() || maxY < m_minY || minY > m_maxY)
+    return {};
+
+  auto const first{m_cellStart[cellOf(minY)]};
+  auto const last{m_cellStart[cellOf(maxY) + 1]};
+  return {.first = first, .count = last - first};
+}
+
+std::size_t CollisionGrid::cellOf(float y) const {
+  // Clamp so that queries partially outside the grid still hit the border rows
+  auto const cells{m_cellStart.size() - 1};
+  auto const cell{std::floor((y - m_minY) / m_cellSize)};
+  if (cell <= 0.0f)
+    return 0;
+  return std::min(gsl::narrow_cast<std::size_t>(cell), cells - 1);
+}
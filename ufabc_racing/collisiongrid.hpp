@@ -0,0 +1,56 @@
+#ifndef COLLISIONGRID_HPP_
+#define COLLISIONGRID_HPP_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Broad phase for collision checks, made of uniform rows along the Y axis.
+//
+// Everything in the game scrolls vertically, so bucketing by Y alone already
+// discards almost all far-away objects. build() sorts the objects by row with
+// a counting sort and keeps sorted copies of their x, y and size, so the
+// candidates of any Y interval form one contiguous range that the narrow
+// phase can stream through. Storage is reused between builds and only grows.
+class CollisionGrid {
+public:
+  struct Range {
+    std::size_t first{};
+    std::size_t count{};
+  };
+
+  void build(std::span<float const> xs, std::span<float const> ys,
+             std::span<float const> sizes, float cellSize);
+
+  // Sorted positions of the objects whose center may lie within [minY, maxY].
+  // The caller must widen the interval by the largest object radius.
+  [[nodiscard]] Range query(float minY, float maxY) const;
+
+  // Row-sorted copies of the data passed to build()
+  [[nodiscard]] std::span<float const> x() const { return m_x; }
+  [[nodiscard]] std::span<float const> y() const { return m_y; }
+  [[nodiscard]] std::span<float const> size() const { return m_size; }
+
+  // Original index of the object at a sorted position
+  [[nodiscard]] std::uint32_t index(std::size_t sorted) const {
+    return m_entries[sorted];
+  }
+
+private:
+  [[nodiscard]] std::size_t cellOf(float y) const;
+
+  float m_minY{};
+  float m_maxY{};
+  float m_cellSize{1.0f};
+
+  // Sorted positions m_cellStart[c] to m_cellStart[c + 1] - 1 are the objects
+  // of row c
+  std::vector<std::uint32_t> m_cellStart;
+  std::vector<std::uint32_t> m_cursor;
+  std::vector<std::uint32_t> m_entries;
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_size;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "collisionkernel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if !defined(__EMSCRIPTEN__) && (defined(__x86_64__) || defined(_M_X64))
+#define COLLISION_KERNEL_SSE
+#include <immintrin.h>
+#if defined(__GNUC__)
+// GCC and Clang can compile AVX2 code for a single function and check the CPU
+// at runtime
+#define COLLISION_KERNEL_AVX2
+#endif
+#endif
+
+namespace {
+
+using Kernel = std::size_t (*)(glm::vec2, float, std::span<float const>,
+                               std::span<float const>, std::span<float const>,
+                               float, std::span<std::uint64_t>);
+using FindKernel = std::size_t (*)(glm::vec2, float, std::span<float const>,
+                                   std::span<float const>,
+                                   std::span<float const>, float);
+
+// Scalar test of obstacles [first, xs.size())
+std::size_t collideTail(std::size_t first, glm::vec2 center, float radius,
+                        std::span<float const> xs, std::span<float const> ys,
+                        std::span<float const> sizes, float sizeToRadius,
+                        std::span<std::uint64_t> hitMask) {
+  std::size_t hits{};
+  for (auto index{first}; index < xs.size(); ++index) {
+    auto const dx{xs[index] - center.x};
+    auto const dy{ys[index] - center.y};
+    auto const r{radius + sizes[index] * sizeToRadius};
+    if (dx * dx + dy * dy < r * r) {
+      hitMask[index / 64] |= std::uint64_t{1} << (index % 64);
+      ++hits;
+    }
+  }
+  return hits;
+}
+
+// Scalar search of obstacles [first, xs.size())
+std::size_t findTail(std::size_t first, glm::vec2 center, float radius,
+                     std::span<float const> xs, std::span<float const> ys,
+                     std::span<float const> sizes, float sizeToRadius) {
+  for (auto index{first}; index < xs.size(); ++index) {
+    auto const dx{xs[index] - center.x};
+    auto const dy{ys[index] - center.y};
+    auto const r{radius + sizes[index] * sizeToRadius};
+    if (dx * dx + dy * dy < r * r)
+      return index;
+  }
+  return xs.size();
+}
+
+#if defined(COLLISION_KERNEL_SSE)
+std::size_t collideSSE(glm::vec2 center, float radius,
+                       std::span<float const> xs, std::span<float const> ys,
+                       std::span<float const> sizes, float sizeToRadius,
+                       std::span<std::uint64_t> hitMask) {
+  auto const cx{_mm_set1_ps(center.x)};
+  auto const cy{_mm_set1_ps(center.y)};
+  auto const r0{_mm_set1_ps(radius)};
+  auto const k{_mm_set1_ps(sizeToRadius)};
+
+  std::size_t hits{};
+  std::size_t index{};
+  for (; index + 4 <= xs.size(); index += 4) {
+    auto const dx{_mm_sub_ps(_mm_loadu_ps(&xs[index]), cx)};
+    auto const dy{_mm_sub_ps(_mm_loadu_ps(&ys[index]), cy)};
+    auto const r{_mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(&sizes[index]), k))};
+    auto const distance2{_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))};
+    auto const bits{static_cast<std::uint32_t>(
+        _mm_movemask_ps(_mm_cmplt_ps(distance2, _mm_mul_ps(r, r))))};
+
+    // 4-bit groups never straddle two 64-bit words
+    hitMask[index / 64] |= std::uint64_t{bits} << (index % 64);
+    hits += static_cast<std::size_t>(std::popcount(bits));
+  }
+
+  return hits + collideTail(index, center, radius, xs, ys, sizes,
+                            sizeToRadius, hitMask);
+}
+
+std::size_t findSSE(glm::vec2 center, float radius, std::span<float const> xs,
+                    std::span<float const> ys, std::span<float const> sizes,
+                    float sizeToRadius) {
+  auto const cx{_mm_set1_ps(center.x)};
+  auto const cy{_mm_set1_ps(center.y)};
+  auto const r0{_mm_set1_ps(radius)};
+  auto const k{_mm_set1_ps(sizeToRadius)};
+
+  std::size_t index{};
+  for (; index + 4 <= xs.size(); index += 4) {
+    auto const dx{_mm_sub_ps(_mm_loadu_ps(&xs[index]), cx)};
+    auto const dy{_mm_sub_ps(_mm_loadu_ps(&ys[index]), cy)};
+    auto const r{_mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(&sizes[index]), k))};
+    auto const distance2{_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))};
+    auto const bits{static_cast<std::uint32_t>(
+        _mm_movemask_ps(_mm_cmplt_ps(distance2, _mm_mul_ps(r, r))))};
+    if (bits != 0)
+      return index + static_cast<std::size_t>(std::countr_zero(bits));
+  }
+
+  return findTail(index, center, radius, xs, ys, sizes, sizeToRadius);
+}
+#endif
+
+#if defined(COLLISION_KERNEL_AVX2)
+__attribute__((target("avx2"))) std::size_t
+collideAVX2(glm::vec2 center, float radius, std::span<float const> xs,
+            std::span<float const> ys, std::span<float const> sizes,
+            float sizeToRadius, std::span<std::uint64_t> hitMask) {
+  auto const cx{_mm256_set1_ps(center.x)};
+  auto const cy{_mm256_set1_ps(center.y)};
+  auto const r0{_mm256_set1_ps(radius)};
+  auto const k{_mm256_set1_ps(sizeToRadius)};
+
+  std::size_t hits{};
+  std::size_t index{};
+  for (; index + 8 <= xs.size(); index += 8) {
+    // No FMA, so results match the scalar and SSE versions bit for bit
+    auto const dx{_mm256_sub_ps(_mm256_loadu_ps(&xs[index]), cx)};
+    auto const dy{_mm256_sub_ps(_mm256_loadu_ps(&ys[index]), cy)};
+    auto const r{
+        _mm256_add_ps(r0, _mm256_mul_ps(_mm256_loadu_ps(&sizes[index]), k))};
+    auto const distance2{
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))};
+    auto const bits{static_cast<std::uint32_t>(_mm256_movemask_ps(
+        _mm256_cmp_ps(distance2, _mm256_mul_ps(r, r), _CMP_LT_OQ)))};
+
+    // 8-bit groups never straddle two 64-bit words
+    hitMask[index / 64] |= std::uint64_t{bits} << (index % 64);
+    hits += static_cast<std::size_t>(std::popcount(bits));
+  }
+
+  // The tail is compiled without AVX. Clearing the upper halves of the
+  // registers first avoids the AVX-SSE transition penalty
+  _mm256_zeroupper();
+
+  return hits + collideTail(index, center, radius, xs, ys, sizes,
+                            sizeToRadius, hitMask);
+}
+
+__attribute__((target("avx2"))) std::size_t
+findAVX2(glm::vec2 center, float radius, std::span<float const> xs,
+         std::span<float const> ys, std::span<float const> sizes,
+         float sizeToRadius) {
+  auto const cx{_mm256_set1_ps(center.x)};
+  auto const cy{_mm256_set1_ps(center.y)};
+  auto const r0{_mm256_set1_ps(radius)};
+  auto const k{_mm256_set1_ps(sizeToRadius)};
+
+  std::size_t index{};
+  for (; index + 8 <= xs.size(); index += 8) {
+    auto const dx{_mm256_sub_ps(_mm256_loadu_ps(&xs[index]), cx)};
+    auto const dy{_mm256_sub_ps(_mm256_loadu_ps(&ys[index]), cy)};
+    auto const r{
+        _mm256_add_ps(r0, _mm256_mul_ps(_mm256_loadu_ps(&sizes[index]), k))};
+    auto const distance2{
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))};
+    auto const bits{static_cast<std::uint32_t>(_mm256_movemask_ps(
+        _mm256_cmp_ps(distance2, _mm256_mul_ps(r, r), _CMP_LT_OQ)))};
+    if (bits != 0)
+      return index + static_cast<std::size_t>(std::countr_zero(bits));
+  }
+
+  // Same as in collideAVX2
+  _mm256_zeroupper();
+
+  return findTail(index, center, radius, xs, ys, sizes, sizeToRadius);
+}
+#endif
+
+struct Dispatch {
+  Kernel kernel;
+  FindKernel find;
+  std::string_view name;
+};
+
+Dispatch selectKernel() {
+#if defined(COLLISION_KERNEL_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    return {collideAVX2, findAVX2, "AVX2"};
+#endif
+#if defined(COLLISION_KERNEL_SSE)
+  // SSE2 is part of the x86-64 baseline
+  return {collideSSE, findSSE, "SSE"};
+#else
+  return {collideCirclesScalar, findCircleCollisionScalar, "scalar"};
+#endif
+}
+
+Dispatch const &dispatch() {
+  static Dispatch const selected{selectKernel()};
+  return selected;
+}
+
+} // namespace
+
+std::size_t collideCircles(glm::vec2 center, float radius,
+                           std::span<float const> xs,
+                           std::span<float const> ys,
+                           std::span<float const> sizes, float sizeToRadius,
+                           std::span<std::uint64_t> hitMask) {
+  std::fill_n(hitMask.begin(), (xs.size() + 63) / 64, 0);
+  return dispatch().kernel(center, radius, xs, ys, sizes, sizeToRadius,
+                           hitMask);
+}
+
+std::size_t collideCirclesScalar(glm::vec2 center, float radius,
+                                 std::span<float const> xs,
+                                 std::span<float const> ys,
+                                 std::span<float const> sizes,
+                                 float sizeToRadius,
+                                 std::span<std::uint64_t> hitMask) {
+  std::fill_n(hitMask.begin(), (xs.size() + 63) / 64, 0);
+  return collideTail(0, center, radius, xs, ys, sizes, sizeToRadius,
+                     hitMask);
+}
+
+std::size_t findCircleCollision(glm::vec2 center, float radius,
+                                std::span<float const> xs,
+                                std::span<float const> ys,
+                                std::span<float const> sizes,
+                                float sizeToRadius) {
+  return dispatch().find(center, radius, xs, ys, sizes, sizeToRadius);
+}
+
+std::size_t findCircleCollisionScalar(glm::vec2 center, float radius,
+                                      std::span<float const> xs,
+                                      std::span<float const> ys,
+                                      std::span<float const> sizes,
+                                      float sizeToRadius) {
+  return findTail(0, center, radius, xs, ys, sizes, sizeToRadius);
+}
+
+std::string_view collisionKernelName() { return dispatch().name; }
@@ -0,0 +1,57 @@
+#ifndef COLLISIONKERNEL_HPP_
+#define COLLISIONKERNEL_HPP_
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <glm/vec2.hpp>
+
+// Narrow-phase test of one circle against a packed array of circles.
+//
+// Obstacle i is the circle at (xs[i], ys[i]) with radius
+// sizes[i] * sizeToRadius. Bit i of hitMask (bit i % 64 of word i / 64) is
+// set if it overlaps the circle at center with the given radius. hitMask must
+// hold at least (xs.size() + 63) / 64 words.
+//
+// collideCircles dispatches at runtime to an AVX2 (8 lanes) or SSE (4 lanes)
+// implementation when available, or to the scalar one otherwise, as in the
+// Emscripten build. All of them give the same results.
+//
+// Returns the number of hits.
+std::size_t collideCircles(glm::vec2 center, float radius,
+                           std::span<float const> xs,
+                           std::span<float const> ys,
+                           std::span<float const> sizes, float sizeToRadius,
+                           std::span<std::uint64_t> hitMask);
+
+// Same as collideCircles, always using the scalar implementation
+std::size_t collideCirclesScalar(glm::vec2 center, float radius,
+                                 std::span<float const> xs,
+                                 std::span<float const> ys,
+                                 std::span<float const> sizes,
+                                 float sizeToRadius,
+                                 std::span<std::uint64_t> hitMask);
+
+// Same test as collideCircles, but stops at the first overlapping obstacle
+// instead of building a hit mask. Uses the same implementation as
+// collideCircles.
+//
+// Returns the index of the first obstacle hit, or xs.size() if there is none.
+std::size_t findCircleCollision(glm::vec2 center, float radius,
+                                std::span<float const> xs,
+                                std::span<float const> ys,
+                                std::span<float const> sizes,
+                                float sizeToRadius);
+
+// Same as findCircleCollision, always using the scalar implementation
+std::size_t findCircleCollisionScalar(glm::vec2 center, float radius,
+                                      std::span<float const> xs,
+                                      std::span<float const> ys,
+                                      std::span<float const> sizes,
+                                      float sizeToRadius);
+
+// Name of the implementation selected by collideCircles
+std::string_view collisionKernelName();
+
+#endif
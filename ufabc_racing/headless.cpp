@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+#include <glm/geometric.hpp>
+
+#include "collisionkernel.hpp"
+#include "simulation.hpp"
+
+namespace {
+
+// Times the car-vs-obstacles narrow phase over `count` obstacles: the
+// glm::distance loop that the kernel replaced, the scalar kernel and the
+// kernel selected at runtime, with and without the early exit
+void benchmarkCollision(std::size_t count) {
+  std::default_random_engine randomEngine{1};
+  std::uniform_real_distribution<float> randomX{-1.0f, 1.0f};
+  std::uniform_real_distribution<float> randomY{-1.5f, 1.5f};
+
+  std::vector<float> xs(count);
+  std::vector<float> ys(count);
+  std::vector<float> const scales(count, 0.25f);
+  for (auto &x : xs)
+    x = randomX(randomEngine);
+  for (auto &y : ys)
+    y = randomY(randomEngine);
+
+  std::vector<glm::vec2> cars(256);
+  for (auto &car : cars)
+    car = {randomX(randomEngine), randomY(randomEngine)};
+
+  std::vector<std::uint64_t> hitMask((count + 63) / 64);
+  auto const carRadius{0.1f * 0.9f};
+
+  // Repeat until about 100 million pairs have been tested
+  auto const repetitions{std::max<std::size_t>(1, 100'000'000 / count)};
+
+  auto const run{[&](std::string_view name, auto &&test, double baseline) {
+    std::size_t hits{};
+    auto const start{std::chrono::steady_clock::now()};
+    for (std::size_t repetition{}; repetition < repetitions; ++repetition) {
+      hits += test(cars[repetition % cars.size()]);
+    }
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start};
+    auto const nanoseconds{elapsed.count() * 1e9 /
+                           static_cast<double>(repetitions * count)};
+    fmt::print("{:>14}: {:.3f} ns/obstacle, {:.2f}x, {} hits\n", name,
+               nanoseconds, baseline > 0.0 ? baseline / nanoseconds : 1.0,
+               hits);
+    return nanoseconds;
+  }};
+
+  fmt::print("{} obstacles, {} repetitions\n", count, repetitions);
+
+  auto const baseline{run(
+      "glm::distance",
+      [&](glm::vec2 car) {
+        std::size_t hits{};
+        for (std::size_t index{}; index < count; ++index) {
+          auto const distance{glm::distance(car, {xs[index], ys[index]})};
+          if (distance < carRadius + scales[index] * 0.85f)
+            ++hits;
+        }
+        return hits;
+      },
+      0.0)};
+  run(
+      "scalar",
+      [&](glm::vec2 car) {
+        return collideCirclesScalar(car, carRadius, xs, ys, scales, 0.85f,
+                                    hitMask);
+      },
+      baseline);
+  run(
+      collisionKernelName(),
+      [&](glm::vec2 car) {
+        return collideCircles(car, carRadius, xs, ys, scales, 0.85f, hitMask);
+      },
+      baseline);
+
+  // Early exit on the first hit, as in Simulation::checkCollisions. Each
+  // repetition counts at most one hit
+  run(
+      "scalar first",
+      [&](glm::vec2 car) {
+        return findCircleCollisionScalar(car, carRadius, xs, ys, scales,
+                                         0.85f) < count
+                   ? 1
+                   : 0;
+      },
+      baseline);
+  run(
+      fmt::format("{} first", collisionKernelName()),
+      [&](glm::vec2 car) {
+        return findCircleCollision(car, carRadius, xs, ys, scales, 0.85f) <
+                       count
+                   ? 1
+                   : 0;
+      },
+      baseline);
+}
+
+// Picks the x the carrinho should head to in order to dodge the barreiras
+// falling towards it. Each candidate column is probed from just below the
+// carrinho up to where the barreiras spawn, with the same collision kernel as
+// the simulation. The column with fewest hits wins, preferring the closest to
+// the carrinho
+float chooseTargetX(Simulation const &simulation,
+                    std::vector<std::uint64_t> &hitMask) {
+  auto const &pool{simulation.m_barreiras.m_barreiras};
+  auto const position{simulation.m_carrinho.m_translation};
+  if (pool.empty())
+    return position.x;
+
+  // Leave some room to steer around the barreiras
+  auto const radius{simulation.m_carrinho.m_scale * 0.9f + 0.08f};
+  hitMask.resize((pool.size() + 63) / 64);
+
+  auto bestX{position.x};
+  auto bestHits{std::numeric_limits<std::size_t>::max()};
+  auto bestDistance{std::numeric_limits<float>::max()};
+  auto const test{[&](float x) {
+    std::size_t hits{};
+    for (int probe{-2}; probe <= 20; ++probe) {
+      glm::vec2 const center{x, position.y + static_cast<float>(probe) * 0.1f};
+      hits += collideCircles(center, radius, pool.x(), pool.y(), pool.scale(),
+                             0.85f, hitMask);
+    }
+    auto const distance{std::abs(x - position.x)};
+    if (hits < bestHits || (hits == bestHits && distance < bestDistance)) {
+      bestX = x;
+      bestHits = hits;
+      bestDistance = distance;
+    }
+  }};
+
+  test(position.x);
+  for (int column{-9}; column <= 9; ++column) {
+    test(static_cast<float>(column) * 0.1f);
+  }
+  return bestX;
+}
+
+void printUsage() {
+  fmt::print(
+      stderr,
+      "Usage: ufabc_racing_headless [ticks] [seed] [win score]\n"
+      "       ufabc_racing_headless --flood barreiras [ticks] [seed]\n"
+      "       ufabc_racing_headless --bench-collision [obstacles]\n");
+}
+
+using GameInput = decltype(GameData::m_input);
+
+// Same step as the default abcg::WindowSettings::fixedUpdateRate
+constexpr float deltaTime{1.0f / 60.0f};
+
+struct RunStats {
+  // Games lost, or ticks with a collision when flooding
+  long long gameOvers{};
+  long long wins{};
+  std::size_t peakBarreiras{};
+};
+
+// Steps the simulation once for each recorded input. With `flood` > 0, the
+// pool is topped up to `flood` barreiras, and neither collisions nor the score
+// end the game or grow the waves. The barreiras then accumulate past the
+// linear scan limit of the collision broad phase
+RunStats replay(Simulation &simulation, std::vector<GameInput> const &inputs,
+                std::size_t flood) {
+  // Barreiras fall off the screen in 2.5 s (150 steps), so spreading the
+  // top-ups over that time keeps them spread over the screen
+  auto const floodRate{(flood + 149) / 150};
+
+  RunStats stats;
+  auto &pool{simulation.m_barreiras.m_barreiras};
+  auto &state{simulation.m_gameData.m_state};
+  auto previousState{state};
+  for (auto const &input : inputs) {
+    simulation.m_gameData.m_input = input;
+    if (pool.size() < flood) {
+      simulation.m_barreiras.spawn(
+          static_cast<int>(std::min(floodRate, flood - pool.size())));
+    }
+
+    simulation.step(deltaTime);
+
+    if (state != previousState) {
+      if (state == State::GameOver)
+        ++stats.gameOvers;
+      else if (state == State::Win)
+        ++stats.wins;
+      previousState = state;
+    }
+    if (flood > 0) {
+      state = State::Playing;
+      previousState = state;
+      simulation.score = 0;
+    }
+    stats.peakBarreiras = std::max(stats.peakBarreiras, pool.size());
+  }
+  return stats;
+}
+
+} // namespace
+
+// Runs the game simulation at full speed without a window or graphics
+// context. The input of each tick is first recorded from an autopilot that
+// dodges the barreiras, then replayed on a fresh simulation with the same
+// seed. Only the replay is timed, so the ticks per second measure the update
+// and collision checks alone.
+//
+// Usage: ufabc_racing_headless [ticks] [seed] [win score]
+//        ufabc_racing_headless --flood barreiras [ticks] [seed]
+//        ufabc_racing_headless --bench-collision [obstacles]
+int main(int argc, char **argv) {
+  try {
+    if (argc > 1 && std::string_view{argv[1]} == "--bench-collision") {
+      auto const count{argc > 2 ? std::stoll(argv[2]) : 10'000};
+      if (count <= 0) {
+        printUsage();
+        return -1;
+      }
+      benchmarkCollision(static_cast<std::size_t>(count));
+      return 0;
+    }
+
+    // With --flood, the carrinho just drives straight on
+    long long flood{};
+    auto argument{1};
+    if (argc > 1 && std::string_view{argv[1]} == "--flood") {
+      flood = argc > 2 ? std::stoll(argv[2]) : 0;
+      if (flood <= 0) {
+        printUsage();
+        return -1;
+      }
+      argument = 3;
+    }
+
+    long long ticks{1'000'000};
+    unsigned int seed{1};
+    int winScore{10};
+    if (argc > argument)
+      ticks = std::stoll(argv[argument]);
+    if (argc > argument + 1)
+      seed = static_cast<unsigned int>(std::stoul(argv[argument + 1]));
+    if (argc > argument + 2 && flood == 0)
+      winScore = std::stoi(argv[argument + 2]);
+    auto const maxArgc{flood > 0 ? argument + 2 : argument + 3};
+    if (ticks <= 0 || winScore <= 0 || argc > maxArgc) {
+      printUsage();
+      return -1;
+    }
+
+    auto const makeSimulation{[&] {
+      Simulation simulation;
+      simulation.seed(seed);
+      // A higher win score keeps each game going, so the waves of barreiras
+      // keep growing
+      simulation.m_winScore = winScore;
+      simulation.restart();
+      return simulation;
+    }};
+
+    std::vector<GameInput> inputs(static_cast<std::size_t>(ticks));
+    if (flood == 0) {
+      // Record the autopilot. The simulation is deterministic, so the replay
+      // takes the same decisions without paying for them
+      auto recording{makeSimulation()};
+      std::vector<std::uint64_t> hitMask;
+      for (auto &input : inputs) {
+        // Steer towards the clearest column
+        auto const targetX{chooseTargetX(recording, hitMask)};
+        auto const x{recording.m_carrinho.m_translation.x};
+        if (x > targetX + 0.05f)
+          input.set(static_cast<size_t>(Input::Left));
+        else if (x < targetX - 0.05f)
+          input.set(static_cast<size_t>(Input::Right));
+        recording.m_gameData.m_input = input;
+        recording.step(deltaTime);
+      }
+    }
+
+    auto simulation{makeSimulation()};
+    auto const start{std::chrono::steady_clock::now()};
+    auto const stats{
+        replay(simulation, inputs, static_cast<std::size_t>(flood))};
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start};
+
+    fmt::print("{} ticks in {:.3f} s ({:.0f} ticks/s)\n", ticks,
+               elapsed.count(), static_cast<double>(ticks) / elapsed.count());
+    if (flood > 0) {
+      fmt::print("{} ticks with collisions, peak of {} barreiras\n",
+                 stats.gameOvers, stats.peakBarreiras);
+    } else {
+      fmt::print("{} game overs, {} wins, peak of {} barreiras\n",
+                 stats.gameOvers, stats.wins, stats.peakBarreiras);
+    }
+  } catch (std::logic_error const &) {
+    // Thrown by std::stoll and friends for non-numeric or out of range values
+    printUsage();
+    return -1;
+  } catch (std::exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
@@ -4,8 +4,16 @@ int main(int argc, char **argv) {
   try {
     abcg::Application app(argc, argv);
 
+    // Program binaries are cached per user, since the application directory
+    // may not be writable
+    auto const userDataPath{
+        abcg::Application::getUserDataPath("UFABC", "UFABC Racing")};
+
     Window window;
-    window.setOpenGLSettings({.samples = 16});
+    window.setOpenGLSettings(
+        {.samples = 16,
+         .programCachePath =
+             userDataPath.empty() ? "" : userDataPath + "program_cache"});
     window.setWindowSettings({
         .width = 900,
         .height = 900,
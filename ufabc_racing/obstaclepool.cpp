@@ -0,0 +1,98 @@
+#include "obstaclepool.hpp"
+
+#include <gsl/gsl>
+
+void ObstaclePool::reserve(std::size_t capacity) {
+  m_x.reserve(capacity);
+  m_y.reserve(capacity);
+  m_previousY.reserve(capacity);
+  m_scale.reserve(capacity);
+  m_color.reserve(capacity);
+  m_denseToSlot.reserve(capacity);
+  m_slotToDense.reserve(capacity);
+  m_generation.reserve(capacity);
+  m_freeSlots.reserve(capacity);
+}
+
+void ObstaclePool::clear() {
+  // Release every live slot, keeping the capacity of all arrays
+  while (!empty()) {
+    removeAt(size() - 1);
+  }
+}
+
+ObstaclePool::Handle ObstaclePool::spawn(glm::vec2 position, float scale,
+                                         glm::vec4 color) {
+  std::uint32_t slot{};
+  if (m_freeSlots.empty()) {
+    slot = gsl::narrow<std::uint32_t>(m_slotToDense.size());
+    m_slotToDense.push_back(0);
+    m_generation.push_back(0);
+  } else {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  }
+
+  m_slotToDense.at(slot) = gsl::narrow<std::uint32_t>(m_x.size());
+  m_x.push_back(position.x);
+  m_y.push_back(position.y);
+  // A new obstacle has no previous position, so it starts at rest
+  m_previousY.push_back(position.y);
+  m_scale.push_back(scale);
+  m_color.push_back(color);
+  m_denseToSlot.push_back(slot);
+
+  return {.slot = slot, .generation = m_generation.at(slot)};
+}
+
+bool ObstaclePool::despawn(Handle handle) {
+  if (!isAlive(handle))
+    return false;
+
+  removeAt(m_slotToDense.at(handle.slot));
+  return true;
+}
+
+bool ObstaclePool::isAlive(Handle handle) const {
+  // Freeing a slot bumps its generation, invalidating older handles
+  return handle.slot < m_generation.size() &&
+         m_generation[handle.slot] == handle.generation;
+}
+
+void ObstaclePool::despawnBelow(float minY) {
+  // Iterate backwards so that swapping the last element into a removed
+  // position never skips an unvisited obstacle
+  for (auto index{size()}; index > 0; --index) {
+    if (m_y[index - 1] < minY) {
+      removeAt(index - 1);
+    }
+  }
+}
+
+void ObstaclePool::removeAt(std::size_t denseIndex) {
+  auto const slot{m_denseToSlot[denseIndex]};
+  auto const last{size() - 1};
+
+  // Move the last obstacle into the hole to keep the arrays packed
+  if (denseIndex != last) {
+    m_x[denseIndex] = m_x[last];
+    m_y[denseIndex] = m_y[last];
+    m_previousY[denseIndex] = m_previousY[last];
+    m_scale[denseIndex] = m_scale[last];
+    m_color[denseIndex] = m_color[last];
+    m_denseToSlot[denseIndex] = m_denseToSlot[last];
+    m_slotToDense[m_denseToSlot[denseIndex]] =
+        gsl::narrow<std::uint32_t>(denseIndex);
+  }
+
+  m_x.pop_back();
+  m_y.pop_back();
+  m_previousY.pop_back();
+  m_scale.pop_back();
+  m_color.pop_back();
+  m_denseToSlot.pop_back();
+
+  // Invalidate outstanding handles and recycle the slot
+  ++m_generation[slot];
+  m_freeSlots.push_back(slot);
+}
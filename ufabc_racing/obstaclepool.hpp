@@ -0,0 +1,69 @@
+#ifndef OBSTACLEPOOL_HPP_
+#define OBSTACLEPOOL_HPP_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+// Structure-of-arrays store of obstacles.
+//
+// Live obstacles are kept densely packed in separate arrays so that hot loops
+// (movement, collision, instance upload) stream through contiguous memory.
+// Handles refer to slots that stay valid while the obstacle is alive, even
+// though despawning moves the last obstacle into the freed dense position.
+// Freed slots are recycled through a free-list, so once the pool reaches its
+// peak size spawning and despawning do not allocate.
+class ObstaclePool {
+public:
+  struct Handle {
+    std::uint32_t slot{};
+    std::uint32_t generation{};
+  };
+
+  void reserve(std::size_t capacity);
+  void clear();
+
+  Handle spawn(glm::vec2 position, float scale, glm::vec4 color);
+  bool despawn(Handle handle);
+  [[nodiscard]] bool isAlive(Handle handle) const;
+
+  // Removes every obstacle whose y coordinate is below minY
+  void despawnBelow(float minY);
+
+  [[nodiscard]] std::size_t size() const { return m_x.size(); }
+  [[nodiscard]] bool empty() const { return m_x.empty(); }
+
+  // Dense arrays, indexed from 0 to size() - 1
+  [[nodiscard]] std::span<float> x() { return m_x; }
+  [[nodiscard]] std::span<float> y() { return m_y; }
+  [[nodiscard]] std::span<float> previousY() { return m_previousY; }
+  [[nodiscard]] std::span<float const> x() const { return m_x; }
+  [[nodiscard]] std::span<float const> y() const { return m_y; }
+  [[nodiscard]] std::span<float const> previousY() const {
+    return m_previousY;
+  }
+  [[nodiscard]] std::span<float const> scale() const { return m_scale; }
+  [[nodiscard]] std::span<glm::vec4 const> color() const { return m_color; }
+
+private:
+  void removeAt(std::size_t denseIndex);
+
+  // Dense, per-obstacle data
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  // y coordinate at the previous update, used to interpolate when rendering
+  std::vector<float> m_previousY;
+  std::vector<float> m_scale;
+  std::vector<glm::vec4> m_color;
+  std::vector<std::uint32_t> m_denseToSlot;
+
+  // Sparse, per-slot data
+  std::vector<std::uint32_t> m_slotToDense;
+  std::vector<std::uint32_t> m_generation;
+  std::vector<std::uint32_t> m_freeSlots;
+};
+
+#endif
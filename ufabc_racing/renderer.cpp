@@ -0,0 +1,232 @@
+#include "renderer.hpp"
+
+#include <cppitertools/itertools.hpp>
+
+void Renderer::create(GLuint objectsProgram, GLuint instancedProgram,
+                      abcg::OpenGLMeshRegistry &meshes) {
+  destroy();
+
+  m_objectsProgram = objectsProgram;
+  m_instancedProgram = instancedProgram;
+  m_meshes = &meshes;
+
+  createCarrinho(meshes);
+  createBarreiras(meshes);
+}
+
+void Renderer::createCarrinho(abcg::OpenGLMeshRegistry &meshes) {
+  // The block binding is set once; paint only binds a range of the buffer
+  m_objectBlocks.create(sizeof(ObjectBlock));
+  m_objectBlocks.bindBlock(m_objectsProgram, "Object", m_objectBindingPoint);
+
+  // clang-format off
+  std::array positions{
+      // Carrinho body
+      glm::vec2{-10.0f, +06.0f}, glm::vec2{-10.0f, +09.0f},
+      glm::vec2{-10.0f, +12.0f}, glm::vec2{-04.0f, +12.0f},
+      glm::vec2{+04.0f, +12.0f}, glm::vec2{+10.0f, +12.0f},
+      glm::vec2{+10.0f, +09.0f}, glm::vec2{+10.0f, +06.0f},
+      glm::vec2{+04.0f, +09.0f}, glm::vec2{-04.0f, +09.0f},
+      glm::vec2{-04.0f, -06.0f}, glm::vec2{+04.0f, -06.0f},
+      glm::vec2{+04.0f, -08.0f}, glm::vec2{-04.0f, -08.0f},
+      glm::vec2{+09.0f, -08.0f}, glm::vec2{-09.0f, -08.0f},
+      glm::vec2{+09.0f, -12.0f}, glm::vec2{-09.0f, -12.0f},
+      };
+
+  for (auto &position : positions) {
+    position /= glm::vec2{10.0f, 10.0f}; 
+  }
+
+   auto const indices{std::to_array<GLuint>({0, 1, 9,
+                           1, 2, 9,
+                           2,3,9,
+                           3,9,8,
+                           4,3,8,
+                           4,5,6,
+                           4,6,8,
+                           6,7,8,
+                           9,10,11,
+                           8,9,11,
+                           10,11,12,
+                           10,13,12,
+                           14,16,17,
+                           14,15,17})};
+  // clang-format on
+
+  // Upload the shape only once; later calls reuse the same buffers
+  m_carrinhoMesh = meshes.add(
+      "carrinho", {.vertices = {&positions.front().x, positions.size() * 2},
+                   .componentsPerVertex = 2,
+                   .indices = indices});
+
+  // Get location of attributes in the program
+  auto const positionAttribute{
+      abcg::glGetAttribLocation(m_objectsProgram, "inPosition")};
+
+  // Create VAO
+  abcg::glGenVertexArrays(1, &m_carrinhoVAO);
+
+  // Bind vertex attributes to current VAO
+  abcg::glBindVertexArray(m_carrinhoVAO);
+
+  meshes.bindVertexAttribute(m_carrinhoMesh, positionAttribute);
+
+  // End of binding to current VAO
+  abcg::glBindVertexArray(0);
+}
+
+void Renderer::createBarreiras(abcg::OpenGLMeshRegistry &meshes) {
+  // Define os vértices da barreira com formato fixo
+  std::array positions{
+      glm::vec2{-3.0f, -1.0f}, glm::vec2{-3.0f, +1.0f},
+      glm::vec2{+3.0f, +1.0f}, glm::vec2{+3.0f, -1.0f},
+  };
+
+  // Normalize os vértices para escala
+  for (auto &position : positions) {
+    position /= glm::vec2{5.0f, 5.0f};
+  }
+
+  auto const indices{std::to_array<GLuint>({0, 1, 2,
+                                            0, 3, 2})};
+
+  // Upload the quad only once; later calls reuse the same buffers
+  m_barreiraMesh = meshes.add(
+      "barreira", {.vertices = {&positions.front().x, positions.size() * 2},
+                   .componentsPerVertex = 2,
+                   .indices = indices});
+
+  // Generate the instance VBO. Its storage is (re)allocated in paint()
+  abcg::glGenBuffers(1, &m_instanceVBO);
+  m_instanceCapacity = 0;
+
+  // Get location of attributes in the program
+  auto const positionAttribute{
+      abcg::glGetAttribLocation(m_instancedProgram, "inPosition")};
+  auto const translationAttribute{
+      abcg::glGetAttribLocation(m_instancedProgram, "inTranslation")};
+  auto const scaleAttribute{
+      abcg::glGetAttribLocation(m_instancedProgram, "inScale")};
+  auto const rotationAttribute{
+      abcg::glGetAttribLocation(m_instancedProgram, "inRotation")};
+  auto const colorAttribute{
+      abcg::glGetAttribLocation(m_instancedProgram, "inColor")};
+
+  // Create VAO
+  abcg::glGenVertexArrays(1, &m_barreirasVAO);
+
+  // Bind vertex attributes to current VAO
+  abcg::glBindVertexArray(m_barreirasVAO);
+
+  meshes.bindVertexAttribute(m_barreiraMesh, positionAttribute);
+
+  // Per-instance attributes advance once per instance instead of per vertex
+  auto const setupInstanceAttribute{[](GLint attribute, GLint size,
+                                       std::size_t offset) {
+    auto const location{gsl::narrow<GLuint>(attribute)};
+    abcg::glEnableVertexAttribArray(location);
+    abcg::glVertexAttribPointer(
+        location, size, GL_FLOAT, GL_FALSE, sizeof(Instance),
+        reinterpret_cast<void *>(offset)); // NOLINT(performance-no-int-to-ptr)
+    abcg::glVertexAttribDivisor(location, 1);
+  }};
+
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  setupInstanceAttribute(translationAttribute, 2,
+                         offsetof(Instance, translation));
+  setupInstanceAttribute(scaleAttribute, 1, offsetof(Instance, scale));
+  setupInstanceAttribute(rotationAttribute, 1, offsetof(Instance, rotation));
+  setupInstanceAttribute(colorAttribute, 4, offsetof(Instance, color));
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // End of binding to current VAO
+  abcg::glBindVertexArray(0);
+
+  m_instances.reserve(64);
+}
+
+void Renderer::paint(Simulation const &simulation, float alpha) {
+  paintBarreiras(simulation.m_barreiras, alpha);
+
+  if (simulation.m_gameData.m_state == State::Playing) {
+    paintCarrinho(simulation.m_carrinho, alpha);
+  }
+}
+
+void Renderer::paintCarrinho(Carrinho const &carrinho, float alpha) {
+  // All per-object blocks of the frame go to the GPU in a single upload
+  auto const carrinhoBlock{m_objectBlocks.push(ObjectBlock{
+      .color = carrinho.m_color,
+      .translation = glm::mix(carrinho.m_previousTranslation,
+                              carrinho.m_translation, alpha),
+      .scale = carrinho.m_scale,
+      .rotation = carrinho.m_rotation})};
+  m_objectBlocks.upload();
+
+  abcg::glUseProgram(m_objectsProgram);
+
+  abcg::glBindVertexArray(m_carrinhoVAO);
+
+  m_objectBlocks.bindRange(m_objectBindingPoint, carrinhoBlock);
+  m_meshes->draw(m_carrinhoMesh);
+
+  abcg::glBindVertexArray(0);
+
+  abcg::glUseProgram(0);
+}
+
+void Renderer::paintBarreiras(Barreiras const &barreiras, float alpha) {
+  auto const &pool{barreiras.m_barreiras};
+  if (pool.empty())
+    return;
+
+  // Gather the per-instance data of all barreiras. The y coordinate is
+  // interpolated between the last two updates
+  auto const xs{pool.x()};
+  auto const ys{pool.y()};
+  auto const previousYs{pool.previousY()};
+  auto const scales{pool.scale()};
+  auto const colors{pool.color()};
+  m_instances.clear();
+  for (auto const index : iter::range(pool.size())) {
+    m_instances.push_back({.translation = {xs[index],
+                                           glm::mix(previousYs[index],
+                                                    ys[index], alpha)},
+                           .scale = scales[index],
+                           .color = colors[index]});
+  }
+
+  // Stream the instance data. Orphaning the previous storage avoids stalling
+  // on draws of the previous frame that may still be reading from it
+  auto const instanceCount{m_instances.size()};
+  m_instanceCapacity = std::max(m_instanceCapacity, instanceCount);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  abcg::glBufferData(
+      GL_ARRAY_BUFFER,
+      gsl::narrow<GLsizeiptr>(m_instanceCapacity * sizeof(Instance)), nullptr,
+      GL_STREAM_DRAW);
+  abcg::glBufferSubData(
+      GL_ARRAY_BUFFER, 0,
+      gsl::narrow<GLsizeiptr>(instanceCount * sizeof(Instance)),
+      m_instances.data());
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  abcg::glUseProgram(m_instancedProgram);
+  abcg::glBindVertexArray(m_barreirasVAO);
+
+  m_meshes->draw(m_barreiraMesh, gsl::narrow<GLsizei>(instanceCount));
+
+  abcg::glBindVertexArray(0);
+  abcg::glUseProgram(0);
+}
+
+void Renderer::destroy() {
+  m_objectBlocks.destroy();
+  abcg::glDeleteBuffers(1, &m_instanceVBO);
+  abcg::glDeleteVertexArrays(1, &m_barreirasVAO);
+  abcg::glDeleteVertexArrays(1, &m_carrinhoVAO);
+  m_instanceVBO = 0;
+  m_barreirasVAO = 0;
+  m_carrinhoVAO = 0;
+  m_instanceCapacity = 0;
+}
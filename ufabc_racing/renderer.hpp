@@ -0,0 +1,62 @@
+#ifndef RENDERER_HPP_
+#define RENDERER_HPP_
+
+#include <vector>
+
+#include "abcgOpenGL.hpp"
+
+#include "simulation.hpp"
+
+// Draws the state of a Simulation. All OpenGL resources of the game objects
+// live here, so the simulation itself never touches the GPU.
+class Renderer {
+public:
+  void create(GLuint objectsProgram, GLuint instancedProgram,
+              abcg::OpenGLMeshRegistry &meshes);
+  void paint(Simulation const &simulation, float alpha);
+  void destroy();
+
+private:
+  // Per-instance attributes streamed to the instance VBO every frame
+  struct Instance {
+    glm::vec2 translation{};
+    float scale{};
+    float rotation{};
+    glm::vec4 color{1};
+  };
+
+  // std140 layout of the Object block of objects.vert
+  struct ObjectBlock {
+    glm::vec4 color{1};
+    glm::vec2 translation{};
+    float scale{};
+    float rotation{};
+  };
+  static_assert(sizeof(ObjectBlock) == 32);
+
+  constexpr static GLuint m_objectBindingPoint{0};
+
+  void createCarrinho(abcg::OpenGLMeshRegistry &meshes);
+  void createBarreiras(abcg::OpenGLMeshRegistry &meshes);
+  void paintCarrinho(Carrinho const &carrinho, float alpha);
+  void paintBarreiras(Barreiras const &barreiras, float alpha);
+
+  abcg::OpenGLMeshRegistry const *m_meshes{};
+
+  // Carrinho, drawn with a range of the per-object uniform buffer
+  GLuint m_objectsProgram{};
+  abcg::OpenGLUniformBuffer m_objectBlocks;
+  abcg::OpenGLMeshHandle m_carrinhoMesh;
+  GLuint m_carrinhoVAO{};
+
+  // Barreiras, drawn once per frame with instancing
+  GLuint m_instancedProgram{};
+  abcg::OpenGLMeshHandle m_barreiraMesh;
+  GLuint m_barreirasVAO{};
+  GLuint m_instanceVBO{};
+
+  std::vector<Instance> m_instances;
+  std::size_t m_instanceCapacity{};
+};
+
+#endif
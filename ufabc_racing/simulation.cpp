@@ -0,0 +1,110 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+
+#include "collisionkernel.hpp"
+
+void Simulation::seed(unsigned int seed) {
+  m_randomEngine.seed(seed);
+  m_barreiras.seed(seed);
+}
+
+void Simulation::restart() {
+  m_gameData.m_state = State::Playing;
+
+  m_carrinho.reset();
+  m_barreiras.clear();
+  m_barreiras.spawn(m_randomDist(m_randomEngine));
+
+  control_time = 0;
+  score = 0;
+  m_restartWaitTime = 0;
+}
+
+void Simulation::step(float deltaTime) {
+  // Wait 2 seconds before restarting
+  if (m_gameData.m_state != State::Playing) {
+    m_restartWaitTime += deltaTime;
+    if (m_restartWaitTime > 2) {
+      restart();
+      return;
+    }
+  }
+
+  // Keep the state of the previous step for interpolation when rendering
+  m_carrinho.m_previousTranslation = m_carrinho.m_translation;
+
+  // Atualize a posição do objeto com base nos comandos de teclado
+  float velocidade_de_deslocamento = 1.0f; // Ajuste a velocidade conforme necessário
+
+  if (m_gameData.m_input[static_cast<size_t>(Input::Left)]) {
+    // Movimente o objeto para a esquerda
+    m_carrinho.m_translation.x -= velocidade_de_deslocamento * deltaTime;
+  }
+
+  if (m_gameData.m_input[static_cast<size_t>(Input::Right)]) {
+    // Movimente o objeto para a direita
+    m_carrinho.m_translation.x += velocidade_de_deslocamento * deltaTime;
+  }
+
+  m_carrinho.update(m_gameData, deltaTime);
+  m_barreiras.update(m_carrinho, deltaTime);
+
+  if (m_gameData.m_state == State::Playing) {
+    checkCollisions();
+    checkWinCondition();
+  }
+
+  if (control_time > 2.5f){
+    m_barreiras.spawn(m_randomDist(m_randomEngine) + score / 10);
+    control_time = 0;
+    score++;
+  }
+  else{
+    control_time += deltaTime;
+  }
+}
+
+void Simulation::checkCollisions() {
+  auto const &pool{m_barreiras.m_barreiras};
+  if (pool.empty())
+    return;
+
+  auto const carrinhoRadius{m_carrinho.m_scale * 0.9f};
+  auto const position{m_carrinho.m_translation};
+
+  auto xs{pool.x()};
+  auto ys{pool.y()};
+  auto sizes{pool.scale()};
+
+  // Broad phase: rows twice as tall as the largest barreira, so only the rows
+  // around the carrinho need to be visited. A handful of barreiras is cheaper
+  // to test directly than to bucket
+  if (pool.size() > m_linearScanLimit) {
+    auto const maxBarreiraRadius{std::ranges::max(sizes) * 0.85f};
+    m_collisionGrid.build(xs, ys, sizes, 2.0f * maxBarreiraRadius);
+
+    auto const reach{carrinhoRadius + maxBarreiraRadius};
+    auto const range{
+        m_collisionGrid.query(position.y - reach, position.y + reach)};
+    xs = m_collisionGrid.x().subspan(range.first, range.count);
+    ys = m_collisionGrid.y().subspan(range.first, range.count);
+    sizes = m_collisionGrid.size().subspan(range.first, range.count);
+  }
+
+  // Narrow phase: test the candidates with the SIMD kernel, stopping at the
+  // first hit since a single one ends the game
+  if (findCircleCollision(position, carrinhoRadius, xs, ys, sizes, 0.85f) <
+      xs.size()) {
+    m_gameData.m_state = State::GameOver;
+    m_restartWaitTime = 0;
+  }
+}
+
+void Simulation::checkWinCondition() {
+  // The pool may be briefly empty between waves, so only the score counts
+  if (score >= m_winScore) {
+    m_gameData.m_state = State::Win;
+    m_restartWaitTime = 0;
+  }
+}
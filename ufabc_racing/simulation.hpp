@@ -0,0 +1,49 @@
+#ifndef SIMULATION_HPP_
+#define SIMULATION_HPP_
+
+#include <random>
+
+#include "barreiras.hpp"
+#include "carrinho.hpp"
+#include "collisiongrid.hpp"
+#include "gamedata.hpp"
+
+// Game state and rules, independent of any window or graphics API.
+//
+// The simulation only advances through step(), so running it with the same
+// seed, input and time step always gives the same result. Window drives it
+// from onFixedUpdate, and the headless runner drives it with scripted input.
+class Simulation {
+public:
+  void seed(unsigned int seed);
+  void restart();
+  void step(float deltaTime);
+
+  GameData m_gameData;
+
+  Carrinho m_carrinho;
+  Barreiras m_barreiras;
+
+  float control_time{};
+  int score{};
+
+  // Score at which the game is won
+  int m_winScore{10};
+
+private:
+  // Simulated time spent in the GameOver/Win state
+  float m_restartWaitTime{};
+
+  // Broad phase of checkCollisions(), rebuilt every step when there are
+  // more barreiras than m_linearScanLimit
+  constexpr static std::size_t m_linearScanLimit{32};
+  CollisionGrid m_collisionGrid;
+
+  std::default_random_engine m_randomEngine;
+  std::uniform_int_distribution<int> m_randomDist{1, 3};
+
+  void checkCollisions();
+  void checkWinCondition();
+};
+
+#endif
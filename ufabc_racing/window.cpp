@@ -4,15 +4,15 @@ void Window::onEvent(SDL_Event const &event) {
   // Keyboard events
   if (event.type == SDL_KEYDOWN) {
     if (event.key.keysym.sym == SDLK_LEFT || event.key.keysym.sym == SDLK_a)
-      m_gameData.m_input.set(gsl::narrow<size_t>(Input::Left));
+      m_simulation.m_gameData.m_input.set(gsl::narrow<size_t>(Input::Left));
     if (event.key.keysym.sym == SDLK_RIGHT || event.key.keysym.sym == SDLK_d)
-      m_gameData.m_input.set(gsl::narrow<size_t>(Input::Right));
+      m_simulation.m_gameData.m_input.set(gsl::narrow<size_t>(Input::Right));
   }
   if (event.type == SDL_KEYUP) {
     if (event.key.keysym.sym == SDLK_LEFT || event.key.keysym.sym == SDLK_a)
-      m_gameData.m_input.reset(gsl::narrow<size_t>(Input::Left));
+      m_simulation.m_gameData.m_input.reset(gsl::narrow<size_t>(Input::Left));
     if (event.key.keysym.sym == SDLK_RIGHT || event.key.keysym.sym == SDLK_d)
-      m_gameData.m_input.reset(gsl::narrow<size_t>(Input::Right));
+      m_simulation.m_gameData.m_input.reset(gsl::narrow<size_t>(Input::Right));
   }
 }
 
@@ -27,11 +27,20 @@ void Window::onCreate() {
   }
 
   // Create program to render the other objects
-  m_objectsProgram =
-      abcg::createOpenGLProgram({{.source = assetsPath + "objects.vert",
-                                  .stage = abcg::ShaderStage::Vertex},
-                                 {.source = assetsPath + "objects.frag",
-                                  .stage = abcg::ShaderStage::Fragment}});
+  m_programBuilder.add({{.source = assetsPath + "objects.vert",
+                         .stage = abcg::ShaderStage::Vertex},
+                        {.source = assetsPath + "objects.frag",
+                         .stage = abcg::ShaderStage::Fragment}},
+                       [this](GLuint program) { m_objectsProgram = program; });
+
+  // Create program to render instanced objects (barreiras)
+  m_programBuilder.add(
+      {{.source = assetsPath + "objects_instanced.vert",
+        .stage = abcg::ShaderStage::Vertex},
+       {.source = assetsPath + "objects.frag",
+        .stage = abcg::ShaderStage::Fragment}},
+      [this](GLuint program) { m_instancedProgram = program; });
+  m_loading = true;
 
   // // Create program to render the stars
   // m_starsProgram =
@@ -46,75 +55,62 @@ void Window::onCreate() {
   abcg::glEnable(GL_PROGRAM_POINT_SIZE);
 #endif
 
-  // Start pseudo-random number generator
-  m_randomEngine.seed(
-      std::chrono::steady_clock::now().time_since_epoch().count());
-
-  restart();
-}
-
-void Window::restart() {
-  m_gameData.m_state = State::Playing;
-
-  m_carrinho.create(m_objectsProgram);
-  m_barreiras.create(m_objectsProgram, m_randomDist(m_randomEngine));
-  //m_faixas.create(m_objectsProgram, 3);
-
-  control_time = 0;
-  score = 0;
+  // Start pseudo-random number generator. Offline renders use a fixed seed
+  // so that they can be reproduced
+  m_simulation.seed(
+      isOfflineRendering()
+          ? 1U
+          : gsl::narrow_cast<unsigned int>(
+                std::chrono::steady_clock::now().time_since_epoch().count()));
 }
 
 void Window::onUpdate() {
-  auto const deltaTime{gsl::narrow_cast<float>(getDeltaTime())};
-
-  // Wait 2 seconds before restarting
-  if (m_gameData.m_state != State::Playing &&
-      m_restartWaitTimer.elapsed() > 2) {
-    restart();
-    return;
+  // Offline renders must not depend on how long the shaders take to build
+  if (isOfflineRendering()) {
+    m_programBuilder.finish();
+  } else {
+    m_programBuilder.poll();
   }
 
-  // Atualize a posição do objeto com base nos comandos de teclado
-  float velocidade_de_deslocamento = 1.0f; // Ajuste a velocidade conforme necessário
-
-  if (m_gameData.m_input[static_cast<size_t>(Input::Left)]) {
-    // Movimente o objeto para a esquerda
-    m_carrinho.m_translation.x -= velocidade_de_deslocamento * deltaTime;
+  if (m_loading && m_programBuilder.getPendingCount() == 0) {
+    m_loading = false;
+    onProgramsReady();
   }
+}
 
-  if (m_gameData.m_input[static_cast<size_t>(Input::Right)]) {
-    // Movimente o objeto para a direita
-    m_carrinho.m_translation.x += velocidade_de_deslocamento * deltaTime;
-  }
+void Window::onProgramsReady() {
+  // GPU resources are created once; restarting only resets the simulation
+  m_renderer.create(m_objectsProgram, m_instancedProgram, m_meshes);
+  //m_faixas.create(m_objectsProgram, 3);
 
-  m_carrinho.update(m_gameData, deltaTime);
-  m_barreiras.update(m_carrinho, deltaTime);
-  //m_faixas.update(m_carrinho, deltaTime);
+  m_simulation.restart();
+}
 
+void Window::onFixedUpdate() {
+  ABCG_TRACE_ZONE("Simulation::step");
 
-  if (m_gameData.m_state == State::Playing) {
-    checkCollisions();
-    checkWinCondition();
-  }
+  // O jogo só começa depois que os shaders estiverem prontos
+  if (m_loading)
+    return;
 
-  if (control_time > 2.5f){
-    m_barreiras.create(m_objectsProgram, (m_randomDist(m_randomEngine) + score/10));
-    control_time = 0;
-    score++;
-  }
-  else{
-    control_time += deltaTime;
-  }
+  // The simulation always advances by the same step, so the outcome does not
+  // depend on the frame rate
+  m_simulation.step(gsl::narrow_cast<float>(getFixedDeltaTime()));
 }
 
-
 void Window::onPaint() {
   abcg::glClear(GL_COLOR_BUFFER_BIT);
   abcg::glViewport(0, 0, m_viewportSize.x, m_viewportSize.y);
 
+  if (m_loading)
+    return;
+
+  // Blend between the last two simulation steps
+  auto const alpha{gsl::narrow_cast<float>(getInterpolationAlpha())};
+
   //m_faixas.paint();
-  m_barreiras.paint();
-  m_carrinho.paint(m_gameData);
+  ABCG_TRACE_ZONE("Renderer::paint");
+  m_renderer.paint(m_simulation, alpha);
 }
 
 void Window::onPaintUI() {
@@ -133,9 +129,11 @@ void Window::onPaintUI() {
     ImGui::Begin(" ", nullptr, flags);
     ImGui::PushFont(m_font);
 
-    if (m_gameData.m_state == State::GameOver) {
+    if (m_loading) {
+      ImGui::Text("Carregando...");
+    } else if (m_simulation.m_gameData.m_state == State::GameOver) {
       ImGui::Text("Game Over!");
-    } else if (m_gameData.m_state == State::Win) {
+    } else if (m_simulation.m_gameData.m_state == State::Win) {
       ImGui::Text("*You Win!*");
     }
 
@@ -151,31 +149,12 @@ void Window::onResize(glm::ivec2 const &size) {
 }
 
 void Window::onDestroy() {
+  m_programBuilder.destroy();
   abcg::glDeleteProgram(m_starsProgram);
   abcg::glDeleteProgram(m_objectsProgram);
+  abcg::glDeleteProgram(m_instancedProgram);
 
-  m_barreiras.destroy();
-  m_carrinho.destroy();
+  m_renderer.destroy();
   //m_faixas.destroy();
+  m_meshes.destroy();
 }
-
-void Window::checkCollisions() {
-  // Check collision between carrinhos and barreiras
-  for (auto const &barreira : m_barreiras.m_barreiras) {
-    auto const barreiraTranslation{barreira.m_translation};
-    auto const distance{
-        glm::distance(m_carrinho.m_translation, barreiraTranslation)};
-
-    if (distance < m_carrinho.m_scale * 0.9f + barreira.m_scale * 0.85f) {
-      m_gameData.m_state = State::GameOver;
-      m_restartWaitTimer.restart();
-    }
-  }
-}
-
-void Window::checkWinCondition() {
-  if (m_barreiras.m_barreiras.empty() || score >= 10) {
-    m_gameData.m_state = State::Win;
-    m_restartWaitTimer.restart();
-  }
-}
\ No newline at end of file
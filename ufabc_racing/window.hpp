@@ -1,50 +1,45 @@
 #ifndef WINDOW_HPP_
 #define WINDOW_HPP_
 
-#include <random>
-
 #include "abcgOpenGL.hpp"
 
-#include "barreiras.hpp"
-#include "carrinho.hpp"
 #include "faixa.hpp"
+#include "renderer.hpp"
+#include "simulation.hpp"
 
 class Window : public abcg::OpenGLWindow {
 protected:
   void onEvent(SDL_Event const &event) override;
   void onCreate() override;
   void onUpdate() override;
+  void onFixedUpdate() override;
   void onPaint() override;
   void onPaintUI() override;
   void onResize(glm::ivec2 const &size) override;
   void onDestroy() override;
 
 private:
+  void onProgramsReady();
+
   glm::ivec2 m_viewportSize{};
 
+  // Programs are built in the background while the loading text is shown
+  abcg::OpenGLProgramBuilder m_programBuilder;
+  bool m_loading{};
+
   GLuint m_starsProgram{};
   GLuint m_objectsProgram{};
+  GLuint m_instancedProgram{};
 
-  GameData m_gameData;
-
-  Barreiras m_barreiras;
-  Carrinho m_carrinho;
-  Faixas m_faixas;
+  Simulation m_simulation;
 
+  // Immutable shapes shared by carrinho and barreiras
+  abcg::OpenGLMeshRegistry m_meshes;
 
-  abcg::Timer m_restartWaitTimer;
+  Renderer m_renderer;
+  Faixas m_faixas;
 
   ImFont *m_font{};
-
-  std::default_random_engine m_randomEngine;
-  std::uniform_int_distribution<int> m_randomDist{1, 3};
-
-  float control_time;
-  int score;
-
-  void restart();
-  void checkCollisions();
-  void checkWinCondition();
 };
 
 #endif
\ No newline at end of file